@@ -0,0 +1,63 @@
+#include "bench.h"
+
+#include <llvm-c/ExecutionEngine.h>
+#include <llvm-c/TargetMachine.h>
+
+void bench_switch(void);
+void bench_macro(void);
+void bench_lexer(void);
+void bench_parser(void);
+void bench_phases(void);
+
+double bench_now(void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+uint64_t bench_jit_function(const char *filename, const char *src,
+                           const char *func) {
+    assert(filename != NULL);
+    assert(src != NULL);
+    assert(func != NULL);
+
+    TranslationUnitNode *node = parse(filename, src, vec_new());
+    LLVMModuleRef module = generate(node);
+
+    LLVMExecutionEngineRef engine = NULL;
+    char *error = NULL;
+
+    if (LLVMCreateExecutionEngineForModule(&engine, module, &error)) {
+        fprintf(stderr, "%s: error %s\n", filename, error);
+        exit(1);
+    }
+
+    /* the engine lives until the process exits */
+    return LLVMGetFunctionAddress(engine, func);
+}
+
+void bench_report(const char *suite, const char *name, double seconds,
+                  double count, const char *unit) {
+    assert(suite != NULL);
+    assert(name != NULL);
+    assert(unit != NULL);
+
+    if (seconds <= 0) {
+        seconds = 1e-9;
+    }
+
+    printf("%-12s %-24s %10.3f ms %14.0f %s/s\n", suite, name, seconds * 1000,
+           count / seconds, unit);
+}
+
+int main(void) {
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+    LLVMLinkInMCJIT();
+
+    bench_switch();
+    bench_macro();
+    bench_lexer();
+    bench_parser();
+    bench_phases();
+
+    return 0;
+}
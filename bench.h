@@ -0,0 +1,19 @@
+#ifndef INCLUDE_bench_h
+#define INCLUDE_bench_h
+
+#ifndef USE_STANDARD_HEADERS
+#define USE_STANDARD_HEADERS
+#endif
+
+#include "nocc.h"
+
+#include <time.h>
+
+double bench_now(void);
+uint64_t bench_jit_function(const char *filename, const char *src,
+                           const char *func);
+void bench_report(const char *suite, const char *name, double seconds,
+                  double count, const char *unit);
+uint64_t bench_allocations(void);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef __MINGW64__
+#define _GNU_SOURCE
+#endif
+
+#include "bench.h"
+
+/* counts calls to malloc and realloc made anywhere in the process by
+   interposing them; the real functions are looked up with RTLD_NEXT */
+
+#ifdef __MINGW64__
+
+uint64_t bench_allocations(void) {
+    return 0;
+}
+
+#else
+
+#include <dlfcn.h>
+
+static void *(*bench_real_malloc)(size_t size);
+static void *(*bench_real_realloc)(void *ptr, size_t size);
+static void (*bench_real_free)(void *ptr);
+
+static uint64_t bench_num_allocations;
+
+/* serves the allocations dlsym may make while the real functions are
+   looked up */
+static char bench_bootstrap_heap[65536];
+static size_t bench_bootstrap_used;
+static bool bench_resolving;
+
+static bool bench_is_bootstrap(void *ptr) {
+    return (char *)ptr >= bench_bootstrap_heap &&
+           (char *)ptr < bench_bootstrap_heap + sizeof(bench_bootstrap_heap);
+}
+
+static void *bench_bootstrap_malloc(size_t size) {
+    size = (size + 15) / 16 * 16;
+
+    if (bench_bootstrap_used + size > sizeof(bench_bootstrap_heap)) {
+        return NULL;
+    }
+
+    void *ptr = bench_bootstrap_heap + bench_bootstrap_used;
+    bench_bootstrap_used += size;
+
+    return ptr;
+}
+
+static void bench_resolve(void) {
+    bench_resolving = true;
+
+    /* POSIX way to convert the result of dlsym to a function pointer */
+    *(void **)&bench_real_malloc = dlsym(RTLD_NEXT, "malloc");
+    *(void **)&bench_real_realloc = dlsym(RTLD_NEXT, "realloc");
+    *(void **)&bench_real_free = dlsym(RTLD_NEXT, "free");
+
+    bench_resolving = false;
+}
+
+void *malloc(size_t size) {
+    if (bench_real_malloc == NULL) {
+        if (bench_resolving) {
+            return bench_bootstrap_malloc(size);
+        }
+
+        bench_resolve();
+    }
+
+    bench_num_allocations++;
+    return bench_real_malloc(size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (bench_is_bootstrap(ptr)) {
+        size_t available = bench_bootstrap_heap + sizeof(bench_bootstrap_heap) -
+                           (char *)ptr;
+        void *new_ptr = malloc(size);
+
+        if (new_ptr != NULL) {
+            memcpy(new_ptr, ptr, size < available ? size : available);
+        }
+
+        return new_ptr;
+    }
+
+    if (bench_real_realloc == NULL) {
+        bench_resolve();
+    }
+
+    bench_num_allocations++;
+    return bench_real_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    if (ptr == NULL || bench_is_bootstrap(ptr)) {
+        return;
+    }
+
+    if (bench_real_free == NULL) {
+        bench_resolve();
+    }
+
+    bench_real_free(ptr);
+}
+
+uint64_t bench_allocations(void) {
+    return bench_num_allocations;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include "bench.h"
+
+/* a mix of the runs the lexer skips in bulk */
+static const char *bench_lexer_chunk =
+    "/* Compute the checksum of a buffer.\n"
+    " * The comment spans several lines to exercise the terminator scan.\n"
+    " */\n"
+    "int compute_checksum_of_buffer(const char *buffer_pointer, int length) {\n"
+    "    int accumulated_checksum_value;\n"
+    "    int index_into_buffer;\n"
+    "\n"
+    "    accumulated_checksum_value = 0;\n"
+    "    for (index_into_buffer = 0; index_into_buffer < length;\n"
+    "         index_into_buffer++) {\n"
+    "        accumulated_checksum_value =\n"
+    "            accumulated_checksum_value * 31 + 1234567;\n"
+    "    }\n"
+    "\n"
+    "    printf(\"checksum of the buffer is %d, computed over %d bytes\\n\",\n"
+    "           accumulated_checksum_value, length);\n"
+    "    return accumulated_checksum_value;\n"
+    "}\n"
+    "\n";
+
+void bench_lexer(void) {
+    const int num_chunks = 20000;
+    size_t len_chunk = strlen(bench_lexer_chunk);
+    char *src = malloc(len_chunk * num_chunks + 1);
+
+    for (int i = 0; i < num_chunks; i++) {
+        memcpy(src + len_chunk * i, bench_lexer_chunk, len_chunk);
+    }
+    src[len_chunk * num_chunks] = '\0';
+
+    double start = bench_now();
+    Vec *tokens = lex("bench_lexer", src);
+    double seconds = bench_now() - start;
+
+    double megabytes = (double)(len_chunk * num_chunks) / 1e6;
+
+    bench_report("lexer", "mixed-source", seconds, megabytes, "MB");
+    bench_report("lexer", "mixed-source", seconds, tokens->size, "token");
+}
@@ -0,0 +1,43 @@
+#include "bench.h"
+
+/* every level doubles the expansion and re-expands its argument */
+static const char *bench_macro_header =
+    "#define CAT(a, b) a ## b\n"
+    "#define ID(x) x\n"
+    "#define ADD(a, b) ((a) + (b))\n"
+    "#define DUP(x) ADD(x, x)\n"
+    "#define N0(x) ID(ID(ID(x)))\n"
+    "#define N1(x) DUP(N0(x))\n"
+    "#define N2(x) DUP(N1(x))\n"
+    "#define N3(x) DUP(N2(x))\n"
+    "#define N4(x) DUP(N3(x))\n"
+    "#define N5(x) DUP(N4(x))\n"
+    "#define N6(x) DUP(N5(x))\n"
+    "#define N7(x) DUP(N6(x))\n"
+    "#define N8(x) DUP(N7(x))\n"
+    "#define FN(i, ...) int CAT(f, i)(int n) { return N8(__VA_ARGS__); }\n";
+
+void bench_macro(void) {
+    const int num_functions = 200;
+    size_t size = strlen(bench_macro_header) + num_functions * 32 + 1;
+    char *src = malloc(size);
+
+    strcpy(src, bench_macro_header);
+    for (int i = 0; i < num_functions; i++) {
+        sprintf(src + strlen(src), "FN(%d, n)\n", i);
+    }
+
+    double start = bench_now();
+    Vec *tokens = preprocess("bench_macro", src, vec_new());
+    double seconds = bench_now() - start;
+
+    bench_report("macro", "nested-expansion", seconds, tokens->size, "token");
+
+    /* make sure the expansion is still a valid program */
+    int (*f)(int) = (int (*)(int))bench_jit_function("bench_macro", src, "f0");
+
+    if (f(1) != 256) {
+        fprintf(stderr, "bench_macro: unexpected result %d\n", f(1));
+        exit(1);
+    }
+}
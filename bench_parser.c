@@ -0,0 +1,64 @@
+#include "bench.h"
+
+/* expression statements parsed straight from a token array, so that the
+   preprocessor and the statement parser stay out of the measurement */
+static const char *bench_parser_chunk =
+    "a * 3 + b / 3 - c % 7 < a + b * c && (a ^ b) == (c | 5) ||\n"
+    "    a - b - c >= 9 && a * b * c + a * b + a != (a & b & c) + 11;\n"
+    "a = b = c + 1;\n"
+    "1;\n"
+    "a;\n"
+    "(a + 1) * (b - 2) / (c + 3);\n";
+
+static void bench_parser_register(ParserContext *ctx, const char *name) {
+    VariableNode *decl = malloc(sizeof(*decl));
+
+    decl->kind = node_variable;
+    decl->location = 0;
+    decl->symbol = (Symbol *)variable_symbol_new(0, name, type_get_int32());
+
+    scope_stack_register(ctx->env, name, decl);
+}
+
+void bench_parser(void) {
+    const int num_chunks = 20000;
+    const int num_runs = 5;
+    size_t len_chunk = strlen(bench_parser_chunk);
+    char *src = malloc(len_chunk * num_chunks + 1);
+    double best = 0;
+
+    for (int i = 0; i < num_chunks; i++) {
+        memcpy(src + len_chunk * i, bench_parser_chunk, len_chunk);
+    }
+    src[len_chunk * num_chunks] = '\0';
+
+    Vec *tokens = preprocess("bench_parser", src, vec_new());
+
+    for (int run = 0; run < num_runs; run++) {
+        ParserContext ctx = {
+            .env = scope_stack_new(),
+            .struct_env = scope_stack_new(),
+            .tokens = (const Token **)tokens->data,
+            .index = 0,
+        };
+
+        bench_parser_register(&ctx, "a");
+        bench_parser_register(&ctx, "b");
+        bench_parser_register(&ctx, "c");
+
+        double start = bench_now();
+
+        while (ctx.tokens[ctx.index]->kind != '\0') {
+            parse_expr(&ctx);
+            ctx.index++; /* ; */
+        }
+
+        double seconds = bench_now() - start;
+
+        if (run == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+
+    bench_report("parser", "expression-heavy", best, tokens->size, "token");
+}
@@ -0,0 +1,389 @@
+#ifndef __MINGW64__
+#define _GNU_SOURCE
+#endif
+
+#include "bench.h"
+
+#ifdef __MINGW64__
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/* feeds each corpus through lex, preprocess, parse and generate separately
+   and reports the throughput and the number of allocations of every phase */
+
+#define bench_num_includes 64
+
+/* the generated headers live in a fresh directory, removed at exit */
+static char bench_include_dir[] = "bench_includes_XXXXXX";
+static bool bench_include_dir_made;
+
+typedef struct BenchCorpus {
+    const char *name;
+    int num_files;
+    const char **filenames;
+    char **sources;
+} BenchCorpus;
+
+typedef struct BenchPhase {
+    double seconds;
+    uint64_t allocations;
+    int num_tokens;
+    int num_lines;
+    int num_functions;
+} BenchPhase;
+
+static const char *bench_nocc_sources[] = {
+    "file.c",        "generator.c",   "lexer.c",       "map.c",
+    "parser.c",      "partition.c",   "path.c",        "preprocessor.c",
+    "sema.c",        "scope_stack.c", "source.c",      "symbol.c",
+    "type.c",        "util.c",        "vec.c",         "main.c",
+};
+
+static char *bench_append(char *buffer, size_t *len, size_t *capacity,
+                          const char *text) {
+    size_t len_text = strlen(text);
+
+    if (*len + len_text + 1 > *capacity) {
+        while (*len + len_text + 1 > *capacity) {
+            *capacity = *capacity * 2 + 256;
+        }
+        buffer = realloc(buffer, *capacity);
+    }
+
+    memcpy(buffer + *len, text, len_text + 1);
+    *len += len_text;
+
+    return buffer;
+}
+
+static void bench_write_file(const char *filename, const char *text) {
+    FILE *fp = fopen(filename, "w");
+
+    if (fp == NULL) {
+        fprintf(stderr, "bench_phases: cannot write %s\n", filename);
+        exit(1);
+    }
+
+    fputs(text, fp);
+    fclose(fp);
+}
+
+static BenchCorpus bench_single_file_corpus(const char *name,
+                                            const char *filename, char *src) {
+    BenchCorpus corpus = {name, 1, malloc(sizeof(char *)),
+                          malloc(sizeof(char *))};
+
+    corpus.filenames[0] = filename;
+    corpus.sources[0] = src;
+
+    return corpus;
+}
+
+/* lines are counted as the source lines that produced at least one token,
+   so that lines pulled in by #include are included */
+static int bench_count_lines(Vec *tokens) {
+    const char *filename = NULL;
+    int line = 0;
+    int num_lines = 0;
+
+    for (int i = 0; i < tokens->size; i++) {
+        const Token *t = tokens->data[i];
+
+        if (t->kind == '\0' || t->kind == '\n') {
+            continue;
+        }
+
+        if (t->filename != filename || t->line != line) {
+            filename = t->filename;
+            line = t->line;
+            num_lines++;
+        }
+    }
+
+    return num_lines;
+}
+
+/* every nocc source file, each as its own translation unit */
+static BenchCorpus bench_nocc_corpus(void) {
+    int num_files = sizeof(bench_nocc_sources) / sizeof(char *);
+    BenchCorpus corpus = {"nocc-sources", num_files,
+                          malloc(sizeof(char *) * num_files),
+                          malloc(sizeof(char *) * num_files)};
+
+    for (int i = 0; i < num_files; i++) {
+        corpus.filenames[i] = bench_nocc_sources[i];
+        corpus.sources[i] = read_file(bench_nocc_sources[i]);
+
+        if (corpus.sources[i] == NULL) {
+            fprintf(stderr, "bench_phases: cannot open %s\n",
+                    bench_nocc_sources[i]);
+            exit(1);
+        }
+    }
+
+    return corpus;
+}
+
+/* ordinary functions until the source reaches 10 MB */
+static BenchCorpus bench_generated_corpus(void) {
+    const size_t target_size = 10 * 1000 * 1000;
+    size_t len = 0;
+    size_t capacity = target_size + 4096;
+    char *src = malloc(capacity);
+
+    src[0] = '\0';
+
+    for (int i = 0; len < target_size; i++) {
+        char function[512];
+
+        sprintf(function,
+                "int generated_%d(int count, int step) {\n"
+                "    int index;\n"
+                "    int sum;\n"
+                "\n"
+                "    sum = 0;\n"
+                "    for (index = 0; index < count; index++) {\n"
+                "        if (index %% 3 == 0) {\n"
+                "            sum = sum + step * index;\n"
+                "        } else {\n"
+                "            sum = sum - index;\n"
+                "        }\n"
+                "    }\n"
+                "    return sum;\n"
+                "}\n"
+                "\n",
+                i);
+        src = bench_append(src, &len, &capacity, function);
+    }
+
+    return bench_single_file_corpus("generated-10MB", "bench_generated.c",
+                                    src);
+}
+
+/* every statement goes through several levels of function-like macros */
+static BenchCorpus bench_macro_corpus(void) {
+    const int num_functions = 2000;
+    size_t len = 0;
+    size_t capacity = 0;
+    char *src = NULL;
+
+    src = bench_append(src, &len, &capacity,
+                       "#define CAT(a, b) a ## b\n"
+                       "#define NAME(i) CAT(macro_, i)\n"
+                       "#define SQUARE(x) ((x) * (x))\n"
+                       "#define MIX(a, b) (((a) + (b)) / 2)\n"
+                       "#define CLAMP(x, lo, hi) MIX(lo, MIX(x, hi) - hi)\n"
+                       "#define STEP(s, x) s = s + CLAMP(SQUARE(x), 0, 100);\n"
+                       "#define STEPS(s, x) STEP(s, x) STEP(s, x + 1) "
+                       "STEP(s, x + 2) STEP(s, x + 3)\n"
+                       "#define FUNCTION(i) \\\n"
+                       "    int NAME(i)(int n) { \\\n"
+                       "        int s; \\\n"
+                       "        s = 0; \\\n"
+                       "        STEPS(s, n) STEPS(s, n * 2) \\\n"
+                       "        return s; \\\n"
+                       "    }\n");
+
+    for (int i = 0; i < num_functions; i++) {
+        char line[64];
+
+        sprintf(line, "FUNCTION(%d)\n", i);
+        src = bench_append(src, &len, &capacity, line);
+    }
+
+    return bench_single_file_corpus("macro-heavy", "bench_macros.c", src);
+}
+
+static void bench_remove_includes(void) {
+    if (!bench_include_dir_made) {
+        return;
+    }
+
+    for (int i = 0; i < bench_num_includes; i++) {
+        char filename[64];
+
+        sprintf(filename, "%s/bench_include_%d.h", bench_include_dir, i);
+        remove(filename);
+    }
+
+#ifdef __MINGW64__
+    _rmdir(bench_include_dir);
+#else
+    rmdir(bench_include_dir);
+#endif
+    bench_include_dir_made = false;
+}
+
+static void bench_make_include_dir(void) {
+#ifdef __MINGW64__
+    if (_mktemp(bench_include_dir) == NULL || _mkdir(bench_include_dir) != 0) {
+#else
+    if (mkdtemp(bench_include_dir) == NULL) {
+#endif
+        fprintf(stderr, "bench_phases: cannot make %s\n", bench_include_dir);
+        exit(1);
+    }
+
+    /* also when a later phase exits on an error */
+    bench_include_dir_made = true;
+    atexit(bench_remove_includes);
+}
+
+/* guarded headers, each included several times */
+static BenchCorpus bench_include_corpus(void) {
+    size_t len = 0;
+    size_t capacity = 0;
+    char *src = NULL;
+
+    bench_make_include_dir();
+
+    for (int i = 0; i < bench_num_includes; i++) {
+        char filename[64];
+        char header[1024];
+
+        sprintf(filename, "%s/bench_include_%d.h", bench_include_dir, i);
+        sprintf(header,
+                "#ifndef INCLUDE_bench_include_%d_h\n"
+                "#define INCLUDE_bench_include_%d_h\n"
+                "\n"
+                "typedef struct Include%d {\n"
+                "    int value;\n"
+                "    char *name;\n"
+                "} Include%d;\n"
+                "\n"
+                "int include_%d(Include%d *p);\n"
+                "\n"
+                "#endif\n",
+                i, i, i, i, i, i);
+        bench_write_file(filename, header);
+
+        for (int j = 0; j < 4; j++) {
+            char directive[128];
+
+            sprintf(directive, "#include \"%s\"\n", filename);
+            src = bench_append(src, &len, &capacity, directive);
+        }
+    }
+
+    src = bench_append(src, &len, &capacity,
+                       "int include_0(Include0 *p) {\n"
+                       "    return p->value;\n"
+                       "}\n");
+
+    return bench_single_file_corpus("include-heavy", "bench_includes.c", src);
+}
+
+static int bench_count_functions(const TranslationUnitNode *node) {
+    int num_functions = 0;
+
+    for (int i = 0; i < node->num_decls; i++) {
+        if (node->decls[i]->kind == node_function &&
+            ((const FunctionNode *)node->decls[i])->body != NULL) {
+            num_functions++;
+        }
+    }
+
+    return num_functions;
+}
+
+static void bench_phase_begin(BenchPhase *phase) {
+    phase->allocations -= bench_allocations();
+    phase->seconds -= bench_now();
+}
+
+static void bench_phase_end(BenchPhase *phase, Vec *tokens) {
+    phase->seconds += bench_now();
+    phase->allocations += bench_allocations();
+
+    if (tokens != NULL) {
+        phase->num_tokens += tokens->size;
+        phase->num_lines += bench_count_lines(tokens);
+    }
+}
+
+static void bench_phase_report(const BenchCorpus *corpus, const char *name,
+                               const BenchPhase *phase) {
+    double seconds = phase->seconds;
+
+    if (seconds <= 0) {
+        seconds = 1e-9;
+    }
+
+    printf("%-12s %-16s %10.3f ms %12.0f token/s %10.0f line/s %10llu "
+           "alloc\n",
+           name, corpus->name, seconds * 1000, phase->num_tokens / seconds,
+           phase->num_lines / seconds, (unsigned long long)phase->allocations);
+}
+
+static void bench_phases_run(const BenchCorpus *corpus) {
+    BenchPhase lex_phase = {0};
+    BenchPhase preprocess_phase = {0};
+    BenchPhase parse_phase = {0};
+    BenchPhase generate_phase = {0};
+
+    for (int i = 0; i < corpus->num_files; i++) {
+        const char *filename = corpus->filenames[i];
+        const char *src = corpus->sources[i];
+
+        bench_phase_begin(&lex_phase);
+        Vec *raw_tokens = lex(filename, src);
+        bench_phase_end(&lex_phase, raw_tokens);
+
+        bench_phase_begin(&preprocess_phase);
+        Vec *tokens = preprocess(filename, src, vec_new());
+        bench_phase_end(&preprocess_phase, tokens);
+
+        /* the parser pulls its tokens from the preprocessor, so the cost of
+           preprocessing the same file is subtracted afterwards */
+        bench_phase_begin(&parse_phase);
+        TranslationUnitNode *node = parse(filename, src, vec_new());
+        bench_phase_end(&parse_phase, NULL);
+        parse_phase.num_functions += bench_count_functions(node);
+
+        bench_phase_begin(&generate_phase);
+        LLVMModuleRef module = generate(node);
+        bench_phase_end(&generate_phase, NULL);
+
+        LLVMDisposeModule(module);
+    }
+
+    parse_phase.seconds -= preprocess_phase.seconds;
+    parse_phase.allocations -= preprocess_phase.allocations;
+
+    /* later phases consume the preprocessed tokens */
+    parse_phase.num_tokens = preprocess_phase.num_tokens;
+    parse_phase.num_lines = preprocess_phase.num_lines;
+    generate_phase.num_tokens = preprocess_phase.num_tokens;
+    generate_phase.num_lines = preprocess_phase.num_lines;
+
+    bench_phase_report(corpus, "lex", &lex_phase);
+    bench_phase_report(corpus, "preprocess", &preprocess_phase);
+    bench_phase_report(corpus, "parse", &parse_phase);
+
+    if (parse_phase.num_functions > 0) {
+        printf("%-12s %-16s %10.1f alloc/function\n", "parse", corpus->name,
+               (double)parse_phase.allocations / parse_phase.num_functions);
+    }
+
+    bench_phase_report(corpus, "generate", &generate_phase);
+}
+
+void bench_phases(void) {
+    BenchCorpus corpus;
+
+    corpus = bench_nocc_corpus();
+    bench_phases_run(&corpus);
+
+    corpus = bench_generated_corpus();
+    bench_phases_run(&corpus);
+
+    corpus = bench_macro_corpus();
+    bench_phases_run(&corpus);
+
+    corpus = bench_include_corpus();
+    bench_phases_run(&corpus);
+    bench_remove_includes();
+}
@@ -0,0 +1,114 @@
+#include "bench.h"
+
+/* a small bytecode interpreter; opcodes are supplied as macros */
+static const char *bench_switch_vm =
+    "int vm(int n) {\n"
+    "  int code[16];\n"
+    "  int pc;\n"
+    "  int acc;\n"
+    "  int counter;\n"
+    "  code[0] = OP_INC;\n"
+    "  code[1] = OP_ADD;\n"
+    "  code[2] = OP_MUL;\n"
+    "  code[3] = OP_MASK;\n"
+    "  code[4] = OP_XOR;\n"
+    "  code[5] = OP_NOP;\n"
+    "  code[6] = OP_SUB;\n"
+    "  code[7] = OP_DEC;\n"
+    "  code[8] = OP_JNZ;\n"
+    "  code[9] = 0;\n"
+    "  code[10] = OP_HALT;\n"
+    "  pc = 0;\n"
+    "  acc = 0;\n"
+    "  counter = n;\n"
+    "  while (1) {\n"
+    "    switch (code[pc]) {\n"
+    "    case OP_INC: acc = acc + 1; pc++; break;\n"
+    "    case OP_ADD: acc = acc + counter; pc++; break;\n"
+    "    case OP_MUL: acc = acc * 3; pc++; break;\n"
+    "    case OP_MASK: acc = acc & 65535; pc++; break;\n"
+    "    case OP_XOR: acc = acc ^ pc; pc++; break;\n"
+    "    case OP_NOP: pc++; break;\n"
+    "    case OP_SUB: acc = acc - 1; pc++; break;\n"
+    "    case OP_DEC: counter--; pc++; break;\n"
+    "    case OP_JNZ:\n"
+    "      if (counter != 0) pc = code[pc + 1]; else pc = pc + 2;\n"
+    "      break;\n"
+    "    case OP_HALT: return acc;\n"
+    "    default: return -1;\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+/* counts character classes of a synthetic text */
+static const char *bench_switch_lexer =
+    "int classify(int c) {\n"
+    "  switch (c) {\n"
+    "  case 32: case 33: case 34: case 39:\n"
+    "    return 1;\n"
+    "  case 40: case 41: case 44: case 46: case 59:\n"
+    "    return 2;\n"
+    "  default:\n"
+    "    return 0;\n"
+    "  }\n"
+    "}\n"
+    "int scan(int n) {\n"
+    "  int i;\n"
+    "  int s;\n"
+    "  s = 0;\n"
+    "  for (i = 0; i < n; i++) s = s + classify(i % 96 + 16);\n"
+    "  return s;\n"
+    "}\n";
+
+static void bench_switch_run(const char *name, const char *defines,
+                             const char *body, const char *func,
+                             int iterations, int dispatches_per_iteration) {
+    char *src = malloc(strlen(defines) + strlen(body) + 1);
+    strcpy(src, defines);
+    strcat(src, body);
+
+    int (*f)(int) = (int (*)(int))bench_jit_function(name, src, func);
+
+    double start = bench_now();
+    int result = f(iterations);
+    double seconds = bench_now() - start;
+
+    if (result < 0) {
+        fprintf(stderr, "bench_switch:%s: interpreter failed\n", name);
+        exit(1);
+    }
+
+    bench_report("switch", name, seconds,
+                 (double)iterations * dispatches_per_iteration, "dispatch");
+}
+
+void bench_switch(void) {
+    bench_switch_run("dense", /* jump table */
+                     "#define OP_INC 0\n"
+                     "#define OP_ADD 1\n"
+                     "#define OP_MUL 2\n"
+                     "#define OP_MASK 3\n"
+                     "#define OP_XOR 4\n"
+                     "#define OP_NOP 5\n"
+                     "#define OP_SUB 6\n"
+                     "#define OP_DEC 7\n"
+                     "#define OP_JNZ 8\n"
+                     "#define OP_HALT 9\n",
+                     bench_switch_vm, "vm", 20000000, 9);
+
+    bench_switch_run("sparse", /* binary search */
+                     "#define OP_INC 3\n"
+                     "#define OP_ADD 70\n"
+                     "#define OP_MUL 512\n"
+                     "#define OP_MASK 4000\n"
+                     "#define OP_XOR 65000\n"
+                     "#define OP_NOP 100000\n"
+                     "#define OP_SUB 777777\n"
+                     "#define OP_DEC 1000000\n"
+                     "#define OP_JNZ 5000000\n"
+                     "#define OP_HALT 99999999\n",
+                     bench_switch_vm, "vm", 20000000, 9);
+
+    bench_switch_run("char-class", /* bit test */
+                     "", bench_switch_lexer, "scan", 50000000, 1);
+}
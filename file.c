@@ -4,7 +4,7 @@
 
 char *read_file(const char *filename) {
     FILE *fp;
-    int size;
+    long size;
     char *buffer;
 
     assert(filename != NULL);
@@ -19,6 +19,11 @@ char *read_file(const char *filename) {
     size = ftell(fp);
     fseek(fp, 0, SEEK_SET);
 
+    if (size < 0) {
+        fclose(fp);
+        return NULL;
+    }
+
     buffer = malloc(size + 1);
     fread(buffer, 1, size, fp);
     buffer[size] = '\0';
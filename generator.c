@@ -1,5 +1,12 @@
 #include "nocc.h"
 
+#define switch_linear_max_cases 3
+#define switch_jump_table_min_cases 4
+#define switch_jump_table_min_density 40
+#define switch_jump_table_max_range 65536
+#define switch_bit_test_max_range 30
+#define switch_bit_test_max_destinations 3
+
 LLVMBasicBlockRef nearest_break_target(GeneratorContext *ctx) {
     assert(ctx != NULL);
     assert(ctx->break_targets->size > 0);
@@ -124,6 +131,9 @@ LLVMTypeRef generate_type(GeneratorContext *ctx, Type *p) {
     case type_int32:
         return LLVMInt32Type();
 
+    case type_int64:
+        return LLVMInt64Type();
+
     case type_pointer:
         return generate_pointer_type(ctx, (PointerType *)p);
 
@@ -152,13 +162,11 @@ LLVMValueRef generate_type_size(GeneratorContext *ctx, Type *p) {
     one = LLVMConstInt(LLVMInt32Type(), 1, false);
     value = LLVMBuildInBoundsGEP(ctx->builder, LLVMConstNull(type), &one, 1,
                                  "sizeptr");
-    return LLVMBuildPtrToInt(ctx->builder, value, LLVMInt32Type(), "sizeof");
+    return LLVMBuildPtrToInt(ctx->builder, value, LLVMInt64Type(), "sizeof");
 }
 
 LLVMValueRef generate_integer_expr(GeneratorContext *ctx, IntegerNode *p) {
-    (void)ctx;
-
-    return LLVMConstInt(LLVMInt32Type(), p->value, true);
+    return LLVMConstInt(generate_type(ctx, p->type), p->value, true);
 }
 
 LLVMValueRef generate_string_expr(GeneratorContext *ctx, StringNode *p) {
@@ -168,6 +176,77 @@ LLVMValueRef generate_string_expr(GeneratorContext *ctx, StringNode *p) {
     return LLVMBuildGlobalStringPtr(ctx->builder, p->string, ".str");
 }
 
+VariableSymbol *restrict_base_symbol(ExprNode *p) {
+    assert(p != NULL);
+
+    /* the pointer an lvalue is accessed through */
+    while (p->kind == node_dot) {
+        p = ((DotNode *)p)->parent;
+    }
+
+    if (p->kind == node_unary && ((UnaryNode *)p)->operator_ == '*') {
+        p = ((UnaryNode *)p)->operand;
+    } else if (p->kind == node_binary && ((BinaryNode *)p)->operator_ == '[') {
+        p = ((BinaryNode *)p)->left;
+    } else {
+        return NULL;
+    }
+
+    /* a restrict pointer the address is syntactically based on */
+    while (1) {
+        if (p->kind == node_cast) {
+            p = ((CastNode *)p)->operand;
+        } else if (p->kind == node_postfix) {
+            p = ((PostfixNode *)p)->operand;
+        } else if (p->kind == node_binary &&
+                   (((BinaryNode *)p)->operator_ == '+' ||
+                    ((BinaryNode *)p)->operator_ == '-')) {
+            if (is_pointer_type(((BinaryNode *)p)->left->type)) {
+                p = ((BinaryNode *)p)->left;
+            } else if (is_pointer_type(((BinaryNode *)p)->right->type)) {
+                p = ((BinaryNode *)p)->right;
+            } else {
+                return NULL;
+            }
+        } else {
+            break;
+        }
+    }
+
+    if (p->kind != node_identifier ||
+        ((IdentifierNode *)p)->symbol->generated_alias_scope == NULL) {
+        return NULL;
+    }
+
+    return ((IdentifierNode *)p)->symbol;
+}
+
+void generate_alias_metadata(GeneratorContext *ctx, LLVMValueRef access,
+                             ExprNode *lvalue) {
+    VariableSymbol *symbol;
+    LLVMContextRef context;
+
+    assert(ctx != NULL);
+    assert(access != NULL);
+    assert(lvalue != NULL);
+
+    symbol = restrict_base_symbol(lvalue);
+
+    if (symbol == NULL) {
+        return;
+    }
+
+    /* an access through a restrict pointer does not alias the accesses
+       through the other restrict pointers of the function */
+    context = LLVMGetModuleContext(ctx->module);
+
+    LLVMSetMetadata(access,
+                    LLVMGetMDKindIDInContext(context, "alias.scope", 11),
+                    symbol->generated_alias_scope);
+    LLVMSetMetadata(access, LLVMGetMDKindIDInContext(context, "noalias", 7),
+                    symbol->generated_noalias);
+}
+
 LLVMValueRef generate_identifier_expr(GeneratorContext *ctx,
                                       IdentifierNode *p) {
     assert(p->symbol->generated_location != NULL);
@@ -187,6 +266,7 @@ LLVMValueRef generate_postfix_expr(GeneratorContext *ctx, PostfixNode *p) {
     case token_decrement:
         operand = generate_expr_addr(ctx, p->operand);
         value = LLVMBuildLoad(ctx->builder, operand, "load");
+        generate_alias_metadata(ctx, value, p->operand);
         type = LLVMTypeOf(value);
         one = LLVMConstInt(type, 1, false);
 
@@ -205,7 +285,8 @@ LLVMValueRef generate_postfix_expr(GeneratorContext *ctx, PostfixNode *p) {
             exit(1);
         }
 
-        LLVMBuildStore(ctx->builder, result, operand);
+        generate_alias_metadata(
+            ctx, LLVMBuildStore(ctx->builder, result, operand), p->operand);
         return value;
 
     default:
@@ -214,11 +295,181 @@ LLVMValueRef generate_postfix_expr(GeneratorContext *ctx, PostfixNode *p) {
     }
 }
 
+LLVMValueRef generate_intrinsic(GeneratorContext *ctx, const char *name,
+                                LLVMTypeRef type) {
+    assert(ctx != NULL);
+    assert(name != NULL);
+    assert(type != NULL);
+
+    /* declaration of an intrinsic overloaded on a single type */
+    return LLVMGetIntrinsicDeclaration(
+        ctx->module, LLVMLookupIntrinsicID(name, strlen(name)), &type, 1);
+}
+
+LLVMValueRef generate_bit_count(GeneratorContext *ctx, CallNode *p,
+                                const char *name) {
+    LLVMValueRef args[2];
+    LLVMValueRef value;
+    int num_args;
+
+    assert(ctx != NULL);
+    assert(p != NULL);
+    assert(name != NULL);
+
+    args[0] = generate_expr(ctx, p->args[0]);
+    num_args = 1;
+
+    /* clz and ctz are undefined for zero like the builtins of gcc */
+    if (strcmp(name, "llvm.ctpop") != 0) {
+        args[1] = LLVMConstInt(LLVMInt1Type(), 1, false);
+        num_args = 2;
+    }
+
+    value = LLVMBuildCall(ctx->builder,
+                          generate_intrinsic(ctx, name, LLVMTypeOf(args[0])),
+                          args, num_args, "bits");
+
+    return LLVMBuildIntCast(ctx->builder, value, LLVMInt32Type(), "bits_i32");
+}
+
+LLVMValueRef generate_builtin_call(GeneratorContext *ctx, CallNode *p) {
+    LLVMValueRef function;
+    LLVMValueRef args[4];
+    LLVMValueRef value;
+    LLVMTypeRef ptr_type;
+
+    assert(ctx != NULL);
+    assert(p != NULL);
+
+    switch (p->builtin) {
+    case builtin_expect:
+        /* the hint is read by the branches using the call */
+        return generate_expr(ctx, p->args[0]);
+
+    case builtin_unreachable:
+        value = LLVMBuildUnreachable(ctx->builder);
+
+        /* code following the call is dead */
+        function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
+        LLVMPositionBuilderAtEnd(ctx->builder,
+                                 LLVMAppendBasicBlock(function, "dead"));
+        return value;
+
+    case builtin_prefetch:
+        /* (address, read or write, locality, data cache) */
+        ptr_type = LLVMPointerType(LLVMInt8Type(), 0);
+        args[0] = generate_expr(ctx, p->args[0]);
+        args[1] = LLVMConstInt(LLVMInt32Type(), 0, false);
+        args[2] = LLVMConstInt(LLVMInt32Type(), 3, false);
+        args[3] = LLVMConstInt(LLVMInt32Type(), 1, false);
+
+        if (p->num_args > 1) {
+            args[1] = generate_expr(ctx, p->args[1]);
+        }
+
+        if (p->num_args > 2) {
+            args[2] = generate_expr(ctx, p->args[2]);
+        }
+
+        return LLVMBuildCall(
+            ctx->builder, generate_intrinsic(ctx, "llvm.prefetch", ptr_type),
+            args, 4, "");
+
+    case builtin_memcpy:
+        args[0] = generate_expr(ctx, p->args[0]);
+        args[1] = generate_expr(ctx, p->args[1]);
+        args[2] = generate_expr(ctx, p->args[2]);
+        LLVMBuildMemCpy(ctx->builder, args[0], 1, args[1], 1, args[2]);
+        return args[0];
+
+    case builtin_memset:
+        args[0] = generate_expr(ctx, p->args[0]);
+        args[1] = generate_expr(ctx, p->args[1]);
+        args[2] = generate_expr(ctx, p->args[2]);
+        args[1] = LLVMBuildTrunc(ctx->builder, args[1], LLVMInt8Type(), "byte");
+        LLVMBuildMemSet(ctx->builder, args[0], args[1], args[2], 1);
+        return args[0];
+
+    case builtin_popcount:
+    case builtin_popcountl:
+        return generate_bit_count(ctx, p, "llvm.ctpop");
+
+    case builtin_clz:
+    case builtin_clzl:
+        return generate_bit_count(ctx, p, "llvm.ctlz");
+
+    case builtin_ctz:
+    case builtin_ctzl:
+        return generate_bit_count(ctx, p, "llvm.cttz");
+
+    case builtin_bswap32:
+    case builtin_bswap64:
+        args[0] = generate_expr(ctx, p->args[0]);
+        return LLVMBuildCall(
+            ctx->builder,
+            generate_intrinsic(ctx, "llvm.bswap", LLVMTypeOf(args[0])), args,
+            1, "bswap");
+
+    default:
+        fprintf(stderr, "unknown builtin %d\n", p->builtin);
+        exit(1);
+    }
+}
+
+void generate_branch_weights(GeneratorContext *ctx, LLVMValueRef branch,
+                             ExprNode *condition) {
+    CallNode *call;
+    LLVMContextRef context;
+    LLVMValueRef weights[3];
+    const char *name;
+    int likely;
+    int unlikely;
+
+    assert(ctx != NULL);
+    assert(branch != NULL);
+    assert(condition != NULL);
+
+    while (condition->kind == node_cast) {
+        condition = ((CastNode *)condition)->operand;
+    }
+
+    if (condition->kind != node_call ||
+        ((CallNode *)condition)->builtin != builtin_expect) {
+        return;
+    }
+
+    /* the expected value makes one successor far more likely */
+    call = (CallNode *)condition;
+    assert(call->args[1]->kind == node_integer);
+
+    likely = 2000;
+    unlikely = 1;
+
+    if (((IntegerNode *)call->args[1])->value == 0) {
+        likely = 1;
+        unlikely = 2000;
+    }
+
+    context = LLVMGetModuleContext(ctx->module);
+    name = "branch_weights";
+
+    weights[0] = LLVMMDStringInContext(context, name, strlen(name));
+    weights[1] = LLVMConstInt(LLVMInt32Type(), likely, false);
+    weights[2] = LLVMConstInt(LLVMInt32Type(), unlikely, false);
+
+    LLVMSetMetadata(branch, LLVMGetMDKindIDInContext(context, "prof", 4),
+                    LLVMMDNodeInContext(context, weights, 3));
+}
+
 LLVMValueRef generate_call_expr(GeneratorContext *ctx, CallNode *p) {
     LLVMValueRef callee;
     LLVMValueRef *args;
     int i;
 
+    if (p->builtin != 0) {
+        return generate_builtin_call(ctx, p);
+    }
+
     callee = generate_expr(ctx, p->callee);
 
     args = malloc(sizeof(LLVMValueRef) * p->num_args);
@@ -252,7 +503,9 @@ LLVMValueRef generate_unary_expr(GeneratorContext *ctx, UnaryNode *p) {
 
     case '*':
         operand = generate_expr(ctx, p->operand);
-        return LLVMBuildLoad(ctx->builder, operand, "deref");
+        value = LLVMBuildLoad(ctx->builder, operand, "deref");
+        generate_alias_metadata(ctx, value, (ExprNode *)p);
+        return value;
 
     case '&':
         return generate_expr_addr(ctx, p->operand);
@@ -266,6 +519,7 @@ LLVMValueRef generate_unary_expr(GeneratorContext *ctx, UnaryNode *p) {
     case token_decrement:
         operand = generate_expr_addr(ctx, p->operand);
         value = LLVMBuildLoad(ctx->builder, operand, "load");
+        generate_alias_metadata(ctx, value, p->operand);
         type = LLVMTypeOf(value);
         one = LLVMConstInt(type, 1, false);
 
@@ -284,7 +538,8 @@ LLVMValueRef generate_unary_expr(GeneratorContext *ctx, UnaryNode *p) {
             exit(1);
         }
 
-        LLVMBuildStore(ctx->builder, value, operand);
+        generate_alias_metadata(
+            ctx, LLVMBuildStore(ctx->builder, value, operand), p->operand);
         return value;
 
     default:
@@ -317,7 +572,8 @@ LLVMValueRef generate_cast_expr(GeneratorContext *ctx, CastNode *p) {
             return src;
 
         case type_int32:
-            /* int32 -> int8 */
+        case type_int64:
+            /* int32 or int64 -> int8 */
             return LLVMBuildTrunc(ctx->builder, src, dest_type, "trunc");
 
         case type_pointer:
@@ -342,6 +598,10 @@ LLVMValueRef generate_cast_expr(GeneratorContext *ctx, CastNode *p) {
             /* int32 -> int32 */
             return src;
 
+        case type_int64:
+            /* int64 -> int32 */
+            return LLVMBuildTrunc(ctx->builder, src, dest_type, "trunc");
+
         case type_pointer:
             /* T* -> int32 */
             return LLVMBuildPtrToInt(ctx->builder, src, dest_type,
@@ -352,11 +612,36 @@ LLVMValueRef generate_cast_expr(GeneratorContext *ctx, CastNode *p) {
         }
         break;
 
+    case type_int64:
+        /* T -> int64 */
+        src = generate_expr(ctx, p->operand);
+
+        switch (p->operand->type->kind) {
+        case type_int8:
+        case type_int32:
+            /* int8 or int32 -> int64 */
+            return LLVMBuildSExt(ctx->builder, src, dest_type, "sext");
+
+        case type_int64:
+            /* int64 -> int64 */
+            return src;
+
+        case type_pointer:
+            /* T* -> int64 */
+            return LLVMBuildPtrToInt(ctx->builder, src, dest_type,
+                                     "ptrtoint64");
+
+        default:
+            break;
+        }
+        break;
+
     case type_pointer:
         /* U -> T* */
         switch (p->operand->type->kind) {
         case type_int8:
         case type_int32:
+        case type_int64:
             /* intN -> T* */
             src = generate_expr(ctx, p->operand);
             return LLVMBuildIntToPtr(ctx->builder, src, dest_type, "inttoptr");
@@ -412,8 +697,9 @@ LLVMValueRef generate_cast_expr(GeneratorContext *ctx, CastNode *p) {
     exit(1);
 }
 
-LLVMValueRef generate_binary_expr(GeneratorContext *ctx, BinaryNode *p) {
-    LLVMValueRef left;
+/* applies the operator of p to left, the already generated left operand */
+LLVMValueRef generate_binary_operation(GeneratorContext *ctx, BinaryNode *p,
+                                       LLVMValueRef left) {
     LLVMValueRef right;
 
     LLVMValueRef cmp;
@@ -430,7 +716,6 @@ LLVMValueRef generate_binary_expr(GeneratorContext *ctx, BinaryNode *p) {
         merge_basic_block = LLVMAppendBasicBlock(function, "andmerge");
 
         /* left hand side */
-        left = generate_expr(ctx, p->left);
         left = LLVMBuildIsNotNull(ctx->builder, left, "andleft");
 
         LLVMBuildCondBr(ctx->builder, left, rhs_basic_block, merge_basic_block);
@@ -462,7 +747,6 @@ LLVMValueRef generate_binary_expr(GeneratorContext *ctx, BinaryNode *p) {
         merge_basic_block = LLVMAppendBasicBlock(function, "ormerge");
 
         /* left hand side */
-        left = generate_expr(ctx, p->left);
         left = LLVMBuildIsNotNull(ctx->builder, left, "orleft");
 
         LLVMBuildCondBr(ctx->builder, left, merge_basic_block, rhs_basic_block);
@@ -487,22 +771,10 @@ LLVMValueRef generate_binary_expr(GeneratorContext *ctx, BinaryNode *p) {
 
         return LLVMBuildZExt(ctx->builder, cmp, LLVMInt32Type(), "or");
 
-    case '=':
-        right = generate_expr(ctx, p->right);
-        left = generate_expr_addr(ctx, p->left);
-
-        LLVMBuildStore(ctx->builder, right, left);
-        return right;
-
-    case '[':
-        left = generate_expr_addr(ctx, (ExprNode *)p);
-        return LLVMBuildLoad(ctx->builder, left, "index");
-
     default:
         break;
     }
 
-    left = generate_expr(ctx, p->left);
     right = generate_expr(ctx, p->right);
 
     switch (p->operator_) {
@@ -523,9 +795,7 @@ LLVMValueRef generate_binary_expr(GeneratorContext *ctx, BinaryNode *p) {
     case '-':
         if (is_pointer_type(p->left->type) && is_pointer_type(p->right->type)) {
             /* T* - T* -> ptrdiff_t */
-            left = LLVMBuildPtrDiff(ctx->builder, left, right, "ptrdiff");
-            return LLVMBuildTrunc(ctx->builder, left, LLVMInt32Type(),
-                                  "ptrdiff_i32");
+            return LLVMBuildPtrDiff(ctx->builder, left, right, "ptrdiff");
         } else if (is_pointer_type(p->left->type)) {
             /* T* - int -> T* */
             right = LLVMBuildNeg(ctx->builder, right, "negidx");
@@ -614,6 +884,52 @@ LLVMValueRef generate_binary_expr(GeneratorContext *ctx, BinaryNode *p) {
     }
 }
 
+LLVMValueRef generate_binary_expr(GeneratorContext *ctx, BinaryNode *p) {
+    SmallVec chain;
+    ExprNode *operand;
+    LLVMValueRef left;
+    LLVMValueRef right;
+
+    switch (p->operator_) {
+    case '=':
+        right = generate_expr(ctx, p->right);
+        left = generate_expr_addr(ctx, p->left);
+
+        generate_alias_metadata(
+            ctx, LLVMBuildStore(ctx->builder, right, left), p->left);
+        return right;
+
+    case '[':
+        left = generate_expr_addr(ctx, (ExprNode *)p);
+        right = LLVMBuildLoad(ctx->builder, left, "index");
+        generate_alias_metadata(ctx, right, (ExprNode *)p);
+        return right;
+
+    default:
+        break;
+    }
+
+    /* a left associative chain such as a + b + c is walked down its left
+       operands, then lowered from the innermost operator without recursion */
+    small_vec_init(&chain);
+    operand = (ExprNode *)p;
+
+    while (operand->kind == node_binary &&
+           ((BinaryNode *)operand)->operator_ != '=' &&
+           ((BinaryNode *)operand)->operator_ != '[') {
+        small_vec_push(&chain, operand);
+        operand = ((BinaryNode *)operand)->left;
+    }
+
+    left = generate_expr(ctx, operand);
+
+    while (chain.size > 0) {
+        left = generate_binary_operation(ctx, small_vec_pop(&chain), left);
+    }
+
+    return left;
+}
+
 LLVMValueRef generate_dot_expr(GeneratorContext *ctx, DotNode *p) {
     LLVMValueRef parent;
 
@@ -776,28 +1092,44 @@ bool generate_if_stmt(GeneratorContext *ctx, IfNode *p) {
 
     LLVMValueRef condition;
     LLVMValueRef bool_condition;
+    LLVMValueRef branch;
 
     function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
-    then_basic_block = LLVMAppendBasicBlock(function, "then");
-    else_basic_block = LLVMAppendBasicBlock(function, "else");
-    endif_basic_block = LLVMAppendBasicBlock(function, "endif");
+    endif_basic_block = NULL;
 
-    /* condition */
-    condition = generate_expr(ctx, p->condition);
-    bool_condition = LLVMBuildIsNotNull(ctx->builder, condition, "cond");
+    /* an else if cascade is lowered in a loop, sharing one end block */
+    while (1) {
+        then_basic_block = LLVMAppendBasicBlock(function, "then");
+        else_basic_block = LLVMAppendBasicBlock(function, "else");
+
+        if (endif_basic_block == NULL) {
+            endif_basic_block = LLVMAppendBasicBlock(function, "endif");
+        }
 
-    LLVMBuildCondBr(ctx->builder, bool_condition, then_basic_block,
-                    else_basic_block);
+        /* condition */
+        condition = generate_expr(ctx, p->condition);
+        bool_condition = LLVMBuildIsNotNull(ctx->builder, condition, "cond");
 
-    /* then */
-    LLVMPositionBuilderAtEnd(ctx->builder, then_basic_block);
+        branch = LLVMBuildCondBr(ctx->builder, bool_condition,
+                                 then_basic_block, else_basic_block);
+        generate_branch_weights(ctx, branch, p->condition);
 
-    if (!generate_stmt(ctx, p->then)) {
-        LLVMBuildBr(ctx->builder, endif_basic_block);
-    }
+        /* then */
+        LLVMPositionBuilderAtEnd(ctx->builder, then_basic_block);
 
-    /* else */
-    LLVMPositionBuilderAtEnd(ctx->builder, else_basic_block);
+        if (!generate_stmt(ctx, p->then)) {
+            LLVMBuildBr(ctx->builder, endif_basic_block);
+        }
+
+        /* else */
+        LLVMPositionBuilderAtEnd(ctx->builder, else_basic_block);
+
+        if (p->else_ == NULL || p->else_->kind != node_if) {
+            break;
+        }
+
+        p = (IfNode *)p->else_;
+    }
 
     if (p->else_ == NULL || !generate_stmt(ctx, p->else_)) {
         LLVMBuildBr(ctx->builder, endif_basic_block);
@@ -809,8 +1141,257 @@ bool generate_if_stmt(GeneratorContext *ctx, IfNode *p) {
     return false;
 }
 
-bool generate_switch_stmt(GeneratorContext *ctx, SwitchNode *p) {
+LLVMBasicBlockRef switch_case_destination(SwitchNode *p,
+                                          LLVMBasicBlockRef *case_basic_blocks,
+                                          LLVMBasicBlockRef default_basic_block,
+                                          int index) {
+    assert(p != NULL);
+    assert(case_basic_blocks != NULL);
+    assert(default_basic_block != NULL);
+
+    /* empty case labels fall through to the next label */
+    while (index < p->num_cases &&
+           ((CompoundNode *)p->cases[index])->num_stmts == 0) {
+        index++;
+    }
+
+    if (index == p->num_cases) {
+        return default_basic_block;
+    }
+
+    return case_basic_blocks[index];
+}
+
+void generate_switch_linear(GeneratorContext *ctx, LLVMValueRef condition,
+                            long *values, LLVMBasicBlockRef *destinations,
+                            int begin, int end,
+                            LLVMBasicBlockRef default_basic_block) {
+    LLVMValueRef function;
+    LLVMValueRef cmp;
+    LLVMBasicBlockRef next_basic_block;
+    int i;
+
+    function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
+
+    for (i = begin; i < end; i++) {
+        if (i == end - 1) {
+            next_basic_block = default_basic_block;
+        } else {
+            next_basic_block = LLVMAppendBasicBlock(function, "switch.next");
+        }
+
+        cmp = LLVMBuildICmp(
+            ctx->builder, LLVMIntEQ, condition,
+            LLVMConstInt(LLVMTypeOf(condition), values[i], true), "switch.cmp");
+        LLVMBuildCondBr(ctx->builder, cmp, destinations[i], next_basic_block);
+
+        LLVMPositionBuilderAtEnd(ctx->builder, next_basic_block);
+    }
+}
+
+void generate_switch_binary_search(GeneratorContext *ctx,
+                                   LLVMValueRef condition, long *values,
+                                   LLVMBasicBlockRef *destinations, int begin,
+                                   int end,
+                                   LLVMBasicBlockRef default_basic_block) {
+    LLVMValueRef function;
+    LLVMValueRef cmp;
+    LLVMBasicBlockRef lower_basic_block;
+    LLVMBasicBlockRef upper_basic_block;
+    int middle;
+
+    if (end - begin <= switch_linear_max_cases) {
+        generate_switch_linear(ctx, condition, values, destinations, begin, end,
+                               default_basic_block);
+        return;
+    }
+
+    function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
+    lower_basic_block = LLVMAppendBasicBlock(function, "switch.lower");
+    upper_basic_block = LLVMAppendBasicBlock(function, "switch.upper");
+
+    /* condition < values[middle] ? [begin, middle) : [middle, end) */
+    middle = begin + (end - begin) / 2;
+
+    cmp = LLVMBuildICmp(
+        ctx->builder, LLVMIntSLT, condition,
+        LLVMConstInt(LLVMTypeOf(condition), values[middle], true), "switch.lt");
+    LLVMBuildCondBr(ctx->builder, cmp, lower_basic_block, upper_basic_block);
+
+    LLVMPositionBuilderAtEnd(ctx->builder, lower_basic_block);
+    generate_switch_binary_search(ctx, condition, values, destinations, begin,
+                                  middle, default_basic_block);
+
+    LLVMPositionBuilderAtEnd(ctx->builder, upper_basic_block);
+    generate_switch_binary_search(ctx, condition, values, destinations, middle,
+                                  end, default_basic_block);
+}
+
+void generate_switch_bit_test(GeneratorContext *ctx, LLVMValueRef condition,
+                              long *values, LLVMBasicBlockRef *destinations,
+                              int num_cases, LLVMBasicBlockRef *targets,
+                              int num_targets,
+                              LLVMBasicBlockRef default_basic_block) {
+    LLVMValueRef function;
+    LLVMValueRef offset;
+    LLVMValueRef in_range;
+    LLVMValueRef bit;
+    LLVMValueRef hit;
+    LLVMBasicBlockRef test_basic_block;
+    LLVMBasicBlockRef next_basic_block;
+    LLVMTypeRef type;
+    int range;
+    int mask;
+    int power;
+    int i;
+    int j;
+    int k;
+
+    function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
+    type = LLVMTypeOf(condition);
+    range = values[num_cases - 1] - values[0];
+
+    /* (unsigned)(condition - min) <= max - min */
+    offset = LLVMBuildSub(ctx->builder, condition,
+                          LLVMConstInt(type, values[0], true), "switch.offset");
+    in_range =
+        LLVMBuildICmp(ctx->builder, LLVMIntULE, offset,
+                      LLVMConstInt(type, range, false), "switch.in_range");
+
+    test_basic_block = LLVMAppendBasicBlock(function, "switch.bits");
+    LLVMBuildCondBr(ctx->builder, in_range, test_basic_block,
+                    default_basic_block);
+
+    /* 1 << (condition - min) */
+    LLVMPositionBuilderAtEnd(ctx->builder, test_basic_block);
+    bit = LLVMBuildShl(ctx->builder, LLVMConstInt(type, 1, false), offset,
+                       "switch.bit");
+
+    /* one mask test per destination */
+    for (i = 0; i < num_targets; i++) {
+        mask = 0;
+
+        for (j = 0; j < num_cases; j++) {
+            if (destinations[j] != targets[i]) {
+                continue;
+            }
+
+            power = 1;
+            for (k = 0; k < values[j] - values[0]; k++) {
+                power = power * 2;
+            }
+
+            mask = mask | power;
+        }
+
+        if (i == num_targets - 1) {
+            next_basic_block = default_basic_block;
+        } else {
+            next_basic_block = LLVMAppendBasicBlock(function, "switch.next");
+        }
+
+        hit = LLVMBuildAnd(ctx->builder, bit,
+                           LLVMConstInt(type, mask, false), "switch.mask");
+        hit = LLVMBuildIsNotNull(ctx->builder, hit, "switch.hit");
+        LLVMBuildCondBr(ctx->builder, hit, targets[i], next_basic_block);
+
+        LLVMPositionBuilderAtEnd(ctx->builder, next_basic_block);
+    }
+}
+
+void generate_switch_jump_table(GeneratorContext *ctx, LLVMValueRef condition,
+                                long *values, LLVMBasicBlockRef *destinations,
+                                int num_cases,
+                                LLVMBasicBlockRef default_basic_block) {
     LLVMValueRef switch_;
+    int i;
+
+    /* dense switch instructions are lowered to jump tables by the backend */
+    switch_ = LLVMBuildSwitch(ctx->builder, condition, default_basic_block,
+                              num_cases);
+
+    for (i = 0; i < num_cases; i++) {
+        LLVMAddCase(switch_,
+                    LLVMConstInt(LLVMTypeOf(condition), values[i], true),
+                    destinations[i]);
+    }
+}
+
+void generate_switch_dispatch(GeneratorContext *ctx, SwitchNode *p,
+                              LLVMValueRef condition,
+                              LLVMBasicBlockRef *case_basic_blocks,
+                              LLVMBasicBlockRef default_basic_block) {
+    long *values;
+    LLVMBasicBlockRef *destinations;
+    LLVMBasicBlockRef *targets;
+    int num_targets;
+    int range;
+    int i;
+    int j;
+
+    if (p->num_cases == 0) {
+        LLVMBuildBr(ctx->builder, default_basic_block);
+        return;
+    }
+
+    /* case values and destinations sorted by value */
+    values = malloc(sizeof(long) * p->num_cases);
+    destinations = malloc(sizeof(LLVMBasicBlockRef) * p->num_cases);
+    targets = malloc(sizeof(LLVMBasicBlockRef) * p->num_cases);
+    num_targets = 0;
+
+    for (i = 0; i < p->num_cases; i++) {
+        values[i] = ((IntegerNode *)p->case_values[p->case_order[i]])->value;
+        destinations[i] =
+            switch_case_destination(p, case_basic_blocks, default_basic_block,
+                                    p->case_order[i]);
+
+        /* distinct destinations */
+        for (j = 0; j < num_targets; j++) {
+            if (targets[j] == destinations[i]) {
+                break;
+            }
+        }
+
+        if (j == num_targets) {
+            targets[num_targets] = destinations[i];
+            num_targets++;
+        }
+    }
+
+    /* the range does not fit in an int */
+    if ((values[0] < 0 && values[p->num_cases - 1] > INT_MAX + values[0]) ||
+        values[p->num_cases - 1] - values[0] > INT_MAX) {
+        range = -1;
+    } else {
+        range = values[p->num_cases - 1] - values[0];
+    }
+
+    if (p->num_cases <= switch_linear_max_cases) {
+        /* a few compares */
+        generate_switch_linear(ctx, condition, values, destinations, 0,
+                               p->num_cases, default_basic_block);
+    } else if (range >= 0 && range <= switch_bit_test_max_range &&
+               num_targets <= switch_bit_test_max_destinations) {
+        /* many values sharing a few destinations */
+        generate_switch_bit_test(ctx, condition, values, destinations,
+                                 p->num_cases, targets, num_targets,
+                                 default_basic_block);
+    } else if (range >= 0 && range < switch_jump_table_max_range &&
+               p->num_cases >= switch_jump_table_min_cases &&
+               p->num_cases * 100 >=
+                   (range + 1) * switch_jump_table_min_density) {
+        /* dense */
+        generate_switch_jump_table(ctx, condition, values, destinations,
+                                   p->num_cases, default_basic_block);
+    } else {
+        /* sparse */
+        generate_switch_binary_search(ctx, condition, values, destinations, 0,
+                                      p->num_cases, default_basic_block);
+    }
+}
+
+bool generate_switch_stmt(GeneratorContext *ctx, SwitchNode *p) {
     LLVMValueRef function;
     LLVMValueRef condition;
     LLVMBasicBlockRef *case_basic_blocks;
@@ -831,17 +1412,13 @@ bool generate_switch_stmt(GeneratorContext *ctx, SwitchNode *p) {
 
     /* condition */
     condition = generate_expr(ctx, p->condition);
-    switch_ = LLVMBuildSwitch(ctx->builder, condition, default_basic_block, 0);
+    generate_switch_dispatch(ctx, p, condition, case_basic_blocks,
+                             default_basic_block);
 
     push_break_target(ctx, endswitch_basic_block);
 
     /* case blocks */
     for (i = 0; i < p->num_cases; i++) {
-        /* case condition */
-        condition = generate_expr(ctx, p->case_values[i]);
-        LLVMAddCase(switch_, condition, case_basic_blocks[i]);
-
-        /* case block */
         LLVMPositionBuilderAtEnd(ctx->builder, case_basic_blocks[i]);
 
         if (!generate_stmt(ctx, p->cases[i])) {
@@ -871,18 +1448,126 @@ bool generate_switch_stmt(GeneratorContext *ctx, SwitchNode *p) {
     return false;
 }
 
+LLVMMetadataRef generate_loop_property(GeneratorContext *ctx, const char *name,
+                                       LLVMValueRef value) {
+    LLVMContextRef context;
+    LLVMMetadataRef operands[2];
+    int num_operands;
+
+    assert(ctx != NULL);
+    assert(name != NULL);
+
+    context = LLVMGetModuleContext(ctx->module);
+
+    operands[0] = LLVMMDStringInContext2(context, name, strlen(name));
+    num_operands = 1;
+
+    if (value != NULL) {
+        operands[1] = LLVMValueAsMetadata(value);
+        num_operands = 2;
+    }
+
+    return LLVMMDNodeInContext2(context, operands, num_operands);
+}
+
+void generate_loop_metadata(GeneratorContext *ctx, LLVMValueRef latch,
+                            LoopHints *hints) {
+    LLVMContextRef context;
+    LLVMMetadataRef properties[8];
+    LLVMMetadataRef loop;
+    int n;
+
+    assert(ctx != NULL);
+    assert(latch != NULL);
+    assert(hints != NULL);
+
+    /* properties of the loop, after the reference to itself */
+    n = 1;
+
+    if ((hints->hints & loop_hint_mustprogress) != 0) {
+        properties[n] =
+            generate_loop_property(ctx, "llvm.loop.mustprogress", NULL);
+        n++;
+    }
+
+    if ((hints->hints & loop_hint_unroll_full) != 0) {
+        properties[n] =
+            generate_loop_property(ctx, "llvm.loop.unroll.full", NULL);
+        n++;
+    } else if (hints->unroll_count != 0) {
+        properties[n] = generate_loop_property(
+            ctx, "llvm.loop.unroll.count",
+            LLVMConstInt(LLVMInt32Type(), hints->unroll_count, false));
+        n++;
+    } else if ((hints->hints & loop_hint_unroll) != 0) {
+        properties[n] =
+            generate_loop_property(ctx, "llvm.loop.unroll.enable", NULL);
+        n++;
+    }
+
+    if ((hints->hints & loop_hint_nounroll) != 0) {
+        properties[n] =
+            generate_loop_property(ctx, "llvm.loop.unroll.disable", NULL);
+        n++;
+    }
+
+    if ((hints->hints & loop_hint_vectorize) != 0) {
+        properties[n] = generate_loop_property(
+            ctx, "llvm.loop.vectorize.enable",
+            LLVMConstInt(LLVMInt1Type(), 1, false));
+        n++;
+    }
+
+    /* a vectorization width of 1 disables the vectorizer */
+    if ((hints->hints & loop_hint_novectorize) != 0) {
+        properties[n] = generate_loop_property(
+            ctx, "llvm.loop.vectorize.width",
+            LLVMConstInt(LLVMInt32Type(), 1, false));
+        n++;
+    } else if (hints->vectorize_width != 0) {
+        properties[n] = generate_loop_property(
+            ctx, "llvm.loop.vectorize.width",
+            LLVMConstInt(LLVMInt32Type(), hints->vectorize_width, false));
+        n++;
+    }
+
+    if (hints->interleave_count != 0) {
+        properties[n] = generate_loop_property(
+            ctx, "llvm.loop.interleave.count",
+            LLVMConstInt(LLVMInt32Type(), hints->interleave_count, false));
+        n++;
+    }
+
+    if (n == 1) {
+        return;
+    }
+
+    /* the loop id is a distinct node whose first operand is itself */
+    context = LLVMGetModuleContext(ctx->module);
+
+    properties[0] = LLVMTemporaryMDNode(context, NULL, 0);
+    loop = LLVMMDNodeInContext2(context, properties, n);
+    LLVMMetadataReplaceAllUsesWith(properties[0], loop);
+
+    LLVMSetMetadata(latch, LLVMGetMDKindIDInContext(context, "llvm.loop", 9),
+                    LLVMMetadataAsValue(context, loop));
+}
+
 bool generate_while_stmt(GeneratorContext *ctx, WhileNode *p) {
     LLVMValueRef function;
     LLVMBasicBlockRef condition_basic_block;
     LLVMBasicBlockRef body_basic_block;
+    LLVMBasicBlockRef continuation_basic_block;
     LLVMBasicBlockRef endwhile_basic_block;
 
     LLVMValueRef condition;
     LLVMValueRef bool_condition;
+    LLVMValueRef branch;
 
     function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
     condition_basic_block = LLVMAppendBasicBlock(function, "cond");
     body_basic_block = LLVMAppendBasicBlock(function, "body");
+    continuation_basic_block = LLVMAppendBasicBlock(function, "cont");
     endwhile_basic_block = LLVMAppendBasicBlock(function, "endwhile");
 
     LLVMBuildBr(ctx->builder, condition_basic_block);
@@ -893,22 +1578,29 @@ bool generate_while_stmt(GeneratorContext *ctx, WhileNode *p) {
     condition = generate_expr(ctx, p->condition);
     bool_condition = LLVMBuildIsNotNull(ctx->builder, condition, "cond");
 
-    LLVMBuildCondBr(ctx->builder, bool_condition, body_basic_block,
-                    endwhile_basic_block);
+    branch = LLVMBuildCondBr(ctx->builder, bool_condition, body_basic_block,
+                             endwhile_basic_block);
+    generate_branch_weights(ctx, branch, p->condition);
 
     /* body */
     LLVMPositionBuilderAtEnd(ctx->builder, body_basic_block);
 
     push_break_target(ctx, endwhile_basic_block);
-    push_continue_target(ctx, condition_basic_block);
+    push_continue_target(ctx, continuation_basic_block);
 
     if (!generate_stmt(ctx, p->body)) {
-        LLVMBuildBr(ctx->builder, condition_basic_block);
+        LLVMBuildBr(ctx->builder, continuation_basic_block);
     }
 
     pop_break_target(ctx);
     pop_continue_target(ctx);
 
+    /* continuation, the only back edge of the loop */
+    LLVMPositionBuilderAtEnd(ctx->builder, continuation_basic_block);
+
+    branch = LLVMBuildBr(ctx->builder, condition_basic_block);
+    generate_loop_metadata(ctx, branch, p->hints);
+
     /* end while */
     LLVMPositionBuilderAtEnd(ctx->builder, endwhile_basic_block);
 
@@ -923,6 +1615,7 @@ bool generate_do_stmt(GeneratorContext *ctx, DoNode *p) {
 
     LLVMValueRef condition;
     LLVMValueRef bool_condition;
+    LLVMValueRef branch;
 
     function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
     body_basic_block = LLVMAppendBasicBlock(function, "body");
@@ -950,8 +1643,10 @@ bool generate_do_stmt(GeneratorContext *ctx, DoNode *p) {
     condition = generate_expr(ctx, p->condition);
     bool_condition = LLVMBuildIsNotNull(ctx->builder, condition, "cond");
 
-    LLVMBuildCondBr(ctx->builder, bool_condition, body_basic_block,
-                    enddo_basic_block);
+    branch = LLVMBuildCondBr(ctx->builder, bool_condition, body_basic_block,
+                             enddo_basic_block);
+    generate_branch_weights(ctx, branch, p->condition);
+    generate_loop_metadata(ctx, branch, p->hints);
 
     /* end do */
     LLVMPositionBuilderAtEnd(ctx->builder, enddo_basic_block);
@@ -968,6 +1663,7 @@ bool generate_for_stmt(GeneratorContext *ctx, ForNode *p) {
 
     LLVMValueRef condition;
     LLVMValueRef bool_condition;
+    LLVMValueRef branch;
 
     function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
     condition_basic_block = LLVMAppendBasicBlock(function, "cond");
@@ -991,8 +1687,9 @@ bool generate_for_stmt(GeneratorContext *ctx, ForNode *p) {
             LLVMBuildICmp(ctx->builder, LLVMIntNE, condition,
                           LLVMConstNull(LLVMTypeOf(condition)), "cond");
 
-        LLVMBuildCondBr(ctx->builder, bool_condition, body_basic_block,
-                        endfor_basic_block);
+        branch = LLVMBuildCondBr(ctx->builder, bool_condition,
+                                 body_basic_block, endfor_basic_block);
+        generate_branch_weights(ctx, branch, p->condition);
     } else {
         LLVMBuildBr(ctx->builder, body_basic_block);
     }
@@ -1017,7 +1714,8 @@ bool generate_for_stmt(GeneratorContext *ctx, ForNode *p) {
         generate_expr(ctx, p->continuation);
     }
 
-    LLVMBuildBr(ctx->builder, condition_basic_block);
+    branch = LLVMBuildBr(ctx->builder, condition_basic_block);
+    generate_loop_metadata(ctx, branch, p->hints);
 
     /* end for */
     LLVMPositionBuilderAtEnd(ctx->builder, endfor_basic_block);
@@ -1116,6 +1814,19 @@ void generate_extern_variable(GeneratorContext *ctx, ExternNode *p) {
     }
 }
 
+void generate_linkage(LLVMValueRef global, VariableSymbol *symbol) {
+    assert(global != NULL);
+    assert(symbol != NULL);
+
+    /* static definitions are local to the module, and an unused inline
+       function may be dropped */
+    if ((symbol->specifiers & specifier_static) != 0) {
+        LLVMSetLinkage(global, LLVMInternalLinkage);
+    } else if ((symbol->specifiers & specifier_inline) != 0) {
+        LLVMSetLinkage(global, LLVMLinkOnceODRLinkage);
+    }
+}
+
 void generate_global_variable(GeneratorContext *ctx, VariableNode *p) {
     VariableSymbol *symbol;
     LLVMTypeRef type;
@@ -1136,18 +1847,187 @@ void generate_global_variable(GeneratorContext *ctx, VariableNode *p) {
     }
 
     LLVMSetInitializer(symbol->generated_location, LLVMConstNull(type));
+    generate_linkage(symbol->generated_location, symbol);
+
+    if (symbol->alignment != 0) {
+        LLVMSetAlignment(symbol->generated_location, symbol->alignment);
+    }
 }
 
-LLVMValueRef generate_function(GeneratorContext *ctx, FunctionNode *p) {
+void generate_attribute(GeneratorContext *ctx, LLVMValueRef function,
+                        int index, const char *name) {
+    unsigned int kind;
+
+    assert(ctx != NULL);
+    assert(function != NULL);
+    assert(name != NULL);
+
+    kind = LLVMGetEnumAttributeKindForName(name, strlen(name));
+    assert(kind != 0);
+
+    LLVMAddAttributeAtIndex(
+        function, index,
+        LLVMCreateEnumAttribute(LLVMGetModuleContext(ctx->module), kind, 0));
+}
+
+void generate_function_attributes(GeneratorContext *ctx,
+                                  LLVMValueRef function, FunctionNode *p) {
     VariableSymbol *symbol;
-    LLVMTypeRef func_type;
-    LLVMTypeRef return_type;
-    LLVMTypeRef *param_types;
-    LLVMValueRef function;
-    LLVMBasicBlockRef entry_basic_block;
+    VariableSymbol *param;
+    int i;
 
-    bool is_terminated;
+    assert(ctx != NULL);
+    assert(function != NULL);
+    assert(p != NULL);
+
+    symbol = (VariableSymbol *)p->symbol;
+
+    if ((symbol->attributes & attribute_always_inline) != 0) {
+        generate_attribute(ctx, function, LLVMAttributeFunctionIndex,
+                           "alwaysinline");
+    }
+
+    if ((symbol->attributes & attribute_noinline) != 0) {
+        generate_attribute(ctx, function, LLVMAttributeFunctionIndex,
+                           "noinline");
+    }
+
+    if ((symbol->attributes & attribute_hot) != 0) {
+        generate_attribute(ctx, function, LLVMAttributeFunctionIndex, "hot");
+    }
+
+    if ((symbol->attributes & attribute_cold) != 0) {
+        generate_attribute(ctx, function, LLVMAttributeFunctionIndex, "cold");
+    }
+
+    /* const functions read no memory and pure functions only read it */
+    if ((symbol->attributes & attribute_const) != 0) {
+        generate_attribute(ctx, function, LLVMAttributeFunctionIndex,
+                           "readnone");
+    } else if ((symbol->attributes & attribute_pure) != 0) {
+        generate_attribute(ctx, function, LLVMAttributeFunctionIndex,
+                           "readonly");
+    }
+
+    if ((symbol->attributes & attribute_noreturn) != 0) {
+        generate_attribute(ctx, function, LLVMAttributeFunctionIndex,
+                           "noreturn");
+    }
+
+    /* the memory malloc returns is not aliased */
+    if ((symbol->attributes & attribute_malloc) != 0) {
+        generate_attribute(ctx, function, LLVMAttributeReturnIndex, "noalias");
+    }
+
+    for (i = 0; i < p->num_params; i++) {
+        param = (VariableSymbol *)p->params[i]->symbol;
+
+        if ((param->attributes & attribute_nonnull) != 0) {
+            generate_attribute(ctx, function, i + 1, "nonnull");
+        }
+
+        if (is_restrict_pointer_type(param->type)) {
+            generate_attribute(ctx, function, i + 1, "noalias");
+        }
+    }
+
+    if (symbol->alignment != 0) {
+        LLVMSetAlignment(function, symbol->alignment);
+    }
+}
+
+void generate_alias_scopes(GeneratorContext *ctx, FunctionNode *p) {
+    LLVMContextRef context;
+    SmallVec symbols;
+    VariableSymbol *symbol;
+    StmtNode *stmt;
+    DeclNode *decl;
+    LLVMValueRef *scopes;
+    LLVMValueRef *others;
+    LLVMValueRef domain[1];
+    LLVMValueRef scope[2];
+    const char *name;
     int i;
+    int j;
+    int k;
+
+    assert(ctx != NULL);
+    assert(p != NULL);
+    assert(p->body != NULL);
+    assert(p->body->kind == node_compound);
+
+    /* restrict pointers live for the whole function. ones declared in
+       inner blocks may point elsewhere on each entry, and are left out */
+    small_vec_init(&symbols);
+
+    for (i = 0; i < p->num_params; i++) {
+        if (is_restrict_pointer_type(p->params[i]->symbol->type)) {
+            small_vec_push(&symbols, p->params[i]->symbol);
+        }
+    }
+
+    for (i = 0; i < ((CompoundNode *)p->body)->num_stmts; i++) {
+        stmt = ((CompoundNode *)p->body)->stmts[i];
+
+        if (stmt->kind != node_decl) {
+            continue;
+        }
+
+        decl = ((DeclStmtNode *)stmt)->decl;
+
+        if (decl != NULL && decl->kind == node_variable &&
+            is_restrict_pointer_type(decl->symbol->type)) {
+            small_vec_push(&symbols, decl->symbol);
+        }
+    }
+
+    /* a single restrict pointer has nothing to be told apart from */
+    if (symbols.size < 2) {
+        return;
+    }
+
+    /* a scope per pointer in a domain of the function */
+    context = LLVMGetModuleContext(ctx->module);
+    name = p->symbol->identifier;
+
+    domain[0] = LLVMMDStringInContext(context, name, strlen(name));
+    scope[1] = LLVMMDNodeInContext(context, domain, 1);
+
+    scopes = malloc(sizeof(LLVMValueRef) * symbols.size);
+    others = malloc(sizeof(LLVMValueRef) * symbols.size);
+
+    for (i = 0; i < symbols.size; i++) {
+        symbol = symbols.data[i];
+        name = str_cat_n(p->symbol->identifier,
+                         strlen(p->symbol->identifier), ": ", 2);
+        name = str_cat_n(name, strlen(name), symbol->identifier,
+                         strlen(symbol->identifier));
+
+        scope[0] = LLVMMDStringInContext(context, name, strlen(name));
+        scopes[i] = LLVMMDNodeInContext(context, scope, 2);
+    }
+
+    for (i = 0; i < symbols.size; i++) {
+        symbol = symbols.data[i];
+        k = 0;
+
+        for (j = 0; j < symbols.size; j++) {
+            if (j != i) {
+                others[k] = scopes[j];
+                k++;
+            }
+        }
+
+        symbol->generated_alias_scope =
+            LLVMMDNodeInContext(context, &scopes[i], 1);
+        symbol->generated_noalias = LLVMMDNodeInContext(context, others, k);
+    }
+}
+
+LLVMValueRef generate_function_decl(GeneratorContext *ctx, FunctionNode *p) {
+    VariableSymbol *symbol;
+    LLVMTypeRef func_type;
+    LLVMValueRef function;
 
     assert(ctx != NULL);
     assert(p != NULL);
@@ -1158,9 +2038,6 @@ LLVMValueRef generate_function(GeneratorContext *ctx, FunctionNode *p) {
 
     /* build LLVM function type */
     func_type = generate_type(ctx, symbol->type);
-    return_type = LLVMGetReturnType(func_type);
-    param_types = malloc(sizeof(LLVMTypeRef) * LLVMCountParamTypes(func_type));
-    LLVMGetParamTypes(func_type, param_types);
 
     /* find function */
     function = LLVMGetNamedFunction(ctx->module, symbol->identifier);
@@ -1177,10 +2054,37 @@ LLVMValueRef generate_function(GeneratorContext *ctx, FunctionNode *p) {
 
     symbol->generated_location = function;
 
+    generate_function_attributes(ctx, function, p);
+
+    return function;
+}
+
+LLVMValueRef generate_function(GeneratorContext *ctx, FunctionNode *p) {
+    LLVMTypeRef func_type;
+    LLVMTypeRef return_type;
+    LLVMTypeRef *param_types;
+    LLVMValueRef function;
+    LLVMBasicBlockRef entry_basic_block;
+
+    bool is_terminated;
+    int i;
+
+    assert(ctx != NULL);
+    assert(p != NULL);
+
+    function = generate_function_decl(ctx, p);
+
     if (p->body == NULL) {
         return function;
     }
 
+    generate_linkage(function, (VariableSymbol *)p->symbol);
+
+    func_type = LLVMGetElementType(LLVMTypeOf(function));
+    return_type = LLVMGetReturnType(func_type);
+    param_types = malloc(sizeof(LLVMTypeRef) * LLVMCountParamTypes(func_type));
+    LLVMGetParamTypes(func_type, param_types);
+
     /* entry block */
     entry_basic_block = LLVMAppendBasicBlock(function, "entry");
     LLVMPositionBuilderAtEnd(ctx->builder, entry_basic_block);
@@ -1211,6 +2115,8 @@ LLVMValueRef generate_function(GeneratorContext *ctx, FunctionNode *p) {
             local_symbol->identifier);
     }
 
+    generate_alias_scopes(ctx, p);
+
     /* body */
     is_terminated = generate_stmt(ctx, p->body);
 
@@ -1242,7 +2148,7 @@ void generate_decl(GeneratorContext *ctx, DeclNode *p) {
         return;
 
     case node_function:
-        generate_function(ctx, (FunctionNode *)p);
+        generate_function_decl(ctx, (FunctionNode *)p);
         return;
 
     default:
@@ -1263,10 +2169,18 @@ LLVMModuleRef generate(TranslationUnitNode *p) {
     ctx.break_targets = vec_new();
     ctx.continue_targets = vec_new();
 
+    /* declarations first, so that every body sees every symbol */
     for (i = 0; i < p->num_decls; i++) {
         generate_decl(&ctx, p->decls[i]);
     }
 
+    /* function bodies */
+    for (i = 0; i < p->num_decls; i++) {
+        if (p->decls[i]->kind == node_function) {
+            generate_function(&ctx, (FunctionNode *)p->decls[i]);
+        }
+    }
+
     LLVMDisposeBuilder(ctx.builder);
 
     if (LLVMVerifyModule(ctx.module, LLVMReturnStatusAction, &error)) {
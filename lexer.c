@@ -1,14 +1,253 @@
 #include "nocc.h"
 
-typedef struct LexerContext {
-    char *filename;
-    char *src;
-    int index;
-    int line;
-} LexerContext;
+#define char_class_space 1      /* white space except '\n' */
+#define char_class_digit 2      /* [0-9] */
+#define char_class_identifier 4 /* [A-Z_a-z] */
+
+#define keyword_table_size 64
+
+/* filled once by lex_init_tables, then only read */
+bool lex_tables_initialized;
+char lex_char_classes[256];
+char *lex_keyword_texts[keyword_table_size];
+int lex_keyword_kinds[keyword_table_size];
+
+/* every identifier spelling seen so far. equal identifiers share one text
+   and one id, numbered from 1 */
+Vec *lex_names;      /* texts indexed by name id */
+int *lex_name_slots; /* open addressing table of name ids, 0 if empty */
+int lex_num_name_slots;
+
+int lex_keyword_hash(const char *text, int length) {
+    assert(text != NULL);
+    assert(length > 0);
+
+    /* perfect for the keywords below, search the coefficients again when
+       adding one */
+    return (length + text[0] * 12 + text[length - 1] * 7) % keyword_table_size;
+}
+
+void lex_add_keyword(char *text, int kind) {
+    int hash;
+
+    assert(text != NULL);
+
+    hash = lex_keyword_hash(text, strlen(text));
+
+    assert(lex_keyword_texts[hash] == NULL);
+
+    lex_keyword_texts[hash] = text;
+    lex_keyword_kinds[hash] = kind;
+}
+
+int lex_name_hash(const char *text, int length) {
+    int h;
+    int i;
+
+    /* same as str_hash, without the terminator */
+    h = 0;
+    for (i = 0; i < length; i++) {
+        h = (h * 31 + text[i] + 128) % 16777213;
+    }
+
+    return h;
+}
+
+void lex_rehash_names(int num_slots) {
+    char *text;
+    int slot;
+    int i;
+
+    assert(num_slots > 0);
+
+    lex_name_slots = malloc(sizeof(int) * num_slots);
+    lex_num_name_slots = num_slots;
+
+    for (i = 0; i < num_slots; i++) {
+        lex_name_slots[i] = 0;
+    }
+
+    for (i = 1; i < lex_names->size; i++) {
+        text = lex_names->data[i];
+        slot = lex_name_hash(text, strlen(text)) % num_slots;
+
+        while (lex_name_slots[slot] != 0) {
+            slot = (slot + 1) % num_slots;
+        }
+
+        lex_name_slots[slot] = i;
+    }
+}
+
+int lex_intern_name(const char *text, int length) {
+    char *name;
+    int slot;
+    int id;
+
+    assert(text != NULL);
+    assert(length >= 0);
+
+    if (lex_names == NULL) {
+        lex_names = vec_new();
+        vec_push(lex_names, NULL);
+        lex_rehash_names(1024);
+    }
+
+    slot = lex_name_hash(text, length) % lex_num_name_slots;
+
+    while (lex_name_slots[slot] != 0) {
+        id = lex_name_slots[slot];
+        name = lex_names->data[id];
+
+        if (name[length] == '\0' && memcmp(name, text, length) == 0) {
+            return id;
+        }
+
+        slot = (slot + 1) % lex_num_name_slots;
+    }
+
+    /* new name, the table is kept at most half full */
+    id = lex_names->size;
+    vec_push(lex_names, str_dup_n(text, length));
+
+    if (lex_names->size * 2 > lex_num_name_slots) {
+        lex_rehash_names(lex_num_name_slots * 2);
+    } else {
+        lex_name_slots[slot] = id;
+    }
+
+    return id;
+}
+
+int lex_name_id(const char *text) {
+    assert(text != NULL);
+
+    return lex_intern_name(text, strlen(text));
+}
+
+void lex_init_tables(void) {
+    int c;
+
+    if (lex_tables_initialized) {
+        return;
+    }
+
+    /* character classes */
+    /* ' ', '\t', '\v', '\f' and '\r', '\n' is a token of its own */
+    lex_char_classes[' '] = char_class_space;
+
+    for (c = 9; c <= 13; c++) {
+        if (c != '\n') {
+            lex_char_classes[c] = char_class_space;
+        }
+    }
+
+    for (c = '0'; c <= '9'; c++) {
+        lex_char_classes[c] = char_class_digit;
+    }
+
+    for (c = 'A'; c <= 'Z'; c++) {
+        lex_char_classes[c] = char_class_identifier;
+    }
+
+    for (c = 'a'; c <= 'z'; c++) {
+        lex_char_classes[c] = char_class_identifier;
+    }
+
+    lex_char_classes['_'] = char_class_identifier;
+
+    /* keywords */
+    lex_add_keyword("if", token_if);
+    lex_add_keyword("else", token_else);
+    lex_add_keyword("switch", token_switch);
+    lex_add_keyword("case", token_case);
+    lex_add_keyword("default", token_default);
+    lex_add_keyword("while", token_while);
+    lex_add_keyword("do", token_do);
+    lex_add_keyword("for", token_for);
+    lex_add_keyword("return", token_return);
+    lex_add_keyword("break", token_break);
+    lex_add_keyword("continue", token_continue);
+    lex_add_keyword("void", token_void);
+    lex_add_keyword("char", token_char);
+    lex_add_keyword("int", token_int);
+    lex_add_keyword("long", token_long);
+    lex_add_keyword("unsigned", token_unsigned);
+    lex_add_keyword("const", token_const);
+    lex_add_keyword("struct", token_struct);
+    lex_add_keyword("typedef", token_typedef);
+    lex_add_keyword("extern", token_extern);
+    lex_add_keyword("static", token_static);
+    lex_add_keyword("inline", token_inline);
+    lex_add_keyword("__attribute__", token_attribute);
+    lex_add_keyword("restrict", token_restrict);
+    lex_add_keyword("__restrict", token_restrict);
+    lex_add_keyword("__restrict__", token_restrict);
+    lex_add_keyword("sizeof", token_sizeof);
+
+    lex_tables_initialized = true;
+}
+
+static inline bool lex_is_space(char c) {
+    return (lex_char_classes[c & 255] & char_class_space) != 0;
+}
+
+static inline bool lex_is_digit(char c) {
+    return (lex_char_classes[c & 255] & char_class_digit) != 0;
+}
+
+static inline bool lex_is_identifier_head(char c) {
+    return (lex_char_classes[c & 255] & char_class_identifier) != 0;
+}
+
+static inline bool lex_is_identifier_tail(char c) {
+    return (lex_char_classes[c & 255] &
+            (char_class_identifier | char_class_digit)) != 0;
+}
+
+bool lex_integer_value(const char *text, long *value) {
+    char *end;
+
+    assert(text != NULL);
+    assert(value != NULL);
+
+    /* decimal, octal or hexadecimal digits. errno is left to the caller */
+    *value = strtol(text, &end, 0);
+
+    if (end == text) {
+        return false;
+    }
+
+    /* the u, l and ll suffixes do not change the value */
+    while (*end == 'u' || *end == 'U' || *end == 'l' || *end == 'L') {
+        end = end + 1;
+    }
+
+    return *end == '\0';
+}
+
+int lex_keyword(const char *text, int length) {
+    int hash;
+
+    assert(text != NULL);
+
+    if (length < 2) {
+        return 0;
+    }
+
+    /* a single comparison with the only candidate */
+    hash = lex_keyword_hash(text, length);
+
+    if (lex_keyword_texts[hash] == NULL ||
+        strcmp(lex_keyword_texts[hash], text) != 0) {
+        return 0;
+    }
+
+    return lex_keyword_kinds[hash];
+}
 
 Token *token_new_text(LexerContext *ctx, int kind, const char *text, int length,
-                      int line) {
+                      long start, int line) {
     Token *t;
 
     assert(ctx != NULL);
@@ -20,18 +259,46 @@ Token *token_new_text(LexerContext *ctx, int kind, const char *text, int length,
     t->text = str_dup_n(text, length);
     t->filename = ctx->filename;
     t->line = line;
+    t->location = ctx->location + start;
     t->string = NULL;
     t->len_string = 0;
+    t->keyword = 0;
+    t->name_id = 0;
+    t->hideset = NULL;
 
     return t;
 }
 
-Token *token_new(LexerContext *ctx, int kind, int start, int line) {
+Token *token_new(LexerContext *ctx, int kind, long start, int line) {
     return token_new_text(ctx, kind, ctx->src + start, ctx->index - start,
-                          line);
+                          start, line);
+}
+
+Token *identifier_token_new(LexerContext *ctx, long start, int line) {
+    Token *t;
+    int length;
+
+    assert(ctx != NULL);
+
+    length = ctx->index - start;
+
+    t = malloc(sizeof(*t));
+    t->kind = token_identifier;
+    t->name_id = lex_intern_name(ctx->src + start, length);
+    t->text = lex_names->data[t->name_id];
+    t->filename = ctx->filename;
+    t->line = line;
+    t->location = ctx->location + start;
+    t->string = NULL;
+    t->len_string = 0;
+    t->keyword = lex_keyword(t->text, length);
+    t->hideset = NULL;
+
+    return t;
 }
 
-Token *character_token_new(LexerContext *ctx, char c, int start, int line) {
+Token *character_token_new(LexerContext *ctx, char c, long start,
+                           int line) {
     Token *t;
 
     t = token_new(ctx, token_character, start, line);
@@ -41,21 +308,12 @@ Token *character_token_new(LexerContext *ctx, char c, int start, int line) {
     return t;
 }
 
-Token *string_token_new(LexerContext *ctx, Vec *chars, int start, int line) {
+Token *string_token_new(LexerContext *ctx, long start, int line) {
     Token *t;
-    int i;
-
-    assert(chars != NULL);
 
     t = token_new(ctx, token_string, start, line);
-    t->string = malloc(sizeof(char) * (chars->size + 1));
-    t->len_string = chars->size;
-
-    for (i = 0; i < t->len_string; i++) {
-        t->string[i] = (intptr_t)chars->data[i];
-    }
-
-    t->string[t->len_string] = '\0';
+    t->string = str_builder_dup(ctx->string_builder);
+    t->len_string = ctx->string_builder->size;
 
     return t;
 }
@@ -134,11 +392,76 @@ char parse_literal_char(LexerContext *ctx) {
     }
 }
 
+const char *lex_find_char(const char *p, const char *end, char c) {
+    if (p >= end) {
+        return NULL;
+    }
+
+    return memchr(p, c, end - p);
+}
+
+void lex_count_lines(LexerContext *ctx, const char *p, const char *end) {
+    assert(ctx != NULL);
+
+    while (1) {
+        p = lex_find_char(p, end, '\n');
+
+        if (p == NULL) {
+            return;
+        }
+
+        ctx->line++;
+        p = p + 1;
+    }
+}
+
+const char *lex_skip_comment(LexerContext *ctx, const char *p,
+                             const char *end) {
+    const char *q;
+
+    assert(ctx != NULL);
+
+    /* p points to just after the opening slash and star */
+    q = p;
+
+    while (1) {
+        q = lex_find_char(q, end, '*');
+
+        if (q == NULL) {
+            /* unterminated */
+            lex_count_lines(ctx, p, end);
+            return NULL;
+        }
+
+        if (q[1] == '/') {
+            lex_count_lines(ctx, p, q);
+            return q + 2;
+        }
+
+        q = q + 1;
+    }
+}
+
+long lex_span(LexerContext *ctx, const char *accept) {
+    long length;
+
+    assert(ctx != NULL);
+    assert(accept != NULL);
+
+    /* the C library scans runs with vector instructions where available */
+    length = strspn(ctx->src + ctx->index, accept);
+    ctx->index = ctx->index + length;
+
+    return length;
+}
+
 Token *lex_token(LexerContext *ctx) {
     assert(ctx != NULL);
 
     int line_start;
-    int start;
+    long start;
+    const char *end;
+    long length;
     char c;
 
     line_start = ctx->line;
@@ -151,41 +474,44 @@ Token *lex_token(LexerContext *ctx) {
     }
 
     /* separator */
-    if (isspace(c)) {
-        while (isspace(current_char(ctx)) && current_char(ctx) != '\n') {
-            consume_char(ctx);
+    if (lex_is_space(c)) {
+        /* most separators are a single space */
+        if (lex_is_space(current_char(ctx))) {
+            lex_span(ctx, ctx->space_chars);
         }
 
         return token_new(ctx, ' ', start, line_start);
     }
 
+    /* line splice */
+    if (c == '\\' && current_char(ctx) == '\n') {
+        consume_char(ctx); /* eat '\n' */
+        return token_new_text(ctx, ' ', " ", 1, start, line_start);
+    }
+
     /* comment */
     if (c == '/' && current_char(ctx) == '*') {
         consume_char(ctx); /* eat '*' */
 
-        while (true) {
-            c = consume_char(ctx);
+        end = lex_skip_comment(ctx, ctx->src + ctx->index,
+                               ctx->src + ctx->len_src);
 
-            if (c == '*' && current_char(ctx) == '/') {
-                break;
-            }
-
-            if (c == '\0') {
-                fprintf(stderr,
-                        "error at %s(%d): unterminated /* ... */ comment\n",
-                        ctx->filename, line_start);
-                exit(1);
-            }
+        if (end == NULL) {
+            fprintf(stderr,
+                    "error at %s(%d): unterminated /* ... */ comment\n",
+                    ctx->filename, line_start);
+            exit(1);
         }
 
-        consume_char(ctx); /* eat '/' */
-        return token_new_text(ctx, ' ', " ", 1, line_start);
+        ctx->index = end - ctx->src;
+        return token_new_text(ctx, ' ', " ", 1, start, line_start);
     }
 
     /* number */
-    if (isdigit(c)) {
-        /* [0-9]+ */
-        while (isdigit(current_char(ctx))) {
+    if (lex_is_digit(c)) {
+        /* preprocessing number: [0-9][0-9A-Za-z_.]* */
+        while (lex_is_identifier_tail(current_char(ctx)) ||
+               current_char(ctx) == '.') {
             consume_char(ctx);
         }
 
@@ -209,27 +535,46 @@ Token *lex_token(LexerContext *ctx) {
 
     /* string */
     if (c == '\"') {
-        Vec *chars;
-
         /* string literal contents */
-        chars = vec_new();
+        str_builder_clear(ctx->string_builder);
 
         while (current_char(ctx) != '\"') {
-            vec_push(chars, (void *)(intptr_t)parse_literal_char(ctx));
+            /* copy a run of plain characters at once */
+            length = strcspn(ctx->src + ctx->index, "\"\\\n");
+
+            str_builder_append_n(ctx->string_builder, ctx->src + ctx->index,
+                                 length);
+            ctx->index = ctx->index + length;
+
+            if (current_char(ctx) != '\"') {
+                str_builder_push(ctx->string_builder, parse_literal_char(ctx));
+            }
         }
 
         consume_char(ctx); /* eat " */
-        return string_token_new(ctx, chars, start, line_start);
+        return string_token_new(ctx, start, line_start);
     }
 
     /* identifier */
-    if (isalpha(c) || (c == '_')) {
-        /* [0-9A-Z_a-z]+ */
-        while (isalnum(current_char(ctx)) || (current_char(ctx) == '_')) {
+    if (lex_is_identifier_head(c)) {
+        /* [0-9A-Z_a-z]+, the runs are too short to pay for strspn */
+        while (lex_is_identifier_tail(current_char(ctx))) {
             consume_char(ctx);
         }
 
-        return token_new(ctx, token_identifier, start, line_start);
+        /* the preprocessor turns the identifier into the keyword unless it
+           is a macro name */
+        return identifier_token_new(ctx, start, line_start);
+    }
+
+    if (c == '<' && current_char(ctx) == '<') {
+        consume_char(ctx);
+        return token_new(ctx, token_left_shift, start, line_start);
+    }
+
+    if (c == '>' && current_char(ctx) == '>') {
+        consume_char(ctx);
+        return token_new(ctx, token_right_shift, start, line_start);
     }
 
     if (c == '<' && current_char(ctx) == '=') {
@@ -277,6 +622,11 @@ Token *lex_token(LexerContext *ctx) {
         return token_new(ctx, token_arrow, start, line_start);
     }
 
+    if (c == '#' && current_char(ctx) == '#') {
+        consume_char(ctx);
+        return token_new(ctx, token_hash_hash, start, line_start);
+    }
+
     if (c == '.' && current_char(ctx) == '.') {
         consume_char(ctx);
 
@@ -295,23 +645,153 @@ Token *lex_token(LexerContext *ctx) {
     return token_new(ctx, c, start, line_start);
 }
 
+const char *lex_find_comment_start(const char *p, const char *line_end) {
+    char quote;
+
+    assert(p != NULL);
+    assert(line_end != NULL);
+
+    /* the start of a comment, outside string and character literals */
+    while (p < line_end) {
+        if (*p == '"' || *p == '\'') {
+            quote = *p;
+            p = p + 1;
+
+            while (p < line_end && *p != quote) {
+                if (*p == '\\') {
+                    p = p + 1;
+                }
+
+                p = p + 1;
+            }
+
+            p = p + 1;
+        } else if (*p == '/' && p + 1 < line_end && p[1] == '/') {
+            return NULL;
+        } else if (*p == '/' && p + 1 < line_end && p[1] == '*') {
+            return p;
+        } else {
+            p = p + 1;
+        }
+    }
+
+    return NULL;
+}
+
+void lex_skip_text_lines(LexerContext *ctx) {
+    const char *p;
+    const char *end;
+    const char *line_end;
+    const char *slash;
+
+    assert(ctx != NULL);
+
+    /* skips whole lines up to the next line beginning with '#', without
+       making tokens; ctx must be at the beginning of a line */
+    p = ctx->src + ctx->index;
+    end = ctx->src + ctx->len_src;
+
+    while (p < end) {
+        while (lex_is_space(*p)) {
+            p = p + 1;
+        }
+
+        if (*p == '#') {
+            break;
+        }
+
+        line_end = lex_find_char(p, end, '\n');
+
+        if (line_end == NULL) {
+            line_end = end;
+        }
+
+        /* comments may span lines */
+        slash = lex_find_comment_start(p, line_end);
+
+        if (slash != NULL) {
+            p = lex_skip_comment(ctx, slash + 2, end);
+
+            if (p == NULL) {
+                /* left for the lexer to report */
+                p = end;
+            }
+            continue;
+        }
+
+        if (line_end == end) {
+            p = end;
+            break;
+        }
+
+        ctx->line++;
+        p = line_end + 1;
+    }
+
+    ctx->index = p - ctx->src;
+}
+
+LexerContext *lexer_new(const char *filename, const char *src) {
+    assert(filename != NULL);
+    assert(src != NULL);
+
+    return lexer_new_at(filename, src,
+                        source_register(filename, src, strlen(src)));
+}
+
+/* lexes src as if it were at location, without registering a source
+   buffer */
+LexerContext *lexer_new_at(const char *filename, const char *src,
+                           int location) {
+    LexerContext *ctx;
+    int length;
+    char c;
+
+    assert(filename != NULL);
+    assert(src != NULL);
+
+    lex_init_tables();
+
+    /* src must outlive the lexer, tokens own copies of their text */
+    ctx = malloc(sizeof(*ctx));
+    ctx->filename = str_dup(filename);
+    ctx->src = src;
+    ctx->len_src = strlen(src);
+    ctx->location = location;
+    ctx->index = 0;
+    ctx->line = 1;
+
+    /* character set for strspn */
+    ctx->space_chars = malloc(sizeof(char) * 6);
+    length = 0;
+
+    for (c = 1; c < 127; c++) {
+        if (lex_is_space(c)) {
+            ctx->space_chars[length] = c;
+            length++;
+        }
+    }
+
+    ctx->space_chars[length] = '\0';
+
+    ctx->string_builder = str_builder_new();
+
+    return ctx;
+}
+
 Vec *lex(const char *filename, const char *src) {
-    LexerContext ctx;
+    LexerContext *ctx;
     Token *t;
     Vec *tokens;
 
     assert(filename != NULL);
     assert(src != NULL);
 
-    ctx.filename = str_dup(filename);
-    ctx.src = str_dup(src);
-    ctx.index = 0;
-    ctx.line = 1;
-
+    ctx = lexer_new(filename, src);
     tokens = vec_new();
 
     do {
-        t = lex_token(&ctx);
+        t = lex_token(ctx);
         vec_push(tokens, t);
     } while (t->kind != '\0');
 
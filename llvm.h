@@ -5,23 +5,38 @@
 
 #include <llvm-c/Analysis.h>
 #include <llvm-c/Core.h>
+#include <llvm-c/DebugInfo.h>
 
 #else
 
 /* <llvm-c/Core.h> */
 #define LLVMIntEQ 32
 #define LLVMIntNE 33
+#define LLVMIntULE 37
 #define LLVMIntSGT 38
 #define LLVMIntSGE 39
 #define LLVMIntSLT 40
 #define LLVMIntSLE 41
 
+#define LLVMExternalLinkage 0
+#define LLVMLinkOnceODRLinkage 3
+#define LLVMInternalLinkage 8
+#define LLVMPrivateLinkage 9
+
+#define LLVMHiddenVisibility 1
+
+#define LLVMAttributeReturnIndex 0
+#define LLVMAttributeFunctionIndex -1
+
 typedef struct LLVMOpaqueContext *LLVMContextRef;
 typedef struct LLVMOpaqueBuilder *LLVMBuilderRef;
 typedef struct LLVMOpaqueModule *LLVMModuleRef;
 typedef struct LLVMOpaqueBasicBlock *LLVMBasicBlockRef;
 typedef struct LLVMOpaqueValue *LLVMValueRef;
 typedef struct LLVMOpaqueType *LLVMTypeRef;
+typedef struct LLVMOpaqueUse *LLVMUseRef;
+typedef struct LLVMOpaqueAttributeRef *LLVMAttributeRef;
+typedef struct LLVMOpaqueMetadata *LLVMMetadataRef;
 
 LLVMModuleRef LLVMModuleCreateWithName(const char *module_id);
 LLVMContextRef LLVMGetModuleContext(LLVMModuleRef module);
@@ -31,8 +46,51 @@ LLVMValueRef LLVMGetNamedGlobal(LLVMModuleRef module, const char *name);
 LLVMValueRef LLVMAddFunction(LLVMModuleRef module, const char *name,
                              LLVMTypeRef func_type);
 LLVMValueRef LLVMGetNamedFunction(LLVMModuleRef module, const char *name);
+LLVMModuleRef LLVMCloneModule(LLVMModuleRef module);
+const char *LLVMGetModuleIdentifier(LLVMModuleRef module,
+                                    unsigned long *length);
+int LLVMPrintModuleToFile(LLVMModuleRef module, const char *filename,
+                          char **error_message);
 void LLVMDisposeModule(LLVMModuleRef module);
 
+LLVMValueRef LLVMGetFirstFunction(LLVMModuleRef module);
+LLVMValueRef LLVMGetNextFunction(LLVMValueRef func);
+LLVMValueRef LLVMGetFirstGlobal(LLVMModuleRef module);
+LLVMValueRef LLVMGetNextGlobal(LLVMValueRef global_var);
+void LLVMDeleteFunction(LLVMValueRef func);
+void LLVMDeleteGlobal(LLVMValueRef global_var);
+unsigned int LLVMCountBasicBlocks(LLVMValueRef func);
+int LLVMIsDeclaration(LLVMValueRef global);
+int LLVMGetLinkage(LLVMValueRef global);
+void LLVMSetLinkage(LLVMValueRef global, int linkage);
+void LLVMSetVisibility(LLVMValueRef global, int visibility);
+int LLVMIsGlobalConstant(LLVMValueRef global_var);
+void LLVMSetAlignment(LLVMValueRef value, unsigned int bytes);
+
+unsigned int LLVMGetEnumAttributeKindForName(const char *name,
+                                             unsigned long length);
+LLVMAttributeRef LLVMCreateEnumAttribute(LLVMContextRef context,
+                                         unsigned int kind_id,
+                                         unsigned long value);
+void LLVMAddAttributeAtIndex(LLVMValueRef func, unsigned int index,
+                             LLVMAttributeRef attribute);
+unsigned int LLVMGetAttributeCountAtIndex(LLVMValueRef func,
+                                          unsigned int index);
+void LLVMGetAttributesAtIndex(LLVMValueRef func, unsigned int index,
+                              LLVMAttributeRef *attributes);
+unsigned int LLVMCountParams(LLVMValueRef func);
+LLVMValueRef LLVMGetInitializer(LLVMValueRef global_var);
+
+const char *LLVMGetValueName2(LLVMValueRef val, unsigned long *length);
+void LLVMSetValueName2(LLVMValueRef val, const char *name,
+                       unsigned long length);
+void LLVMReplaceAllUsesWith(LLVMValueRef old_val, LLVMValueRef new_val);
+LLVMUseRef LLVMGetFirstUse(LLVMValueRef val);
+LLVMUseRef LLVMGetNextUse(LLVMUseRef use);
+LLVMValueRef LLVMGetUser(LLVMUseRef use);
+LLVMValueRef LLVMIsAConstantExpr(LLVMValueRef val);
+LLVMValueRef LLVMGetUndef(LLVMTypeRef type);
+
 LLVMBuilderRef LLVMCreateBuilder(void);
 void LLVMPositionBuilderAtEnd(LLVMBuilderRef b, LLVMBasicBlockRef bb);
 LLVMBasicBlockRef LLVMGetInsertBlock(LLVMBuilderRef b);
@@ -59,6 +117,8 @@ LLVMValueRef LLVMBuildSRem(LLVMBuilderRef b, LLVMValueRef left,
                            LLVMValueRef right, const char *name);
 LLVMValueRef LLVMBuildPtrDiff(LLVMBuilderRef b, LLVMValueRef left,
                               LLVMValueRef right, const char *name);
+LLVMValueRef LLVMBuildShl(LLVMBuilderRef b, LLVMValueRef left,
+                          LLVMValueRef right, const char *name);
 LLVMValueRef LLVMBuildAnd(LLVMBuilderRef b, LLVMValueRef left,
                           LLVMValueRef right, const char *name);
 LLVMValueRef LLVMBuildOr(LLVMBuilderRef b, LLVMValueRef left,
@@ -72,6 +132,8 @@ LLVMValueRef LLVMBuildSExt(LLVMBuilderRef b, LLVMValueRef val, LLVMTypeRef type,
                            const char *name);
 LLVMValueRef LLVMBuildZExt(LLVMBuilderRef b, LLVMValueRef val, LLVMTypeRef type,
                            const char *name);
+LLVMValueRef LLVMBuildIntCast(LLVMBuilderRef b, LLVMValueRef val,
+                              LLVMTypeRef type, const char *name);
 LLVMValueRef LLVMBuildIntToPtr(LLVMBuilderRef b, LLVMValueRef val,
                                LLVMTypeRef type, const char *name);
 LLVMValueRef LLVMBuildPtrToInt(LLVMBuilderRef b, LLVMValueRef val,
@@ -97,12 +159,19 @@ LLVMValueRef LLVMBuildCall(LLVMBuilderRef b, LLVMValueRef func,
                            const char *name);
 LLVMValueRef LLVMBuildAlloca(LLVMBuilderRef b, LLVMTypeRef type,
                              const char *name);
+LLVMValueRef LLVMBuildMemSet(LLVMBuilderRef b, LLVMValueRef ptr,
+                             LLVMValueRef val, LLVMValueRef len,
+                             unsigned int align);
+LLVMValueRef LLVMBuildMemCpy(LLVMBuilderRef b, LLVMValueRef dst,
+                             unsigned int dst_align, LLVMValueRef src,
+                             unsigned int src_align, LLVMValueRef size);
 
 LLVMValueRef LLVMBuildRetVoid(LLVMBuilderRef b);
 LLVMValueRef LLVMBuildRet(LLVMBuilderRef b, LLVMValueRef val);
 LLVMValueRef LLVMBuildBr(LLVMBuilderRef b, LLVMBasicBlockRef dest);
 LLVMValueRef LLVMBuildCondBr(LLVMBuilderRef b, LLVMValueRef if_,
                              LLVMBasicBlockRef then, LLVMBasicBlockRef else_);
+LLVMValueRef LLVMBuildUnreachable(LLVMBuilderRef b);
 LLVMValueRef LLVMBuildSwitch(LLVMBuilderRef b, LLVMValueRef value,
                              LLVMBasicBlockRef default_,
                              unsigned int num_cases);
@@ -115,6 +184,29 @@ void LLVMAddIncoming(LLVMValueRef phi, LLVMValueRef *incoming_values,
 
 LLVMValueRef LLVMGetBasicBlockParent(LLVMBasicBlockRef bb);
 
+unsigned int LLVMLookupIntrinsicID(const char *name, unsigned long length);
+LLVMValueRef LLVMGetIntrinsicDeclaration(LLVMModuleRef module,
+                                         unsigned int id,
+                                         LLVMTypeRef *param_types,
+                                         unsigned long param_count);
+
+unsigned int LLVMGetMDKindIDInContext(LLVMContextRef context,
+                                      const char *name, unsigned int length);
+LLVMValueRef LLVMMDStringInContext(LLVMContextRef context, const char *str,
+                                   unsigned int length);
+LLVMValueRef LLVMMDNodeInContext(LLVMContextRef context, LLVMValueRef *vals,
+                                 unsigned int count);
+LLVMValueRef LLVMGetMetadata(LLVMValueRef val, unsigned int kind_id);
+void LLVMSetMetadata(LLVMValueRef val, unsigned int kind_id,
+                     LLVMValueRef node);
+LLVMMetadataRef LLVMMDStringInContext2(LLVMContextRef context,
+                                       const char *str, unsigned long length);
+LLVMMetadataRef LLVMMDNodeInContext2(LLVMContextRef context,
+                                     LLVMMetadataRef *mds,
+                                     unsigned long count);
+LLVMMetadataRef LLVMValueAsMetadata(LLVMValueRef val);
+LLVMValueRef LLVMMetadataAsValue(LLVMContextRef context, LLVMMetadataRef md);
+
 LLVMTypeRef LLVMTypeOf(LLVMValueRef val);
 void LLVMSetInitializer(LLVMValueRef global_var, LLVMValueRef constant_val);
 
@@ -125,6 +217,7 @@ LLVMTypeRef LLVMVoidType(void);
 LLVMTypeRef LLVMInt1Type(void);
 LLVMTypeRef LLVMInt8Type(void);
 LLVMTypeRef LLVMInt32Type(void);
+LLVMTypeRef LLVMInt64Type(void);
 LLVMTypeRef LLVMPointerType(LLVMTypeRef element_type,
                             unsigned int address_space);
 LLVMTypeRef LLVMArrayType(LLVMTypeRef element_type, unsigned int length);
@@ -144,6 +237,13 @@ char *LLVMPrintTypeToString(LLVMTypeRef type);
 
 void LLVMDisposeMessage(char *message);
 
+/* <llvm-c/DebugInfo.h> */
+LLVMMetadataRef LLVMTemporaryMDNode(LLVMContextRef context,
+                                    LLVMMetadataRef *data,
+                                    unsigned long num_elements);
+void LLVMMetadataReplaceAllUsesWith(LLVMMetadataRef temp_target_metadata,
+                                    LLVMMetadataRef replacement);
+
 /* <llvm-c/Analysis.h> */
 #define LLVMReturnStatusAction 2
 
@@ -6,13 +6,51 @@ int main(int argc, char **argv) {
     TranslationUnitNode *node;
     LLVMModuleRef module;
     char *text;
+    char *end;
+    int num_partitions;
+    Vec *partitions;
+    char *partition_filename;
+    int i;
 
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
+    filename = NULL;
+    num_partitions = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strlen(argv[i]) > 16 &&
+            memcmp(argv[i], "-fbracket-depth=", 16) == 0) {
+            parser_max_depth = strtol(argv[i] + 16, &end, 10);
+
+            if (*end != '\0' || parser_max_depth <= 0) {
+                fprintf(stderr, "invalid bracket depth %s\n", argv[i] + 16);
+                exit(1);
+            }
+        } else if (strlen(argv[i]) > 15 &&
+                   memcmp(argv[i], "-fsplit-module=", 15) == 0) {
+            num_partitions = strtol(argv[i] + 15, &end, 10);
+
+            if (*end != '\0' || num_partitions <= 0) {
+                fprintf(stderr, "invalid number of partitions %s\n",
+                        argv[i] + 15);
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "-fskim-bodies") == 0) {
+            parser_skim_bodies = true;
+        } else if (filename == NULL) {
+            filename = argv[i];
+        } else {
+            filename = NULL;
+            break;
+        }
+    }
+
+    if (filename == NULL) {
+        fprintf(stderr,
+                "Usage: %s [-fbracket-depth=N] [-fskim-bodies] "
+                "[-fsplit-module=N] <filename>\n",
+                argv[0]);
         exit(1);
     }
 
-    filename = argv[1];
     src = read_file(filename);
 
     if (src == NULL) {
@@ -23,6 +61,30 @@ int main(int argc, char **argv) {
     node = parse(filename, src, vec_new());
     module = generate(node);
 
+    /* write <filename>.<index>.ll for each partition and print the names */
+    if (num_partitions > 0) {
+        partitions = partition_module(module, num_partitions);
+        partition_filename = malloc(strlen(filename) + 16);
+
+        for (i = 0; i < partitions->size; i++) {
+            sprintf(partition_filename, "%s.%d.ll", filename, i);
+
+            if (LLVMPrintModuleToFile(partitions->data[i], partition_filename,
+                                      &text)) {
+                fprintf(stderr, "cannot write file %s: %s\n",
+                        partition_filename, text);
+                exit(1);
+            }
+
+            printf("%s\n", partition_filename);
+            LLVMDisposeModule(partitions->data[i]);
+        }
+
+        LLVMDisposeModule(module);
+
+        return 0;
+    }
+
     text = LLVMPrintModuleToString(module);
 
     printf("%s\n", text);
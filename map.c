@@ -2,12 +2,18 @@
 
 #include "util.h"
 
+#define map_linear_search_max_size 8
+#define map_initial_buckets 16
+
 Map *map_new(void) {
     Map *m;
 
     m = malloc(sizeof(*m));
     m->keys = vec_new();
     m->values = vec_new();
+    m->buckets = NULL;
+    m->links = NULL;
+    m->num_buckets = 0;
 
     return m;
 }
@@ -19,19 +25,70 @@ int map_size(Map *m) {
     return m->keys->size;
 }
 
-bool map_contains(Map *m, const char *k) {
+void map_link(Map *m, int index) {
+    int bucket;
+
+    assert(m != NULL);
+    assert(m->buckets != NULL);
+    assert(index >= 0 && index < m->num_buckets);
+
+    /* newer entries come first in the chain */
+    bucket = str_hash(m->keys->data[index]) % m->num_buckets;
+    m->links[index] = m->buckets[bucket];
+    m->buckets[bucket] = index + 1;
+}
+
+void map_rehash(Map *m, int num_buckets) {
+    int i;
+
+    assert(m != NULL);
+    assert(num_buckets >= map_size(m));
+
+    m->buckets = malloc(sizeof(int) * num_buckets);
+    m->links = malloc(sizeof(int) * num_buckets);
+    m->num_buckets = num_buckets;
+
+    for (i = 0; i < num_buckets; i++) {
+        m->buckets[i] = 0;
+    }
+
+    for (i = 0; i < map_size(m); i++) {
+        map_link(m, i);
+    }
+}
+
+int map_find(Map *m, const char *k) {
     int i;
 
     assert(m != NULL);
     assert(k != NULL);
 
-    for (i = map_size(m) - 1; i >= 0; i--) {
+    if (m->buckets == NULL) {
+        /* small maps are searched linearly */
+        for (i = map_size(m) - 1; i >= 0; i--) {
+            if (strcmp(m->keys->data[i], k) == 0) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    for (i = m->buckets[str_hash(k) % m->num_buckets] - 1; i >= 0;
+         i = m->links[i] - 1) {
         if (strcmp(m->keys->data[i], k) == 0) {
-            return true;
+            return i;
         }
     }
 
-    return false;
+    return -1;
+}
+
+bool map_contains(Map *m, const char *k) {
+    assert(m != NULL);
+    assert(k != NULL);
+
+    return map_find(m, k) >= 0;
 }
 
 void *map_get(Map *m, const char *k) {
@@ -40,13 +97,13 @@ void *map_get(Map *m, const char *k) {
     assert(m != NULL);
     assert(k != NULL);
 
-    for (i = map_size(m) - 1; i >= 0; i--) {
-        if (strcmp(m->keys->data[i], k) == 0) {
-            return m->values->data[i];
-        }
+    i = map_find(m, k);
+
+    if (i < 0) {
+        return NULL;
     }
 
-    return NULL;
+    return m->values->data[i];
 }
 
 void map_add(Map *m, const char *k, void *v) {
@@ -56,4 +113,12 @@ void map_add(Map *m, const char *k, void *v) {
 
     vec_push(m->keys, str_dup(k));
     vec_push(m->values, v);
+
+    if (m->buckets != NULL && map_size(m) <= m->num_buckets) {
+        map_link(m, map_size(m) - 1);
+    } else if (m->buckets != NULL) {
+        map_rehash(m, m->num_buckets * 2);
+    } else if (map_size(m) > map_linear_search_max_size) {
+        map_rehash(m, map_initial_buckets);
+    }
 }
@@ -8,6 +8,9 @@
 typedef struct Map {
     Vec *keys;
     Vec *values;
+    int *buckets;
+    int *links;
+    int num_buckets;
 } Map;
 
 Map *map_new(void);
@@ -45,17 +45,58 @@
 #define token_or 288
 #define token_arrow 289
 #define token_var_args 290
+#define token_hash_hash 291
+#define token_static 292
+#define token_inline 293
+#define token_attribute 294
+#define token_restrict 295
+#define token_pragma 296 /* #pragma, followed by its tokens and a '\n' */
+#define token_left_shift 297
+#define token_right_shift 298
 
 typedef struct Token {
     int kind;
     char *text;
     const char *filename;
     int line;
+    int location; /* see source_register */
     char *string;
     int len_string;
+    int keyword;  /* token kind if the identifier is a keyword, otherwise 0 */
+    int name_id;  /* lex_name_id of an identifier, otherwise 0 */
+    Vec *hideset; /* names of the macros not to be expanded */
 } Token;
 
+typedef struct LexerContext {
+    char *filename;
+    const char *src;
+    long len_src;
+    int location; /* location of src[0] */
+    long index;
+    int line;
+    char *space_chars; /* white space except '\n' */
+    StrBuilder *string_builder; /* contents of the string being lexed */
+} LexerContext;
+
+int source_register(const char *filename, const char *src, long len_src);
+const char *source_location_filename(int location);
+int source_location_line(int location);
+int source_location_column(int location);
+
+int lex_name_id(const char *text);
+bool lex_integer_value(const char *text, long *value);
+LexerContext *lexer_new(const char *filename, const char *src);
+LexerContext *lexer_new_at(const char *filename, const char *src,
+                           int location);
+Token *lex_token(LexerContext *ctx);
+void lex_skip_text_lines(LexerContext *ctx);
 Vec *lex(const char *filename, const char *src);
+
+typedef struct Preprocessor Preprocessor;
+
+Preprocessor *preprocessor_new(const char *filename, const char *src,
+                               Vec *include_directories);
+Token *preprocessor_next_token(Preprocessor *pp);
 Vec *preprocess(const char *filename, const char *src,
                 Vec *include_directories);
 
@@ -66,6 +107,7 @@ Vec *preprocess(const char *filename, const char *src,
 #define type_array 4
 #define type_function 5
 #define type_struct 6
+#define type_int64 7
 
 typedef struct Type {
     int kind;
@@ -74,6 +116,7 @@ typedef struct Type {
 typedef struct PointerType {
     int kind;
     Type *element_type;
+    bool is_restrict;
 } PointerType;
 
 typedef struct ArrayType {
@@ -95,6 +138,7 @@ typedef struct StructType {
     struct Symbol *symbol;
     struct MemberNode **members;
     int num_members;
+    Map *member_index;
     bool is_incomplete;
     LLVMTypeRef generated_type;
 } StructType;
@@ -102,7 +146,10 @@ typedef struct StructType {
 Type *type_get_void(void);
 Type *type_get_int8(void);
 Type *type_get_int32(void);
+Type *type_get_int64(void);
+Type *type_get_long(void);
 Type *pointer_type_new(Type *element_type);
+Type *restrict_pointer_type_new(Type *element_type);
 Type *array_type_new(Type *element_type, int length);
 Type *function_type_new(Type *return_type, Type **param_types, int num_params,
                         bool var_args);
@@ -111,6 +158,7 @@ bool type_equals(Type *a, Type *b);
 bool is_void_type(Type *t);
 bool is_int8_type(Type *t);
 bool is_int32_type(Type *t);
+bool is_int64_type(Type *t);
 bool is_pointer_type(Type *t);
 bool is_array_type(Type *t);
 bool is_function_type(Type *t);
@@ -118,6 +166,7 @@ bool is_struct_type(Type *t);
 bool is_incomplete_type(Type *t);
 bool is_void_pointer_type(Type *t);
 bool is_function_pointer_type(Type *t);
+bool is_restrict_pointer_type(Type *t);
 bool is_incomplete_pointer_type(Type *t);
 bool is_integer_type(Type *t);
 bool is_scalar_type(Type *t);
@@ -130,6 +179,8 @@ int function_count_param_types(Type *t);
 Type *function_param_type(Type *t, int index);
 bool function_type_is_var_args(Type *t);
 int struct_type_count_members(Type *t);
+int type_alignment(Type *t);
+long type_size(Type *t);
 struct MemberNode *struct_type_member(Type *t, int index);
 struct MemberNode *struct_type_find_member(Type *t, const char *member_name,
                                            int *index);
@@ -139,25 +190,75 @@ struct MemberNode *struct_type_find_member(Type *t, const char *member_name,
 
 typedef struct Symbol {
     int kind;
-    const char *filename;
-    int line;
+    int location;
     const char *identifier;
     Type *type;
 } Symbol;
 
+/* storage class and function specifiers of a declaration */
+#define specifier_static 1
+#define specifier_inline 2
+
+/* __attribute__((...)) of a declaration */
+#define attribute_always_inline 1
+#define attribute_noinline 2
+#define attribute_hot 4
+#define attribute_cold 8
+#define attribute_pure 16
+#define attribute_const 32
+#define attribute_noreturn 64
+#define attribute_malloc 128
+#define attribute_nonnull 256
+
+/* functions the compiler lowers by itself */
+#define builtin_expect 1
+#define builtin_unreachable 2
+#define builtin_prefetch 3
+#define builtin_memcpy 4
+#define builtin_memset 5
+#define builtin_popcount 6
+#define builtin_popcountl 7
+#define builtin_clz 8
+#define builtin_clzl 9
+#define builtin_ctz 10
+#define builtin_ctzl 11
+#define builtin_bswap32 12
+#define builtin_bswap64 13
+
 typedef struct VariableSymbol {
     int kind;
-    const char *filename;
-    int line;
+    int location;
     const char *identifier;
     Type *type;
+    bool is_address_taken;
+    bool is_register_promotable;
     LLVMValueRef generated_location;
+    int specifiers; /* specifier_static and specifier_inline */
+    int attributes; /* attribute_* */
+    int alignment;  /* 0 unless aligned */
+    int builtin;    /* builtin_* of a compiler builtin, otherwise 0 */
+    LLVMValueRef generated_alias_scope; /* set for restrict pointers */
+    LLVMValueRef generated_noalias;
 } VariableSymbol;
 
-VariableSymbol *variable_symbol_new(const char *filename, int line,
-                                    const char *identifier, Type *type);
-Symbol *type_symbol_new(const char *filename, int line, const char *identifier,
-                        Type *type);
+VariableSymbol *variable_symbol_new(int location, const char *identifier,
+                                    Type *type);
+Symbol *type_symbol_new(int location, const char *identifier, Type *type);
+
+/* hints of the loop pragmas */
+#define loop_hint_unroll 1
+#define loop_hint_unroll_full 2
+#define loop_hint_nounroll 4
+#define loop_hint_vectorize 8
+#define loop_hint_novectorize 16
+#define loop_hint_mustprogress 32 /* the loop may be assumed to terminate */
+
+typedef struct LoopHints {
+    int hints;            /* loop_hint_* */
+    int unroll_count;     /* 0 unless given */
+    int vectorize_width;  /* 0 unless given */
+    int interleave_count; /* 0 unless given */
+} LoopHints;
 
 #define node_integer 0
 #define node_string 1
@@ -224,25 +325,22 @@ typedef struct TranslationUnitNode TranslationUnitNode;
 
 struct ExprNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
 };
 
 struct IntegerNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
-    int value;
+    long value;
 };
 
 struct StringNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
     char *string;
@@ -251,8 +349,7 @@ struct StringNode {
 
 struct IdentifierNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
     VariableSymbol *symbol;
@@ -260,8 +357,7 @@ struct IdentifierNode {
 
 struct PostfixNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
     ExprNode *operand;
@@ -270,19 +366,18 @@ struct PostfixNode {
 
 struct CallNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
     ExprNode *callee;
     ExprNode **args;
     int num_args;
+    int builtin; /* builtin_* of the callee, otherwise 0 */
 };
 
 struct UnaryNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
     int operator_;
@@ -291,8 +386,7 @@ struct UnaryNode {
 
 struct SizeofNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
     Type *operand;
@@ -300,8 +394,7 @@ struct SizeofNode {
 
 struct CastNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
     ExprNode *operand;
@@ -309,8 +402,7 @@ struct CastNode {
 
 struct BinaryNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
     int operator_;
@@ -320,8 +412,7 @@ struct BinaryNode {
 
 struct DotNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Type *type;
     bool is_lvalue;
     ExprNode *parent;
@@ -331,29 +422,25 @@ struct DotNode {
 
 struct StmtNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
 };
 
 struct CompoundNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     StmtNode **stmts;
     int num_stmts;
 };
 
 struct ReturnNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     ExprNode *return_value;
 };
 
 struct IfNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     ExprNode *condition;
     StmtNode *then;
     StmtNode *else_;
@@ -361,106 +448,96 @@ struct IfNode {
 
 struct SwitchNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     ExprNode *condition;
     ExprNode **case_values;
     StmtNode **cases;
+    int *case_order;
     int num_cases;
     StmtNode *default_;
 };
 
 struct WhileNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     ExprNode *condition;
     StmtNode *body;
+    LoopHints *hints;
 };
 
 struct DoNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     StmtNode *body;
     ExprNode *condition;
+    LoopHints *hints;
 };
 
 struct ForNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     ExprNode *initialization;
     ExprNode *condition;
     ExprNode *continuation;
     StmtNode *body;
+    LoopHints *hints;
 };
 
 struct BreakNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
 };
 
 struct ContinueNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
 };
 
 struct DeclStmtNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     DeclNode *decl;
 };
 
 struct ExprStmtNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     ExprNode *expr;
 };
 
 struct DeclNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Symbol *symbol;
 };
 
 struct TypedefNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Symbol *symbol;
 };
 
 struct ExternNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Symbol *symbol;
 };
 
 struct MemberNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Symbol *symbol;
 };
 
 struct VariableNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Symbol *symbol;
 };
 
 struct FunctionNode {
     int kind;
-    char *filename;
-    int line;
+    int location;
     Symbol *symbol;
     VariableNode **params;
     int num_params;
@@ -468,6 +545,7 @@ struct FunctionNode {
     StmtNode *body;
     DeclNode **locals;
     int num_locals;
+    const Token **skimmed_body; /* tokens of the body until it is parsed */
 };
 
 struct TranslationUnitNode {
@@ -476,8 +554,24 @@ struct TranslationUnitNode {
     int num_decls;
 };
 
+typedef struct ScopeBinding {
+    void *value;
+    int depth;                     /* scope that registered the binding */
+    bool is_typedef;               /* value is a typedef declaration */
+    struct ScopeBinding *shadowed; /* outer binding of the same name */
+} ScopeBinding;
+
+typedef struct ScopeName {
+    ScopeBinding *binding; /* innermost visible binding or NULL */
+    bool is_typedef;       /* the innermost binding is a typedef */
+} ScopeName;
+
 typedef struct ScopeStack {
-    Vec *scopes;
+    ScopeName **names; /* indexed by lex_name_id */
+    int num_names;
+    int depth;
+    Vec *undo_log;               /* names in order of registration */
+    ScopeBinding *free_bindings; /* bindings released by scope_stack_pop */
 } ScopeStack;
 
 ScopeStack *scope_stack_new(void);
@@ -485,23 +579,41 @@ int scope_stack_depth(ScopeStack *s);
 void scope_stack_push(ScopeStack *s);
 void scope_stack_pop(ScopeStack *s);
 void *scope_stack_find(ScopeStack *s, const char *name, bool recursive);
+void *scope_stack_find_id(ScopeStack *s, int name_id, bool recursive);
+bool scope_stack_is_typedef(ScopeStack *s, int name_id);
 void scope_stack_register(ScopeStack *s, const char *name, void *value);
+void scope_stack_register_typedef(ScopeStack *s, const char *name,
+                                  void *value);
 
 typedef struct ParserContext {
     ScopeStack *env;
     ScopeStack *struct_env;
     VariableSymbol *current_function;
-    Vec *locals;
-    Vec *flow_state;
-    const Token **tokens;
+    SmallVec locals;
+    SmallVec flow_state;
+    int depth; /* nesting on the native stack, see parser_check_depth */
+    Preprocessor *preprocessor; /* NULL if tokens holds every token */
+    const Token **tokens;       /* current and next token while streaming */
     int index;
+    SmallVec skimmed_functions; /* functions whose bodies wait for parsing */
+    LoopHints *loop_hints;      /* pragmas waiting for the next loop */
 } ParserContext;
 
+typedef struct AttributeList {
+    int attributes; /* attribute_* */
+    int alignment;  /* 0 unless aligned */
+    SmallVec nonnull_params; /* indices from 1, every pointer if empty */
+} AttributeList;
+
+extern int parser_max_depth;
+extern bool parser_skim_bodies;
+
 Type *parse_type(ParserContext *ctx);
 ExprNode *parse_unary_expr(ParserContext *ctx);
 ExprNode *parse_assign_expr(ParserContext *ctx);
 ExprNode *parse_expr(ParserContext *ctx);
 StmtNode *parse_stmt(ParserContext *ctx);
+void parse_pragmas(ParserContext *ctx);
 
 void parse_declarator_postfix(ParserContext *ctx, Type **type);
 void parse_declarator(ParserContext *ctx, Type **type, const Token **t);
@@ -565,18 +677,19 @@ StmtNode *sema_switch_stmt_leave(ParserContext *ctx, const Token *t,
                                  ExprNode *condition, ExprNode **case_values,
                                  StmtNode **cases, int num_cases,
                                  StmtNode *default_);
-void sema_while_stmt_enter_body(ParserContext *ctx);
+LoopHints *sema_while_stmt_enter_body(ParserContext *ctx);
 StmtNode *sema_while_stmt_leave_body(ParserContext *ctx, const Token *t,
-                                     ExprNode *condition, StmtNode *body);
-void sema_do_stmt_enter_body(ParserContext *ctx);
+                                     ExprNode *condition, StmtNode *body,
+                                     LoopHints *hints);
+LoopHints *sema_do_stmt_enter_body(ParserContext *ctx);
 void sema_do_stmt_leave_body(ParserContext *ctx);
 StmtNode *sema_do_stmt(ParserContext *ctx, const Token *t, StmtNode *body,
-                       ExprNode *condition);
-void sema_for_stmt_enter_body(ParserContext *ctx);
+                       ExprNode *condition, LoopHints *hints);
+LoopHints *sema_for_stmt_enter_body(ParserContext *ctx);
 StmtNode *sema_for_stmt_leave_body(ParserContext *ctx, const Token *t,
                                    ExprNode *initialization,
                                    ExprNode *condition, ExprNode *continuation,
-                                   StmtNode *body);
+                                   StmtNode *body, LoopHints *hints);
 StmtNode *sema_break_stmt(ParserContext *ctx, const Token *t);
 StmtNode *sema_continue_stmt(ParserContext *ctx, const Token *t);
 StmtNode *sema_decl_stmt(ParserContext *ctx, DeclNode *decl, const Token *t);
@@ -588,20 +701,36 @@ DeclNode *sema_typedef(ParserContext *ctx, const Token *t, Type *type,
                        const Token *identifier);
 DeclNode *sema_extern(ParserContext *ctx, const Token *t, Type *type,
                       const Token *identifier);
-DeclNode *sema_var_decl(ParserContext *ctx, Type *type,
+DeclNode *sema_var_decl(ParserContext *ctx, int specifiers, Type *type,
                         const Token *identifier);
 VariableNode *sema_param(ParserContext *ctx, Type *type,
                          const Token *identifier);
 
+void sema_attribute_list_init(AttributeList *list);
+void sema_attribute(ParserContext *ctx, AttributeList *list, const Token *t,
+                    ExprNode **args, int num_args);
+void sema_var_attributes(ParserContext *ctx, DeclNode *decl,
+                         AttributeList *list);
+void sema_function_attributes(ParserContext *ctx, FunctionNode *p,
+                              AttributeList *list);
+
+void sema_loop_hint(ParserContext *ctx, const Token *t, const char *option,
+                    const Token *arg);
+void sema_pragma_leave(ParserContext *ctx, const Token *next);
+
 void sema_function_enter_params(ParserContext *ctx);
-FunctionNode *sema_function_leave_params(ParserContext *ctx, Type *return_type,
-                                         const Token *t, VariableNode **params,
-                                         int num_params, bool var_args);
+FunctionNode *sema_function_leave_params(ParserContext *ctx, int specifiers,
+                                         Type *return_type, const Token *t,
+                                         VariableNode **params, int num_params,
+                                         bool var_args);
 void sema_function_enter_body(ParserContext *ctx, FunctionNode *p);
+void sema_function_skim_body(ParserContext *ctx, FunctionNode *p,
+                             const Token **tokens);
+ParserContext *sema_skimmed_body_enter(ParserContext *ctx, FunctionNode *p);
 FunctionNode *sema_function_leave_body(ParserContext *ctx, FunctionNode *p,
                                        StmtNode *body);
 
-ParserContext *sema_translation_unit_enter(const Token **tokens);
+ParserContext *sema_translation_unit_enter(Preprocessor *pp);
 TranslationUnitNode *sema_translation_unit_leave(ParserContext *ctx,
                                                  const char *filename,
                                                  DeclNode **decls,
@@ -619,8 +748,11 @@ LLVMValueRef generate_expr(GeneratorContext *ctx, ExprNode *p);
 LLVMValueRef generate_expr_addr(GeneratorContext *ctx, ExprNode *p);
 bool generate_stmt(GeneratorContext *ctx, StmtNode *p);
 
+LLVMValueRef generate_function_decl(GeneratorContext *ctx, FunctionNode *p);
 LLVMValueRef generate_function(GeneratorContext *ctx, FunctionNode *p);
 void generate_decl(GeneratorContext *ctx, DeclNode *p);
 LLVMModuleRef generate(TranslationUnitNode *p);
 
+Vec *partition_module(LLVMModuleRef module, int num_partitions);
+
 #endif
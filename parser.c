@@ -1,31 +1,65 @@
 #include "nocc.h"
 
-const Token *current_token(ParserContext *ctx) {
+/* binding strength of the operators, see parse_operator_expr */
+#define precedence_none 0
+#define precedence_assign 1
+#define precedence_logical_or 2
+#define precedence_logical_and 3
+#define precedence_bitwise_or 4
+#define precedence_bitwise_xor 5
+#define precedence_bitwise_and 6
+#define precedence_equality 7
+#define precedence_relational 8
+#define precedence_additive 9
+#define precedence_multiplicative 10
+#define precedence_unary 11
+
+#define parser_default_max_depth 256
+
+static const Token *current_token(ParserContext *ctx) {
     assert(ctx != NULL);
     return ctx->tokens[ctx->index];
 }
 
-const Token *peek_token(ParserContext *ctx) {
+static const Token *peek_token(ParserContext *ctx) {
     assert(ctx != NULL);
 
     if (current_token(ctx)->kind == '\0') {
         return current_token(ctx);
     }
 
+    if (ctx->preprocessor != NULL) {
+        /* pull the next token from the preprocessor */
+        if (ctx->tokens[1] == NULL) {
+            ctx->tokens[1] = preprocessor_next_token(ctx->preprocessor);
+        }
+
+        return ctx->tokens[1];
+    }
+
     return ctx->tokens[ctx->index + 1];
 }
 
-const Token *consume_token(ParserContext *ctx) {
+static const Token *consume_token(ParserContext *ctx) {
+    const Token *t;
+
     assert(ctx != NULL);
 
     if (current_token(ctx)->kind == '\0') {
         return current_token(ctx);
     }
 
+    if (ctx->preprocessor != NULL) {
+        t = ctx->tokens[0];
+        ctx->tokens[0] = peek_token(ctx);
+        ctx->tokens[1] = NULL;
+        return t;
+    }
+
     return ctx->tokens[ctx->index++];
 }
 
-const Token *consume_token_if(ParserContext *ctx, int kind) {
+static const Token *consume_token_if(ParserContext *ctx, int kind) {
     assert(ctx != NULL);
 
     if (current_token(ctx)->kind == kind) {
@@ -35,7 +69,7 @@ const Token *consume_token_if(ParserContext *ctx, int kind) {
     return NULL;
 }
 
-const Token *expect_token(ParserContext *ctx, int expected_token_kind) {
+static const Token *expect_token(ParserContext *ctx, int expected_token_kind) {
     assert(ctx != NULL);
 
     if (current_token(ctx)->kind == expected_token_kind) {
@@ -48,9 +82,38 @@ const Token *expect_token(ParserContext *ctx, int expected_token_kind) {
     exit(1);
 }
 
-bool is_type_specifier_token(ParserContext *ctx, const Token *t) {
-    DeclNode *symbol;
+/* nesting limit of statements and expressions, parser_default_max_depth if
+   0. nesting that the parser and the generator handle without recursion,
+   such as parentheses, else if cascades and left associative operator
+   chains, does not count */
+int parser_max_depth;
+
+/* if true, function bodies are only skimmed by brace matching while the
+   file scope is parsed, and parsed after the end of the translation unit.
+   bodies then see every file-scope declaration, even the later ones */
+bool parser_skim_bodies;
+
+void parser_check_depth(ParserContext *ctx, int depth) {
+    int max_depth;
+
+    assert(ctx != NULL);
+
+    max_depth = parser_max_depth;
+
+    if (max_depth == 0) {
+        max_depth = parser_default_max_depth;
+    }
+
+    if (depth > max_depth) {
+        fprintf(stderr,
+                "error at %s(%d): nesting is deeper than the limit of %d\n",
+                current_token(ctx)->filename, current_token(ctx)->line,
+                max_depth);
+        exit(1);
+    }
+}
 
+bool is_type_specifier_token(ParserContext *ctx, const Token *t) {
     assert(ctx != NULL);
     assert(t != NULL);
 
@@ -65,9 +128,7 @@ bool is_type_specifier_token(ParserContext *ctx, const Token *t) {
         return true;
 
     case token_identifier:
-        symbol = scope_stack_find(ctx->env, t->text, true);
-
-        return symbol && symbol->kind == node_typedef;
+        return scope_stack_is_typedef(ctx->env, t->name_id);
 
     default:
         return false;
@@ -117,7 +178,7 @@ Type *parse_struct_type(ParserContext *ctx) {
 
     const Token *t;
     const Token *identifier;
-    Vec *members;
+    SmallVec members;
 
     /* struct */
     t = expect_token(ctx, token_struct);
@@ -134,18 +195,26 @@ Type *parse_struct_type(ParserContext *ctx) {
     type = sema_struct_type_enter(ctx, t, identifier);
 
     /* member declarations */
-    members = vec_new();
+    small_vec_init(&members);
 
-    while (current_token(ctx)->kind != '}') {
-        vec_push(members, parse_struct_member(ctx));
+    while (1) {
+        /* pragmas such as pack are ignored between the members */
+        parse_pragmas(ctx);
+
+        if (current_token(ctx)->kind == '}') {
+            break;
+        }
+
+        small_vec_push(&members, parse_struct_member(ctx));
     }
 
     /* } */
     expect_token(ctx, '}');
 
     /* leave struct scope and make node */
-    return sema_struct_type_leave(ctx, type, t, (MemberNode **)members->data,
-                                  members->size);
+    return sema_struct_type_leave(ctx, type, t,
+                                  (MemberNode **)small_vec_finish(&members),
+                                  members.size);
 }
 
 Type *parse_primary_type(ParserContext *ctx) {
@@ -163,10 +232,22 @@ Type *parse_primary_type(ParserContext *ctx) {
         return parse_primary_type(ctx); /* TODO: unsigned type */
 
     case token_int:
-    case token_long:        /* TODO: long type */
-        consume_token(ctx); /* eat int or long */
+        expect_token(ctx, token_int);
         return type_get_int32();
 
+    case token_long:
+        expect_token(ctx, token_long);
+
+        /* long long [int] is 64 bits */
+        if (consume_token_if(ctx, token_long) != NULL) {
+            consume_token_if(ctx, token_int);
+            return type_get_int64();
+        }
+
+        /* long [int] depends on the target */
+        consume_token_if(ctx, token_int);
+        return type_get_long();
+
     case token_identifier:
         return parse_identifier_type(ctx);
 
@@ -225,7 +306,12 @@ ExprNode *parse_number_expr(ParserContext *ctx) {
 
     /* convert */
     errno = 0;
-    value = strtol(t->text, NULL, 10);
+
+    if (!lex_integer_value(t->text, &value)) {
+        fprintf(stderr, "error at line %d: invalid integer constant %s\n",
+                current_token(ctx)->line, t->text);
+        exit(1);
+    }
 
     if (errno == ERANGE || value > INT_MAX) {
         fprintf(stderr, "error at line %d: too large integer constant %s\n",
@@ -294,22 +380,22 @@ ExprNode *parse_primary_expr(ParserContext *ctx) {
 ExprNode *parse_call_expr(ParserContext *ctx, ExprNode *callee) {
     const Token *open;
     const Token *close;
-    Vec *args;
+    SmallVec args;
 
     /* ( */
     open = expect_token(ctx, '(');
 
     /* argument list */
-    args = vec_new();
+    small_vec_init(&args);
 
     if (current_token(ctx)->kind != ')') {
         /* expression */
-        vec_push(args, parse_assign_expr(ctx));
+        small_vec_push(&args, parse_assign_expr(ctx));
 
         /* {, expression} */
         while (consume_token_if(ctx, ',') != NULL) {
             /* expression */
-            vec_push(args, parse_assign_expr(ctx));
+            small_vec_push(&args, parse_assign_expr(ctx));
         }
     }
 
@@ -317,8 +403,9 @@ ExprNode *parse_call_expr(ParserContext *ctx, ExprNode *callee) {
     close = expect_token(ctx, ')');
 
     /* make node */
-    return sema_call_expr(ctx, callee, open, (ExprNode **)args->data,
-                          args->size, close);
+    return sema_call_expr(ctx, callee, open,
+                          (ExprNode **)small_vec_finish(&args), args.size,
+                          close);
 }
 
 ExprNode *parse_index_expr(ParserContext *ctx, ExprNode *operand) {
@@ -365,11 +452,15 @@ ExprNode *parse_arrow_expr(ParserContext *ctx, ExprNode *parent) {
     return sema_arrow_expr(ctx, parent, t, identifier);
 }
 
-ExprNode *parse_postfix_expr(ParserContext *ctx) {
+ExprNode *parse_postfix_operators(ParserContext *ctx, ExprNode *operand) {
     const Token *t;
-    ExprNode *operand;
+    int depth;
+
+    assert(ctx != NULL);
+    assert(operand != NULL);
 
-    operand = parse_primary_expr(ctx);
+    /* every postfix operator nests the operand one level deeper */
+    depth = ctx->depth;
 
     while (1) {
         switch (current_token(ctx)->kind) {
@@ -398,9 +489,17 @@ ExprNode *parse_postfix_expr(ParserContext *ctx) {
         default:
             return operand;
         }
+
+        depth++;
+        parser_check_depth(ctx, depth);
     }
 }
 
+ExprNode *parse_postfix_expr(ParserContext *ctx) {
+    /* primary expression */
+    return parse_postfix_operators(ctx, parse_primary_expr(ctx));
+}
+
 ExprNode *parse_cast_expr(ParserContext *ctx) {
     const Token *open;
     const Token *close;
@@ -460,283 +559,291 @@ ExprNode *parse_sizeof_expr(ParserContext *ctx) {
     return sema_sizeof_expr(ctx, t, type);
 }
 
-ExprNode *parse_unary_expr(ParserContext *ctx) {
+ExprNode *parse_reduce_operator(ParserContext *ctx, SmallVec *operators,
+                                SmallVec *precedences, SmallVec *operands,
+                                ExprNode *operand) {
     const Token *t;
-    ExprNode *operand;
+    int precedence;
 
     assert(ctx != NULL);
+    assert(operators != NULL);
+    assert(precedences != NULL);
+    assert(operands != NULL);
+    assert(operand != NULL);
 
-    t = current_token(ctx);
-
-    switch (t->kind) {
-    case '+':
-    case '-':
-    case '*':
-    case '&':
-    case '!':
-    case token_increment:
-    case token_decrement:
-        /* unary operator */
-        consume_token(ctx);
+    t = small_vec_pop(operators);
+    precedence = (intptr_t)small_vec_pop(precedences);
 
-        /* unary expression */
-        operand = parse_unary_expr(ctx);
+    assert(precedence != precedence_none);
 
-        /* make node */
+    if (precedence == precedence_unary) {
         return sema_unary_expr(ctx, t, operand);
-
-    case token_sizeof:
-        return parse_sizeof_expr(ctx);
-
-    case '(':
-        if (is_type_specifier_token(ctx, peek_token(ctx))) {
-            return parse_cast_expr(ctx);
-        }
-        break;
-
-    default:
-        break;
     }
 
-    return parse_postfix_expr(ctx);
+    return sema_binary_expr(ctx, small_vec_pop(operands), t, operand);
 }
 
-ExprNode *parse_multiplicative_expr(ParserContext *ctx) {
-    const Token *t;
-    ExprNode *left;
-    ExprNode *right;
+int binary_operator_precedence(int kind) {
+    switch (kind) {
+    case '=':
+        return precedence_assign;
 
-    /* unary expression */
-    left = parse_unary_expr(ctx);
+    case token_or:
+        return precedence_logical_or;
 
-    while (current_token(ctx)->kind == '*' || current_token(ctx)->kind == '/' ||
-           current_token(ctx)->kind == '%') {
-        /* multiplicative operator */
-        t = consume_token(ctx);
+    case token_and:
+        return precedence_logical_and;
 
-        /* unary expression */
-        right = parse_unary_expr(ctx);
+    case '|':
+        return precedence_bitwise_or;
 
-        /* make node */
-        left = sema_binary_expr(ctx, left, t, right);
-    }
+    case '^':
+        return precedence_bitwise_xor;
 
-    return left;
-}
+    case '&':
+        return precedence_bitwise_and;
 
-ExprNode *parse_additive_expr(ParserContext *ctx) {
-    const Token *t;
-    ExprNode *left;
-    ExprNode *right;
+    case token_equal:
+    case token_not_equal:
+        return precedence_equality;
 
-    /* multiplicative expression */
-    left = parse_multiplicative_expr(ctx);
+    case '<':
+    case '>':
+    case token_lesser_equal:
+    case token_greater_equal:
+        return precedence_relational;
 
-    while (current_token(ctx)->kind == '+' || current_token(ctx)->kind == '-') {
-        /* additive operator */
-        t = consume_token(ctx);
+    case '+':
+    case '-':
+        return precedence_additive;
 
-        /* multiplicative expression */
-        right = parse_multiplicative_expr(ctx);
+    case '*':
+    case '/':
+    case '%':
+        return precedence_multiplicative;
 
-        /* make node */
-        left = sema_binary_expr(ctx, left, t, right);
+    default:
+        return precedence_none;
     }
-
-    return left;
 }
 
-ExprNode *parse_relational_expr(ParserContext *ctx) {
-    const Token *t;
-    ExprNode *left;
-    ExprNode *right;
-
-    /* additive expression */
-    left = parse_additive_expr(ctx);
-
-    while (current_token(ctx)->kind == '<' || current_token(ctx)->kind == '>' ||
-           current_token(ctx)->kind == token_lesser_equal ||
-           current_token(ctx)->kind == token_greater_equal) {
-        /* relational operator */
-        t = consume_token(ctx);
+bool is_prefix_operator_token(const Token *t) {
+    assert(t != NULL);
 
-        /* additive expression */
-        right = parse_additive_expr(ctx);
+    switch (t->kind) {
+    case '+':
+    case '-':
+    case '*':
+    case '&':
+    case '!':
+    case token_increment:
+    case token_decrement:
+        return true;
 
-        /* make node */
-        left = sema_binary_expr(ctx, left, t, right);
+    default:
+        return false;
     }
-
-    return left;
 }
 
-ExprNode *parse_equality_expr(ParserContext *ctx) {
+/* operators and parentheses are kept on explicit stacks rather than the
+   native one, so that machine generated nesting does not overflow it. the
+   stacks hold every pending operator with its precedence, a parenthesis
+   being precedence_none, and the left operand of every pending binary
+   operator */
+ExprNode *parse_operator_expr(ParserContext *ctx, bool is_unary) {
+    SmallVec operators;
+    SmallVec precedences;
+    SmallVec operands;
     const Token *t;
-    ExprNode *left;
-    ExprNode *right;
+    const Token *open;
+    ExprNode *operand;
+    int precedence;
+    int num_parens;
 
-    /* relational expression */
-    left = parse_relational_expr(ctx);
+    assert(ctx != NULL);
 
-    while (current_token(ctx)->kind == token_equal ||
-           current_token(ctx)->kind == token_not_equal) {
-        /* equality operator */
-        t = consume_token(ctx);
+    small_vec_init(&operators);
+    small_vec_init(&precedences);
+    small_vec_init(&operands);
+    num_parens = 0;
 
-        /* relational expression */
-        right = parse_relational_expr(ctx);
+    ctx->depth++;
+    parser_check_depth(ctx, ctx->depth);
 
-        /* make node */
-        left = sema_binary_expr(ctx, left, t, right);
-    }
-
-    return left;
-}
-
-ExprNode *parse_bitwise_and_expr(ParserContext *ctx) {
-    const Token *t;
-    ExprNode *left;
-    ExprNode *right;
+    while (1) {
+        /* {prefix operator | (} */
+        t = current_token(ctx);
+
+        if (is_prefix_operator_token(t)) {
+            small_vec_push(&operators, (void *)consume_token(ctx));
+            small_vec_push(&precedences, (void *)(intptr_t)precedence_unary);
+            parser_check_depth(ctx, ctx->depth + operators.size - num_parens);
+            continue;
+        }
 
-    /* equality expression */
-    left = parse_equality_expr(ctx);
+        if (t->kind == '(' && !is_type_specifier_token(ctx, peek_token(ctx))) {
+            small_vec_push(&operators, (void *)consume_token(ctx));
+            small_vec_push(&precedences, (void *)(intptr_t)precedence_none);
+            num_parens++;
+            continue;
+        }
 
-    while (current_token(ctx)->kind == '&') {
-        /* & */
-        t = expect_token(ctx, '&');
+        /* operand */
+        if (t->kind == '(') {
+            operand = parse_cast_expr(ctx);
+        } else if (t->kind == token_sizeof) {
+            operand = parse_sizeof_expr(ctx);
+        } else {
+            operand = parse_postfix_expr(ctx);
+        }
 
-        /* equality expression */
-        right = parse_equality_expr(ctx);
+        /* {) postfix operators} */
+        while (num_parens > 0 && current_token(ctx)->kind == ')') {
+            /* reduce the operators in the parentheses */
+            while ((intptr_t)small_vec_back(&precedences) != precedence_none) {
+                operand = parse_reduce_operator(ctx, &operators, &precedences,
+                                                &operands, operand);
+            }
 
-        /* make node */
-        left = sema_binary_expr(ctx, left, t, right);
-    }
+            small_vec_pop(&precedences);
+            open = small_vec_pop(&operators);
+            num_parens--;
 
-    return left;
-}
+            operand = sema_paren_expr(ctx, open, operand, consume_token(ctx));
+            operand = parse_postfix_operators(ctx, operand);
+        }
 
-ExprNode *parse_bitwise_xor_expr(ParserContext *ctx) {
-    const Token *t;
-    ExprNode *left;
-    ExprNode *right;
+        /* binary operator? */
+        precedence = binary_operator_precedence(current_token(ctx)->kind);
 
-    /* bitwise and expression */
-    left = parse_bitwise_and_expr(ctx);
+        if (precedence == precedence_none || (is_unary && num_parens == 0)) {
+            break;
+        }
 
-    while (current_token(ctx)->kind == '^') {
-        /* ^ */
-        t = expect_token(ctx, '^');
+        /* reduce the operators binding at least as tightly, except for the
+           right associative assignment */
+        while (operators.size > 0 &&
+               ((intptr_t)small_vec_back(&precedences) > precedence ||
+                ((intptr_t)small_vec_back(&precedences) == precedence &&
+                 precedence != precedence_assign))) {
+            operand = parse_reduce_operator(ctx, &operators, &precedences,
+                                            &operands, operand);
+        }
 
-        /* bitwise and expression */
-        right = parse_bitwise_and_expr(ctx);
+        small_vec_push(&operands, operand);
+        small_vec_push(&operators, (void *)consume_token(ctx));
+        small_vec_push(&precedences, (void *)(intptr_t)precedence);
+        parser_check_depth(ctx, ctx->depth + operators.size - num_parens);
+    }
 
-        /* make node */
-        left = sema_binary_expr(ctx, left, t, right);
+    /* ) */
+    if (num_parens > 0) {
+        expect_token(ctx, ')');
     }
 
-    return left;
-}
+    while (operators.size > 0) {
+        operand = parse_reduce_operator(ctx, &operators, &precedences,
+                                        &operands, operand);
+    }
 
-ExprNode *parse_bitwise_or_expr(ParserContext *ctx) {
-    const Token *t;
-    ExprNode *left;
-    ExprNode *right;
+    ctx->depth--;
 
-    /* bitwise xor expression */
-    left = parse_bitwise_xor_expr(ctx);
+    return operand;
+}
 
-    while (current_token(ctx)->kind == '|') {
-        /* | */
-        t = expect_token(ctx, '|');
+ExprNode *parse_unary_expr(ParserContext *ctx) {
+    assert(ctx != NULL);
 
-        /* bitwise xor expression */
-        right = parse_bitwise_xor_expr(ctx);
+    return parse_operator_expr(ctx, true);
+}
 
-        /* make node */
-        left = sema_binary_expr(ctx, left, t, right);
-    }
+ExprNode *parse_assign_expr(ParserContext *ctx) {
+    assert(ctx != NULL);
 
-    return left;
+    return parse_operator_expr(ctx, false);
 }
 
-ExprNode *parse_logical_and_expr(ParserContext *ctx) {
-    const Token *t;
-    ExprNode *left;
-    ExprNode *right;
-
-    /* bitwise or expression */
-    left = parse_bitwise_or_expr(ctx);
+ExprNode *parse_expr(ParserContext *ctx) {
+    assert(ctx != NULL);
 
-    while (current_token(ctx)->kind == token_and) {
-        /* && */
-        t = expect_token(ctx, token_and);
+    return parse_assign_expr(ctx);
+}
 
-        /* bitwise or expression */
-        right = parse_bitwise_or_expr(ctx);
+void parse_pragma_loop_option(ParserContext *ctx, const Token *t) {
+    const Token *option;
+    const Token *arg;
 
-        /* make node */
-        left = sema_binary_expr(ctx, left, t, right);
-    }
+    /* identifier ( argument ) */
+    option = expect_token(ctx, token_identifier);
+    expect_token(ctx, '(');
+    arg = consume_token(ctx);
+    expect_token(ctx, ')');
 
-    return left;
+    sema_loop_hint(ctx, t, option->text, arg);
 }
 
-ExprNode *parse_logical_or_expr(ParserContext *ctx) {
+void parse_pragma(ParserContext *ctx) {
     const Token *t;
-    ExprNode *left;
-    ExprNode *right;
+    const Token *name;
+    const Token *arg;
 
-    /* logical and expression */
-    left = parse_logical_and_expr(ctx);
+    /* #pragma */
+    t = expect_token(ctx, token_pragma);
+    name = current_token(ctx);
 
-    while (current_token(ctx)->kind == token_or) {
-        /* || */
-        t = expect_token(ctx, token_or);
+    if (name->kind == token_identifier && strcmp(name->text, "unroll") == 0) {
+        /* unroll [N | (N)] */
+        consume_token(ctx);
+        arg = NULL;
 
-        /* logical and expression */
-        right = parse_logical_and_expr(ctx);
+        if (consume_token_if(ctx, '(') != NULL) {
+            arg = expect_token(ctx, token_number);
+            expect_token(ctx, ')');
+        } else if (current_token(ctx)->kind == token_number) {
+            arg = consume_token(ctx);
+        }
 
-        /* make node */
-        left = sema_binary_expr(ctx, left, t, right);
+        sema_loop_hint(ctx, t, "unroll", arg);
+    } else if (name->kind == token_identifier &&
+               strcmp(name->text, "nounroll") == 0) {
+        /* nounroll */
+        consume_token(ctx);
+        sema_loop_hint(ctx, t, "nounroll", NULL);
+    } else if (name->kind == token_identifier &&
+               strcmp(name->text, "clang") == 0 &&
+               strcmp(peek_token(ctx)->text, "loop") == 0) {
+        /* clang loop {option} */
+        consume_token(ctx);
+        consume_token(ctx);
+
+        while (current_token(ctx)->kind != '\n') {
+            parse_pragma_loop_option(ctx, t);
+        }
+    } else {
+        /* other pragmas are ignored */
+        while (current_token(ctx)->kind != '\n') {
+            consume_token(ctx);
+        }
     }
 
-    return left;
+    /* end of the pragma */
+    expect_token(ctx, '\n');
 }
 
-ExprNode *parse_assign_expr(ParserContext *ctx) {
-    const Token *t;
-    ExprNode *left;
-    ExprNode *right;
-
+void parse_pragmas(ParserContext *ctx) {
     assert(ctx != NULL);
 
-    /* logical or expression */
-    left = parse_logical_or_expr(ctx);
-
-    /* assignment operator */
-    if (current_token(ctx)->kind != '=') {
-        return left;
+    while (current_token(ctx)->kind == token_pragma) {
+        parse_pragma(ctx);
     }
 
-    t = expect_token(ctx, '=');
-
-    /* assignment expression */
-    right = parse_assign_expr(ctx);
-
-    /* make node */
-    return sema_binary_expr(ctx, left, t, right);
-}
-
-ExprNode *parse_expr(ParserContext *ctx) {
-    assert(ctx != NULL);
-
-    return parse_assign_expr(ctx);
+    sema_pragma_leave(ctx, current_token(ctx));
 }
 
 StmtNode *parse_compound_stmt(ParserContext *ctx) {
     const Token *open;
     const Token *close;
-    Vec *stmts;
+    SmallVec stmts;
 
     /* enter scope */
     sema_compound_stmt_enter(ctx);
@@ -745,18 +852,25 @@ StmtNode *parse_compound_stmt(ParserContext *ctx) {
     open = expect_token(ctx, '{');
 
     /* {statement} */
-    stmts = vec_new();
+    small_vec_init(&stmts);
 
-    while (current_token(ctx)->kind != '}') {
-        vec_push(stmts, parse_stmt(ctx));
+    while (1) {
+        parse_pragmas(ctx);
+
+        if (current_token(ctx)->kind == '}') {
+            break;
+        }
+
+        small_vec_push(&stmts, parse_stmt(ctx));
     }
 
     /* } */
     close = expect_token(ctx, '}');
 
     /* make node and leave scope */
-    return sema_compound_stmt_leave(ctx, open, (StmtNode **)stmts->data,
-                                    stmts->size, close);
+    return sema_compound_stmt_leave(ctx, open,
+                                    (StmtNode **)small_vec_finish(&stmts),
+                                    stmts.size, close);
 }
 
 StmtNode *parse_return_stmt(ParserContext *ctx) {
@@ -782,48 +896,80 @@ StmtNode *parse_return_stmt(ParserContext *ctx) {
 }
 
 StmtNode *parse_if_stmt(ParserContext *ctx) {
+    SmallVec cascade;
     const Token *t;
     ExprNode *condition;
     StmtNode *then;
     StmtNode *else_;
 
-    /* if */
-    t = expect_token(ctx, token_if);
+    /* an else if cascade is parsed in a loop, keeping the token, the
+       condition and the then statement of every if in cascade */
+    small_vec_init(&cascade);
+    else_ = NULL;
 
-    /* ( expression ) */
-    condition = parse_paren_expr(ctx);
+    while (1) {
+        /* if */
+        t = expect_token(ctx, token_if);
 
-    /* enter then scope */
-    sema_if_stmt_enter_block(ctx);
+        /* ( expression ) */
+        condition = parse_paren_expr(ctx);
 
-    /* statement */
-    then = parse_stmt(ctx);
+        /* enter then scope */
+        sema_if_stmt_enter_block(ctx);
+
+        /* statement */
+        then = parse_stmt(ctx);
+
+        /* leave then scope */
+        sema_if_stmt_leave_block(ctx);
 
-    /* leave then scope */
-    sema_if_stmt_leave_block(ctx);
+        small_vec_push(&cascade, (void *)t);
+        small_vec_push(&cascade, condition);
+        small_vec_push(&cascade, then);
+
+        /* else? */
+        if (consume_token_if(ctx, token_else) == NULL) {
+            break;
+        }
+
+        /* enter else scope */
+        sema_if_stmt_enter_block(ctx);
+
+        /* else if */
+        if (current_token(ctx)->kind == token_if) {
+            continue;
+        }
 
-    /* else? */
-    if (consume_token_if(ctx, token_else) == NULL) {
-        return sema_if_stmt(ctx, t, condition, then, NULL);
+        /* statement */
+        else_ = parse_stmt(ctx);
+
+        /* leave else scope */
+        sema_if_stmt_leave_block(ctx);
+        break;
     }
 
-    /* enter else scope */
-    sema_if_stmt_enter_block(ctx);
+    /* make nodes from the innermost if, each outer one leaving the else
+       scope the inner one was parsed in */
+    while (1) {
+        then = small_vec_pop(&cascade);
+        condition = small_vec_pop(&cascade);
+        t = small_vec_pop(&cascade);
 
-    /* statement */
-    else_ = parse_stmt(ctx);
+        else_ = sema_if_stmt(ctx, t, condition, then, else_);
 
-    /* leave else scope */
-    sema_if_stmt_leave_block(ctx);
+        if (cascade.size == 0) {
+            return else_;
+        }
 
-    /* make node */
-    return sema_if_stmt(ctx, t, condition, then, else_);
+        /* leave else scope */
+        sema_if_stmt_leave_block(ctx);
+    }
 }
 
 void parse_switch_stmt_case(ParserContext *ctx, ExprNode **case_value,
                             StmtNode **case_) {
     const Token *t;
-    Vec *stmts;
+    SmallVec stmts;
 
     /* case */
     t = expect_token(ctx, token_case);
@@ -835,22 +981,23 @@ void parse_switch_stmt_case(ParserContext *ctx, ExprNode **case_value,
     expect_token(ctx, ':');
 
     /* statement* */
-    stmts = vec_new();
+    small_vec_init(&stmts);
 
     while (current_token(ctx)->kind != '}' &&
            current_token(ctx)->kind != token_case &&
            current_token(ctx)->kind != token_default) {
-        vec_push(stmts, parse_stmt(ctx));
+        small_vec_push(&stmts, parse_stmt(ctx));
     }
 
     /* make node */
     *case_ = sema_switch_stmt_case(ctx, t, *case_value,
-                                   (StmtNode **)stmts->data, stmts->size);
+                                   (StmtNode **)small_vec_finish(&stmts),
+                                   stmts.size);
 }
 
 StmtNode *parse_switch_stmt_default(ParserContext *ctx) {
     const Token *t;
-    Vec *stmts;
+    SmallVec stmts;
 
     /* default */
     t = expect_token(ctx, token_default);
@@ -859,24 +1006,25 @@ StmtNode *parse_switch_stmt_default(ParserContext *ctx) {
     expect_token(ctx, ':');
 
     /* statement* */
-    stmts = vec_new();
+    small_vec_init(&stmts);
 
     while (current_token(ctx)->kind != '}' &&
            current_token(ctx)->kind != token_case &&
            current_token(ctx)->kind != token_default) {
-        vec_push(stmts, parse_stmt(ctx));
+        small_vec_push(&stmts, parse_stmt(ctx));
     }
 
     /* make node */
-    return sema_switch_stmt_default(ctx, t, (StmtNode **)stmts->data,
-                                    stmts->size);
+    return sema_switch_stmt_default(ctx, t,
+                                    (StmtNode **)small_vec_finish(&stmts),
+                                    stmts.size);
 }
 
 StmtNode *parse_switch_stmt(ParserContext *ctx) {
     const Token *t;
     ExprNode *condition;
-    Vec *case_values;
-    Vec *cases;
+    SmallVec case_values;
+    SmallVec cases;
     StmtNode *default_;
 
     /* switch */
@@ -892,8 +1040,8 @@ StmtNode *parse_switch_stmt(ParserContext *ctx) {
     expect_token(ctx, '{');
 
     /* switch labels */
-    case_values = vec_new();
-    cases = vec_new();
+    small_vec_init(&case_values);
+    small_vec_init(&cases);
     default_ = NULL;
 
     while (current_token(ctx)->kind != '}') {
@@ -904,8 +1052,8 @@ StmtNode *parse_switch_stmt(ParserContext *ctx) {
             /* case label */
             parse_switch_stmt_case(ctx, &case_value, &case_);
 
-            vec_push(case_values, case_value);
-            vec_push(cases, case_);
+            small_vec_push(&case_values, case_value);
+            small_vec_push(&cases, case_);
         } else if (current_token(ctx)->kind == token_default) {
             /* default label */
             default_ = parse_switch_stmt_default(ctx);
@@ -920,14 +1068,15 @@ StmtNode *parse_switch_stmt(ParserContext *ctx) {
 
     /* leave switch scope and make node */
     return sema_switch_stmt_leave(
-        ctx, t, condition, (ExprNode **)case_values->data,
-        (StmtNode **)cases->data, cases->size, default_);
+        ctx, t, condition, (ExprNode **)small_vec_finish(&case_values),
+        (StmtNode **)small_vec_finish(&cases), cases.size, default_);
 }
 
 StmtNode *parse_while_stmt(ParserContext *ctx) {
     const Token *t;
     ExprNode *condition;
     StmtNode *body;
+    LoopHints *hints;
 
     /* while */
     t = expect_token(ctx, token_while);
@@ -936,25 +1085,26 @@ StmtNode *parse_while_stmt(ParserContext *ctx) {
     condition = parse_paren_expr(ctx);
 
     /* enter body scope */
-    sema_while_stmt_enter_body(ctx);
+    hints = sema_while_stmt_enter_body(ctx);
 
     /* statement */
     body = parse_stmt(ctx);
 
     /* leave body scope and make node */
-    return sema_while_stmt_leave_body(ctx, t, condition, body);
+    return sema_while_stmt_leave_body(ctx, t, condition, body, hints);
 }
 
 StmtNode *parse_do_stmt(ParserContext *ctx) {
     const Token *t;
     StmtNode *body;
     ExprNode *condition;
+    LoopHints *hints;
 
     /* do */
     t = expect_token(ctx, token_do);
 
     /* enter body scope */
-    sema_do_stmt_enter_body(ctx);
+    hints = sema_do_stmt_enter_body(ctx);
 
     /* statement */
     body = parse_stmt(ctx);
@@ -972,7 +1122,7 @@ StmtNode *parse_do_stmt(ParserContext *ctx) {
     expect_token(ctx, ';');
 
     /* leave body scope and make node */
-    return sema_do_stmt(ctx, t, body, condition);
+    return sema_do_stmt(ctx, t, body, condition, hints);
 }
 
 StmtNode *parse_for_stmt(ParserContext *ctx) {
@@ -981,6 +1131,7 @@ StmtNode *parse_for_stmt(ParserContext *ctx) {
     ExprNode *condition;
     ExprNode *continuation;
     StmtNode *body;
+    LoopHints *hints;
 
     /* for */
     t = expect_token(ctx, token_for);
@@ -1019,14 +1170,14 @@ StmtNode *parse_for_stmt(ParserContext *ctx) {
     expect_token(ctx, ')');
 
     /* enter body scope */
-    sema_for_stmt_enter_body(ctx);
+    hints = sema_for_stmt_enter_body(ctx);
 
     /* statement */
     body = parse_stmt(ctx);
 
     /* leave body scope and make node */
     return sema_for_stmt_leave_body(ctx, t, initialization, condition,
-                                    continuation, body);
+                                    continuation, body, hints);
 }
 
 StmtNode *parse_break_stmt(ParserContext *ctx) {
@@ -1082,42 +1233,66 @@ StmtNode *parse_expr_stmt(ParserContext *ctx) {
 }
 
 StmtNode *parse_stmt(ParserContext *ctx) {
+    StmtNode *p;
+
     assert(ctx != NULL);
 
+    /* statements nest on the native stack */
+    ctx->depth++;
+    parser_check_depth(ctx, ctx->depth);
+
+    /* pragmas preceding the statement */
+    parse_pragmas(ctx);
+
     switch (current_token(ctx)->kind) {
     case '{':
-        return parse_compound_stmt(ctx);
+        p = parse_compound_stmt(ctx);
+        break;
 
     case token_return:
-        return parse_return_stmt(ctx);
+        p = parse_return_stmt(ctx);
+        break;
 
     case token_if:
-        return parse_if_stmt(ctx);
+        p = parse_if_stmt(ctx);
+        break;
 
     case token_switch:
-        return parse_switch_stmt(ctx);
+        p = parse_switch_stmt(ctx);
+        break;
 
     case token_while:
-        return parse_while_stmt(ctx);
+        p = parse_while_stmt(ctx);
+        break;
 
     case token_do:
-        return parse_do_stmt(ctx);
+        p = parse_do_stmt(ctx);
+        break;
 
     case token_for:
-        return parse_for_stmt(ctx);
+        p = parse_for_stmt(ctx);
+        break;
 
     case token_break:
-        return parse_break_stmt(ctx);
+        p = parse_break_stmt(ctx);
+        break;
 
     case token_continue:
-        return parse_continue_stmt(ctx);
+        p = parse_continue_stmt(ctx);
+        break;
 
     default:
         if (is_declaration_specifier_token(ctx, current_token(ctx))) {
-            return parse_decl_stmt(ctx);
+            p = parse_decl_stmt(ctx);
+        } else {
+            p = parse_expr_stmt(ctx);
         }
-        return parse_expr_stmt(ctx);
+        break;
     }
+
+    ctx->depth--;
+
+    return p;
 }
 
 void parse_direct_declarator(ParserContext *ctx, Type **type, const Token **t) {
@@ -1170,10 +1345,27 @@ void parse_declarator_postfix(ParserContext *ctx, Type **type) {
 }
 
 void parse_declarator_prefix(ParserContext *ctx, Type **type) {
+    bool is_restrict;
+
     /* pointer types */
-    /* TODO: const pointer */
     while (consume_token_if(ctx, '*') != NULL) {
-        *type = pointer_type_new(*type);
+        /* {const | restrict} */
+        is_restrict = false;
+
+        while (1) {
+            if (consume_token_if(ctx, token_restrict) != NULL) {
+                is_restrict = true;
+            } else if (consume_token_if(ctx, token_const) == NULL) {
+                break;
+            }
+        }
+
+        /* TODO: const pointer */
+        if (is_restrict) {
+            *type = restrict_pointer_type_new(*type);
+        } else {
+            *type = pointer_type_new(*type);
+        }
     }
 }
 
@@ -1231,7 +1423,7 @@ DeclNode *parse_var_decl(ParserContext *ctx) {
     parse_declarator(ctx, &type, &t);
 
     /* register symbol and make node */
-    return sema_var_decl(ctx, type, t);
+    return sema_var_decl(ctx, 0, type, t);
 }
 
 DeclNode *parse_decl(ParserContext *ctx) {
@@ -1303,15 +1495,147 @@ DeclNode *parse_extern(ParserContext *ctx) {
     return sema_extern(ctx, t, type, identifier);
 }
 
+const Token **parse_skim_body(ParserContext *ctx) {
+    SmallVec tokens;
+    const Token *t;
+    Token *end;
+    int depth;
+
+    assert(ctx != NULL);
+
+    small_vec_init(&tokens);
+
+    /* { */
+    t = expect_token(ctx, '{');
+    small_vec_push(&tokens, (void *)t);
+    depth = 1;
+
+    /* tokens until the matching } */
+    while (depth > 0) {
+        t = current_token(ctx);
+        small_vec_push(&tokens, (void *)t);
+
+        if (t->kind == '\0') {
+            /* the parser reports the missing } */
+            return (const Token **)small_vec_finish(&tokens);
+        }
+
+        if (t->kind == '{') {
+            depth++;
+        } else if (t->kind == '}') {
+            depth--;
+        }
+
+        consume_token(ctx);
+    }
+
+    /* end of the skimmed tokens */
+    end = malloc(sizeof(*end));
+    end->kind = '\0';
+    end->text = "";
+    end->filename = t->filename;
+    end->line = t->line;
+    end->location = t->location;
+    end->string = NULL;
+    end->len_string = 0;
+    end->keyword = 0;
+    end->name_id = 0;
+    end->hideset = NULL;
+    small_vec_push(&tokens, end);
+
+    return (const Token **)small_vec_finish(&tokens);
+}
+
+void parse_attribute(ParserContext *ctx, AttributeList *list) {
+    const Token *t;
+    SmallVec args;
+
+    /* identifier */
+    if (current_token(ctx)->kind == token_const) {
+        t = consume_token(ctx);
+    } else {
+        t = expect_token(ctx, token_identifier);
+    }
+
+    /* arguments */
+    small_vec_init(&args);
+
+    if (consume_token_if(ctx, '(') != NULL) {
+        /* expr {, expr} */
+        small_vec_push(&args, parse_assign_expr(ctx));
+
+        while (consume_token_if(ctx, ',') != NULL) {
+            small_vec_push(&args, parse_assign_expr(ctx));
+        }
+
+        /* ) */
+        expect_token(ctx, ')');
+    }
+
+    sema_attribute(ctx, list, t, (ExprNode **)small_vec_finish(&args),
+                   args.size);
+}
+
+void parse_attributes(ParserContext *ctx, AttributeList *list) {
+    assert(ctx != NULL);
+    assert(list != NULL);
+
+    /* {__attribute__((attribute {, attribute}))} */
+    while (consume_token_if(ctx, token_attribute) != NULL) {
+        /* ( ( */
+        expect_token(ctx, '(');
+        expect_token(ctx, '(');
+
+        /* attribute {, attribute} */
+        parse_attribute(ctx, list);
+
+        while (consume_token_if(ctx, ',') != NULL) {
+            parse_attribute(ctx, list);
+        }
+
+        /* ) ) */
+        expect_token(ctx, ')');
+        expect_token(ctx, ')');
+    }
+}
+
+int parse_specifiers(ParserContext *ctx, AttributeList *list) {
+    int specifiers;
+
+    assert(ctx != NULL);
+
+    specifiers = 0;
+
+    /* {static | inline | attributes} */
+    while (1) {
+        if (consume_token_if(ctx, token_static) != NULL) {
+            specifiers = specifiers | specifier_static;
+        } else if (consume_token_if(ctx, token_inline) != NULL) {
+            specifiers = specifiers | specifier_inline;
+        } else if (current_token(ctx)->kind == token_attribute) {
+            parse_attributes(ctx, list);
+        } else {
+            return specifiers;
+        }
+    }
+}
+
 DeclNode *parse_function(ParserContext *ctx) {
+    int specifiers;
+    AttributeList attributes;
     const Token *t;
+    DeclNode *decl;
     Type *return_type;
-    Vec *params;
+    SmallVec params;
     StmtNode *body;
     bool var_args;
 
     FunctionNode *p;
 
+    /* specifiers */
+    sema_attribute_list_init(&attributes);
+    specifiers = parse_specifiers(ctx, &attributes);
+
     /* type */
     return_type = parse_type(ctx);
 
@@ -1323,16 +1647,25 @@ DeclNode *parse_function(ParserContext *ctx) {
     /* FIXME: pointer */
     parse_declarator_prefix(ctx, &return_type);
 
+    /* attributes */
+    parse_attributes(ctx, &attributes);
+
     if (current_token(ctx)->kind == token_identifier &&
         peek_token(ctx)->kind != '(') {
         /* declarator */
         parse_declarator(ctx, &return_type, &t);
 
+        /* attributes */
+        parse_attributes(ctx, &attributes);
+
         /* ; */
         expect_token(ctx, ';');
 
         /* variable declaration */
-        return sema_var_decl(ctx, return_type, t);
+        decl = sema_var_decl(ctx, specifiers, return_type, t);
+        sema_var_attributes(ctx, decl, &attributes);
+
+        return decl;
     }
 
     /* identifier */
@@ -1345,7 +1678,7 @@ DeclNode *parse_function(ParserContext *ctx) {
     sema_function_enter_params(ctx);
 
     /* parameters */
-    params = vec_new();
+    small_vec_init(&params);
     var_args = false;
 
     if (current_token(ctx)->kind == token_void &&
@@ -1355,7 +1688,7 @@ DeclNode *parse_function(ParserContext *ctx) {
     } else {
         /* param {, param} */
         /* param */
-        vec_push(params, parse_param(ctx));
+        small_vec_push(&params, parse_param(ctx));
 
         while (consume_token_if(ctx, ',') != NULL) {
             /* ...? */
@@ -1365,23 +1698,34 @@ DeclNode *parse_function(ParserContext *ctx) {
             }
 
             /* param */
-            vec_push(params, parse_param(ctx));
+            small_vec_push(&params, parse_param(ctx));
         }
     }
 
     /* ) */
     expect_token(ctx, ')');
 
+    /* attributes */
+    parse_attributes(ctx, &attributes);
+
     /* leave parameter scope and make node */
-    p = sema_function_leave_params(ctx, return_type, t,
-                                   (VariableNode **)params->data, params->size,
+    p = sema_function_leave_params(ctx, specifiers, return_type, t,
+                                   (VariableNode **)small_vec_finish(&params),
+                                   params.size,
                                    var_args);
+    sema_function_attributes(ctx, p, &attributes);
 
     /* ;? */
     if (consume_token_if(ctx, ';') != NULL) {
         return (DeclNode *)p;
     }
 
+    /* skimmed body */
+    if (parser_skim_bodies) {
+        sema_function_skim_body(ctx, p, parse_skim_body(ctx));
+        return (DeclNode *)p;
+    }
+
     /* enter function body */
     sema_function_enter_body(ctx, p);
 
@@ -1392,10 +1736,31 @@ DeclNode *parse_function(ParserContext *ctx) {
     return (DeclNode *)sema_function_leave_body(ctx, p, body);
 }
 
+void parse_skimmed_body(ParserContext *ctx, FunctionNode *p) {
+    ParserContext *body_ctx;
+    StmtNode *body;
+
+    /* enter function body */
+    body_ctx = sema_skimmed_body_enter(ctx, p);
+
+    /* body */
+    body = parse_compound_stmt(body_ctx);
+
+    /* end of the skimmed tokens */
+    expect_token(body_ctx, '\0');
+
+    /* leave function body */
+    sema_function_leave_body(body_ctx, p, body);
+}
+
 DeclNode *parse_top_level(ParserContext *ctx) {
     assert(ctx != NULL);
 
     switch (current_token(ctx)->kind) {
+    case token_pragma:
+        parse_pragmas(ctx);
+        return NULL;
+
     case token_typedef:
         return parse_top_level_typedef(ctx);
 
@@ -1409,34 +1774,40 @@ DeclNode *parse_top_level(ParserContext *ctx) {
 
 TranslationUnitNode *parse(const char *filename, const char *src,
                            Vec *include_directories) {
-    const Token **tokens;
+    Preprocessor *pp;
     ParserContext *ctx;
     DeclNode *decl;
-    Vec *decls;
+    SmallVec decls;
+    int i;
 
     assert(filename != NULL);
     assert(src != NULL);
     assert(include_directories != NULL);
 
-    /* get tokens */
-    tokens =
-        (const Token **)preprocess(filename, src, include_directories)->data;
+    /* tokens are pulled from the preprocessor while parsing */
+    pp = preprocessor_new(filename, src, include_directories);
 
     /* enter translation unit */
-    ctx = sema_translation_unit_enter(tokens);
+    ctx = sema_translation_unit_enter(pp);
 
     /* top level declarations */
-    decls = vec_new();
+    small_vec_init(&decls);
 
     while (current_token(ctx)->kind != '\0') {
         decl = parse_top_level(ctx);
 
         if (decl) {
-            vec_push(decls, decl);
+            small_vec_push(&decls, decl);
         }
     }
 
+    /* skimmed function bodies */
+    for (i = 0; i < ctx->skimmed_functions.size; i++) {
+        parse_skimmed_body(ctx, ctx->skimmed_functions.data[i]);
+    }
+
     /* make node */
-    return sema_translation_unit_leave(ctx, filename, (DeclNode **)decls->data,
-                                       decls->size);
+    return sema_translation_unit_leave(ctx, filename,
+                                       (DeclNode **)small_vec_finish(&decls),
+                                       decls.size);
 }
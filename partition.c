@@ -0,0 +1,249 @@
+#include "nocc.h"
+
+/* a module is split by function, so that the partitions can be compiled to
+   machine code independently of each other and linked together */
+
+/* symbols local to the module and inline functions may be defined more than
+   once, so they are copied into every partition that uses them */
+bool partition_is_copied(LLVMValueRef global) {
+    int linkage;
+
+    assert(global != NULL);
+
+    linkage = LLVMGetLinkage(global);
+
+    return linkage == LLVMInternalLinkage || linkage == LLVMPrivateLinkage ||
+           linkage == LLVMLinkOnceODRLinkage;
+}
+
+bool partition_is_used(LLVMValueRef value) {
+    LLVMUseRef use;
+    LLVMValueRef user;
+
+    assert(value != NULL);
+
+    for (use = LLVMGetFirstUse(value); use != NULL; use = LLVMGetNextUse(use)) {
+        user = LLVMGetUser(use);
+
+        /* constant expressions outlive the instructions that used them */
+        if (LLVMIsAConstantExpr(user) == NULL || partition_is_used(user)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void partition_copy_attributes(LLVMValueRef from, LLVMValueRef to) {
+    LLVMAttributeRef *attributes;
+    int num_attributes;
+    int num_params;
+    int index;
+    int i;
+
+    assert(from != NULL);
+    assert(to != NULL);
+
+    /* the function, the return value and every parameter */
+    num_params = LLVMCountParams(from);
+
+    for (index = LLVMAttributeFunctionIndex; index <= num_params; index++) {
+        num_attributes = LLVMGetAttributeCountAtIndex(from, index);
+
+        if (num_attributes == 0) {
+            continue;
+        }
+
+        attributes = malloc(sizeof(LLVMAttributeRef) * num_attributes);
+        LLVMGetAttributesAtIndex(from, index, attributes);
+
+        for (i = 0; i < num_attributes; i++) {
+            LLVMAddAttributeAtIndex(to, index, attributes[i]);
+        }
+    }
+}
+
+void partition_drop_body(LLVMModuleRef partition, LLVMValueRef function) {
+    LLVMValueRef decl;
+    const char *name;
+    unsigned long length;
+    char *identifier;
+
+    assert(partition != NULL);
+    assert(function != NULL);
+
+    /* replace the definition with a declaration of the same name */
+    name = LLVMGetValueName2(function, &length);
+    identifier = str_dup_n(name, length);
+
+    decl = LLVMAddFunction(partition, "",
+                           LLVMGetElementType(LLVMTypeOf(function)));
+
+    /* callers in this partition still rely on readnone, nonnull, ... */
+    partition_copy_attributes(function, decl);
+
+    LLVMReplaceAllUsesWith(function, decl);
+    LLVMDeleteFunction(function);
+    LLVMSetValueName2(decl, identifier, length);
+}
+
+void partition_promote(LLVMModuleRef partition, LLVMValueRef global) {
+    const char *name;
+    unsigned long length;
+    const char *module_name;
+    unsigned long module_length;
+
+    assert(partition != NULL);
+    assert(global != NULL);
+
+    /* a name that does not clash with the static variables of other
+       modules */
+    name = LLVMGetValueName2(global, &length);
+    module_name = LLVMGetModuleIdentifier(partition, &module_length);
+    name = str_cat_n(name, length, ".", 1);
+    name = str_cat_n(name, length + 1, module_name, module_length);
+
+    LLVMSetValueName2(global, name, length + 1 + module_length);
+    LLVMSetLinkage(global, LLVMExternalLinkage);
+    LLVMSetVisibility(global, LLVMHiddenVisibility);
+}
+
+void partition_remove_unused(LLVMModuleRef partition) {
+    LLVMValueRef value;
+    LLVMValueRef next;
+    bool changed;
+
+    assert(partition != NULL);
+
+    /* removing a function can make more symbols unused */
+    changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (value = LLVMGetFirstFunction(partition); value != NULL;
+             value = next) {
+            next = LLVMGetNextFunction(value);
+
+            if (partition_is_copied(value) && !partition_is_used(value)) {
+                LLVMReplaceAllUsesWith(value,
+                                       LLVMGetUndef(LLVMTypeOf(value)));
+                LLVMDeleteFunction(value);
+                changed = true;
+            }
+        }
+
+        for (value = LLVMGetFirstGlobal(partition); value != NULL;
+             value = next) {
+            next = LLVMGetNextGlobal(value);
+
+            if (partition_is_copied(value) && !partition_is_used(value)) {
+                LLVMReplaceAllUsesWith(value,
+                                       LLVMGetUndef(LLVMTypeOf(value)));
+                LLVMDeleteGlobal(value);
+                changed = true;
+            }
+        }
+    }
+}
+
+LLVMModuleRef partition_new(LLVMModuleRef module, int *owners,
+                            int num_functions, int index) {
+    LLVMModuleRef partition;
+    LLVMValueRef value;
+    LLVMValueRef next;
+    int i;
+
+    assert(module != NULL);
+    assert(owners != NULL || num_functions == 0);
+    assert(index >= 0);
+
+    partition = LLVMCloneModule(module);
+
+    /* a static variable must remain a single object shared by the
+       partitions */
+    for (value = LLVMGetFirstGlobal(partition); value != NULL;
+         value = LLVMGetNextGlobal(value)) {
+        if (LLVMGetLinkage(value) == LLVMInternalLinkage &&
+            !LLVMIsGlobalConstant(value)) {
+            partition_promote(partition, value);
+        }
+    }
+
+    /* functions of other partitions are only declared. declarations are
+       appended to the list of functions, so the loop stops before them */
+    value = LLVMGetFirstFunction(partition);
+
+    for (i = 0; i < num_functions; i++) {
+        next = LLVMGetNextFunction(value);
+
+        if (owners[i] != index && !LLVMIsDeclaration(value) &&
+            !partition_is_copied(value)) {
+            partition_drop_body(partition, value);
+        }
+
+        value = next;
+    }
+
+    /* the first partition defines the global variables */
+    if (index != 0) {
+        for (value = LLVMGetFirstGlobal(partition); value != NULL;
+             value = LLVMGetNextGlobal(value)) {
+            if (LLVMGetInitializer(value) != NULL &&
+                !partition_is_copied(value)) {
+                LLVMSetInitializer(value, NULL);
+            }
+        }
+    }
+
+    partition_remove_unused(partition);
+
+    return partition;
+}
+
+Vec *partition_module(LLVMModuleRef module, int num_partitions) {
+    Vec *partitions;
+    LLVMValueRef function;
+    int *owners;
+    int num_functions;
+    long total_size;
+    long size;
+    int i;
+
+    assert(module != NULL);
+    assert(num_partitions > 0);
+
+    /* size of the module in basic blocks */
+    num_functions = 0;
+    total_size = 0;
+
+    for (function = LLVMGetFirstFunction(module); function != NULL;
+         function = LLVMGetNextFunction(function)) {
+        num_functions++;
+        total_size = total_size + LLVMCountBasicBlocks(function);
+    }
+
+    /* consecutive functions share a partition of about the same size */
+    owners = malloc(sizeof(int) * num_functions);
+    size = 0;
+    i = 0;
+
+    for (function = LLVMGetFirstFunction(module); function != NULL;
+         function = LLVMGetNextFunction(function)) {
+        if (total_size == 0) {
+            owners[i] = 0;
+        } else {
+            owners[i] = size * num_partitions / total_size;
+        }
+        size = size + LLVMCountBasicBlocks(function);
+        i++;
+    }
+
+    partitions = vec_new();
+
+    for (i = 0; i < num_partitions; i++) {
+        vec_push(partitions, partition_new(module, owners, num_functions, i));
+    }
+
+    return partitions;
+}
@@ -2,25 +2,65 @@
 
 struct Preprocessor {
     Vec *result;
-    Token **tokens;
+    int result_index; /* next token to be read from result */
+    Token *concat_token; /* string literal being concatenated */
+    StrBuilder *concat_text;
+    StrBuilder *concat_string;
+    bool is_end_of_file;
+    LexerContext *lexer; /* NULL while reading an already lexed line */
+    Vec *tokens;         /* tokens lexed ahead of the current position */
     int index;
+    Vec *pending; /* tokens to be rescanned, in reverse order */
+    bool is_isolated;
     Vec *include_directories;
     Vec *include_stack;
+    Vec *file_stack;   /* SourceFile suspended by #include */
+    Vec *conditionals; /* open #if groups, true after #else */
     Map *macros;
-    Map *keywords;
 };
 
-typedef struct Preprocessor Preprocessor;
+typedef struct SourceFile {
+    LexerContext *lexer;
+    Vec *tokens;
+    int index;
+    int num_conditionals; /* #if groups opened before the file */
+} SourceFile;
+
+typedef struct Macro {
+    Token *name;
+    bool is_function_like;
+    Vec *params;
+    bool is_variadic;
+    Vec *body;
+} Macro;
+
+typedef struct MacroArg {
+    Vec *tokens;   /* tokens as written */
+    Vec *expanded; /* fully macro-expanded tokens, NULL until needed */
+} MacroArg;
 
 void pp_push_token(Preprocessor *pp, Token *t);
-void pp_else(Preprocessor *pp, bool accept_else, bool skip);
-void pp_endif(Preprocessor *pp, bool accept_endif);
-void preprocess_lines(Preprocessor *pp, bool accept_else, bool accept_endif);
+Vec *pp_expand_tokens(Preprocessor *pp, Vec *tokens);
+long pp_eval_conditional(Preprocessor *pp, bool evaluated);
+void pp_conditional(Preprocessor *pp, bool condition);
+
+Token *pp_peek_token(Preprocessor *pp, int index) {
+    assert(pp != NULL);
+    assert(index >= pp->index);
+
+    /* tokens are lexed on demand */
+    while (pp->tokens->size <= index) {
+        assert(pp->lexer != NULL);
+        vec_push(pp->tokens, lex_token(pp->lexer));
+    }
+
+    return pp->tokens->data[index];
+}
 
-Token *pp_current_token(Preprocessor *pp) {
+static Token *pp_current_token(Preprocessor *pp) {
     assert(pp != NULL);
 
-    return pp->tokens[pp->index];
+    return pp_peek_token(pp, pp->index);
 }
 
 Token *pp_last_token(Preprocessor *pp) {
@@ -39,6 +79,12 @@ Token *pp_consume_token(Preprocessor *pp) {
 
     if (t->kind != '\0') {
         pp->index++;
+
+        /* reuse the buffer once every lexed token has been consumed */
+        if (pp->lexer != NULL && pp->index == pp->tokens->size) {
+            pp->tokens->size = 0;
+            pp->index = 0;
+        }
     }
 
     return t;
@@ -137,10 +183,26 @@ bool pp_read_file(Preprocessor *pp, const char *filename, char **path,
     return false;
 }
 
+void pp_finish_concat(Preprocessor *pp) {
+    Token *t;
+
+    assert(pp != NULL);
+
+    t = pp->concat_token;
+
+    if (t == NULL) {
+        return;
+    }
+
+    t->text = str_builder_dup(pp->concat_text);
+    t->string = str_builder_dup(pp->concat_string);
+    t->len_string = pp->concat_string->size;
+
+    pp->concat_token = NULL;
+}
+
 void pp_concat_string(Preprocessor *pp, const Token *str) {
     Token *t;
-    int text_len1;
-    int text_len2;
 
     t = pp_last_token(pp);
 
@@ -151,382 +213,1711 @@ void pp_concat_string(Preprocessor *pp, const Token *str) {
     assert(str->kind == token_string);
     assert(str->string != NULL);
 
-    text_len1 = strlen(t->text) - 1;   /* without last '\"' */
-    text_len2 = strlen(str->text) - 1; /* without first '\"' */
+    /* the literals are collected until the token is read or another run
+       starts */
+    if (pp->concat_token != t) {
+        pp_finish_concat(pp);
+
+        str_builder_clear(pp->concat_text);
+        str_builder_append_n(pp->concat_text, t->text, strlen(t->text));
+        str_builder_clear(pp->concat_string);
+        str_builder_append_n(pp->concat_string, t->string, t->len_string);
+        pp->concat_token = t;
+    }
+
+    /* replace the last '\"' with the rest of str->text */
+    pp->concat_text->size = pp->concat_text->size - 1;
+    str_builder_append_n(pp->concat_text, str->text + 1, strlen(str->text) - 1);
+    str_builder_append_n(pp->concat_string, str->string, str->len_string);
+}
+
+bool pp_is_separator(const Token *t) {
+    assert(t != NULL);
 
-    t->text = str_cat_n(t->text, text_len1, str->text + 1, text_len2);
-    t->string =
-        str_cat_n(t->string, t->len_string, str->string, str->len_string);
-    t->len_string = t->len_string + str->len_string;
+    return t->kind == ' ' || t->kind == '\n';
 }
 
-void pp_expand_macro(Preprocessor *pp, Token *t) {
-    Vec *macro_tokens;
+bool pp_is_empty_tokens(Vec *tokens) {
     int i;
 
-    /* check if the identifier is a macro */
-    macro_tokens = map_get(pp->macros, t->text);
+    assert(tokens != NULL);
 
-    if (macro_tokens == NULL) {
-        /* identifier is not a macro */
-        /* check keywords */
-        if (map_contains(pp->keywords, t->text)) {
-            t->kind = (intptr_t)map_get(pp->keywords, t->text);
+    for (i = 0; i < tokens->size; i++) {
+        if (!pp_is_separator(tokens->data[i])) {
+            return false;
         }
-
-        vec_push(pp->result, t);
-        return;
     }
 
-    /* expand the macro */
-    for (i = 0; i < macro_tokens->size; i++) {
-        /* TODO: expand macros recursively */
-        pp_push_token(pp, macro_tokens->data[i]);
-    }
+    return true;
 }
 
-void pp_push_token(Preprocessor *pp, Token *t) {
-    assert(pp != NULL);
-    assert(t != NULL);
+bool hideset_contains(Vec *hideset, const char *name) {
+    int i;
 
-    if (t->kind == '\0' || t->kind == '\n' || t->kind == ' ') {
-        return;
-    }
+    assert(name != NULL);
 
-    if (pp->result->size > 0 && t->kind == token_string &&
-        pp_last_token(pp)->kind == token_string) {
-        pp_concat_string(pp, t);
-        return;
+    if (hideset == NULL) {
+        return false;
     }
 
-    if (t->kind == token_identifier) {
-        pp_expand_macro(pp, t);
-        return;
+    for (i = 0; i < hideset->size; i++) {
+        if (strcmp(hideset->data[i], name) == 0) {
+            return true;
+        }
     }
 
-    vec_push(pp->result, t);
+    return false;
 }
 
-void pp_define(Preprocessor *pp) {
-    Token *identifier;
-    Vec *macro_tokens;
+Vec *hideset_add(Vec *hideset, const char *name) {
+    Vec *result;
+    int i;
 
-    /* define */
-    pp_expect_token(pp, "define");
+    assert(name != NULL);
 
-    /* identifier */
-    pp_skip_separator(pp);
-    identifier = pp_expect_token_kind(pp, token_identifier);
+    /* hide sets are shared between tokens, so never modify them in place */
+    if (hideset_contains(hideset, name)) {
+        return hideset;
+    }
 
-    /* macro contents */
-    macro_tokens = vec_new();
+    result = vec_new();
 
-    while (pp_current_token(pp)->kind != '\0' &&
-           pp_current_token(pp)->kind != '\n') {
-        vec_push(macro_tokens, pp_consume_token(pp));
+    if (hideset != NULL) {
+        for (i = 0; i < hideset->size; i++) {
+            vec_push(result, hideset->data[i]);
+        }
     }
 
-    /* redefinition check */
-    if (map_contains(pp->macros, identifier->text)) {
-        fprintf(stderr, "error at %s(%d): macro %s has already been defined\n",
-                identifier->filename, identifier->line, identifier->text);
-        exit(1);
-    }
+    vec_push(result, (char *)name);
 
-    /* register macro */
-    map_add(pp->macros, identifier->text, macro_tokens);
+    return result;
 }
 
-void pp_include(Preprocessor *pp) {
-    const Token *t;
-    const Token *filename;
-    char *path;
-    char *src;
+Vec *hideset_union(Vec *a, Vec *b) {
+    int i;
 
-    Token **saved_tokens;
-    int saved_index;
+    if (a == NULL) {
+        return b;
+    }
 
-    /* include */
-    t = pp_expect_token(pp, "include");
+    if (b == NULL) {
+        return a;
+    }
 
-    /* string */
-    pp_skip_separator(pp);
-    filename = pp_expect_token_kind(pp, token_string); /* TODO: <path> */
+    for (i = 0; i < b->size; i++) {
+        a = hideset_add(a, b->data[i]);
+    }
 
-    /* new line */
-    pp_expect_line_ending(pp);
+    return a;
+}
 
-    /* check the depth of include stack */
-    if (pp->include_stack->size >= 256) {
-        fprintf(stderr, "error at %s(%d): #include nested too deeply\n",
-                t->filename, t->line);
-        exit(1);
+Vec *hideset_intersection(Vec *a, Vec *b) {
+    Vec *result;
+    int i;
+
+    if (a == NULL || b == NULL) {
+        return NULL;
     }
 
-    /* open file */
-    if (!pp_read_file(pp, filename->string, &path, &src)) {
-        fprintf(stderr, "error at %s(%d): cannot include file %s\n",
-                t->filename, t->line, filename->string);
-        exit(1);
+    result = NULL;
+
+    for (i = 0; i < a->size; i++) {
+        if (hideset_contains(b, a->data[i])) {
+            result = hideset_add(result, a->data[i]);
+        }
     }
 
-    /* read file */
-    saved_tokens = pp->tokens;
-    saved_index = pp->index;
+    return result;
+}
 
-    pp->tokens = (Token **)lex(path, src)->data;
-    pp->index = 0;
+Token *pp_copy_token(const Token *t, Vec *hideset) {
+    Token *p;
 
-    /* push include stack */
-    vec_push(pp->include_stack, path);
+    assert(t != NULL);
 
-    /* process the file */
-    preprocess_lines(pp, false, false);
+    p = malloc(sizeof(*p));
+    p->kind = t->kind;
+    p->text = t->text;
+    p->filename = t->filename;
+    p->line = t->line;
+    p->location = t->location;
+    p->string = t->string;
+    p->len_string = t->len_string;
+    p->keyword = t->keyword;
+    p->name_id = t->name_id;
+    p->hideset = hideset;
+
+    return p;
+}
 
-    /* pop include stack */
-    vec_pop(pp->include_stack);
+Macro *macro_new(Token *name) {
+    Macro *macro;
 
-    pp->tokens = saved_tokens;
-    pp->index = saved_index;
+    assert(name != NULL);
+
+    macro = malloc(sizeof(*macro));
+    macro->name = name;
+    macro->is_function_like = false;
+    macro->params = vec_new();
+    macro->is_variadic = false;
+    macro->body = vec_new();
+
+    return macro;
 }
 
-void pp_skip_line(Preprocessor *pp) {
-    assert(pp != NULL);
+Macro *macro_new_predefined(const char *name) {
+    Token *t;
 
-    while (pp_skip_separator(pp)->kind != '\0' &&
-           pp_skip_separator(pp)->kind != '\n') {
-        pp_consume_token(pp);
+    assert(name != NULL);
+
+    t = malloc(sizeof(*t));
+    t->kind = token_identifier;
+    t->text = (char *)name;
+    t->filename = "<built-in>";
+    t->line = 0;
+    t->location = 0;
+    t->string = NULL;
+    t->len_string = 0;
+    t->keyword = 0;
+    t->name_id = lex_name_id(name);
+    t->hideset = NULL;
+
+    return macro_new(t);
+}
+
+int macro_param_index(Macro *macro, const Token *t) {
+    int i;
+
+    assert(macro != NULL);
+    assert(t != NULL);
+
+    if (!macro->is_function_like || t->kind != token_identifier) {
+        return -1;
+    }
+
+    for (i = 0; i < macro->params->size; i++) {
+        if (strcmp(macro->params->data[i], t->text) == 0) {
+            return i;
+        }
     }
+
+    return -1;
+}
+
+MacroArg *macro_arg_new(void) {
+    MacroArg *arg;
+
+    arg = malloc(sizeof(*arg));
+    arg->tokens = vec_new();
+    arg->expanded = NULL;
+
+    return arg;
 }
 
-void pp_skip_until_else_or_endif(Preprocessor *pp, bool accept_else) {
+int pp_spell_tokens(Vec *tokens, char *buffer) {
     Token *t;
+    bool space;
+    int length;
+    int len_text;
+    int i;
 
-    while (1) {
-        switch (pp_skip_separator(pp)->kind) {
-        case '\0':
-            fprintf(stderr,
-                    "error at %s(%d): "
-                    "unexpected end of file, unterminated #if directives\n",
-                    pp_current_token(pp)->filename, pp_current_token(pp)->line);
-            exit(1);
+    assert(tokens != NULL);
 
-        case '\n':
-            pp_consume_token(pp);
-            break;
+    /* each run of white space between tokens becomes a single space */
+    space = false;
+    length = 0;
 
-        case '#':
-            pp_consume_token(pp); /* eat # */
+    for (i = 0; i < tokens->size; i++) {
+        t = tokens->data[i];
 
-            /* identifier */
-            t = pp_skip_separator(pp);
+        if (pp_is_separator(t)) {
+            space = length > 0;
+            continue;
+        }
 
-            if (strcmp(t->text, "if") == 0 || strcmp(t->text, "ifdef") == 0 ||
-                strcmp(t->text, "ifndef") == 0) {
-                pp_skip_line(pp);
-                pp_skip_until_else_or_endif(pp, false);
-            } else if (strcmp(t->text, "endif") == 0) {
-                pp_endif(pp, true);
-                return;
-            } else if (strcmp(t->text, "else") == 0 && accept_else) {
-                pp_else(pp, true, false);
-                return;
-            } else {
-                pp_skip_line(pp);
+        if (space) {
+            if (buffer != NULL) {
+                buffer[length] = ' ';
             }
-            break;
+            length++;
+            space = false;
+        }
 
-        default:
-            pp_skip_line(pp);
-            break;
+        len_text = strlen(t->text);
+
+        if (buffer != NULL) {
+            memcpy(buffer + length, t->text, len_text);
         }
+        length = length + len_text;
     }
+
+    return length;
 }
 
-void pp_ifdef(Preprocessor *pp, bool defined) {
-    Token *macro_name;
+Token *pp_stringize(const Token *where, Vec *tokens) {
+    Token *t;
+    char *spelling;
+    char *text;
+    int len_spelling;
+    int len_text;
+    int i;
 
-    /* ifndef */
-    if (strcmp(pp_current_token(pp)->text, "ifdef") != 0 &&
-        strcmp(pp_current_token(pp)->text, "ifndef") != 0) {
-        fprintf(stderr,
-                "error at %s(%d): expected ifdef or ifndef, but got %s\n",
-                pp_current_token(pp)->filename, pp_current_token(pp)->line,
-                pp_current_token(pp)->text);
-        exit(1);
-    }
-    pp_consume_token(pp);
+    assert(where != NULL);
+    assert(tokens != NULL);
 
-    /* identifier */
-    pp_skip_separator(pp);
-    macro_name = pp_expect_token_kind(pp, token_identifier);
+    /* spelling of the argument */
+    len_spelling = pp_spell_tokens(tokens, NULL);
+    spelling = malloc(sizeof(char) * (len_spelling + 1));
+    pp_spell_tokens(tokens, spelling);
+    spelling[len_spelling] = '\0';
 
-    /* new line */
-    pp_expect_line_ending(pp);
+    /* escape '\"' and '\\' */
+    len_text = len_spelling + 2;
 
-    /* check if the macro has been defined */
-    if (map_contains(pp->macros, macro_name->text) == defined) {
-        /* process until #else or #endif */
-        preprocess_lines(pp, true, true);
-    } else {
-        /* skip until #else or #endif */
-        pp_skip_until_else_or_endif(pp, true);
+    for (i = 0; i < len_spelling; i++) {
+        if (spelling[i] == '\"' || spelling[i] == '\\') {
+            len_text++;
+        }
     }
-}
 
-void pp_else(Preprocessor *pp, bool accept_else, bool skip) {
-    const Token *t;
+    text = malloc(sizeof(char) * (len_text + 1));
+    text[0] = '\"';
+    len_text = 1;
 
-    /* else */
-    t = pp_expect_token(pp, "else");
+    for (i = 0; i < len_spelling; i++) {
+        if (spelling[i] == '\"' || spelling[i] == '\\') {
+            text[len_text] = '\\';
+            len_text++;
+        }
+        text[len_text] = spelling[i];
+        len_text++;
+    }
 
-    /* new line */
-    pp_expect_line_ending(pp);
+    text[len_text] = '\"';
+    text[len_text + 1] = '\0';
 
-    if (!accept_else) {
-        fprintf(stderr, "error at %s(%d): #else without #if\n", t->filename,
-                t->line);
-        exit(1);
-    }
+    t = pp_copy_token(where, NULL);
+    t->kind = token_string;
+    t->text = text;
+    t->string = spelling;
+    t->len_string = len_spelling;
 
-    if (skip) {
-        pp_skip_until_else_or_endif(pp, false);
-    } else {
-        preprocess_lines(pp, false, true);
-    }
+    return t;
 }
 
-void pp_endif(Preprocessor *pp, bool accept_endif) {
-    const Token *t;
+Token *pp_paste(const Token *lhs, const Token *rhs) {
+    LexerContext *lexer;
+    Token *t;
+    char *text;
 
-    /* endif */
-    t = pp_expect_token(pp, "endif");
+    assert(lhs != NULL);
+    assert(rhs != NULL);
 
-    /* new line */
-    pp_expect_line_ending(pp);
+    /* re-lex the concatenated spelling at the location of lhs */
+    text =
+        str_cat_n(lhs->text, strlen(lhs->text), rhs->text, strlen(rhs->text));
+    lexer = lexer_new_at(lhs->filename, text, lhs->location);
+    t = lex_token(lexer);
 
-    if (!accept_endif) {
-        fprintf(stderr, "error at %s(%d): #endif without #if\n", t->filename,
-                t->line);
+    if (t->kind == '\0' || lex_token(lexer)->kind != '\0') {
+        fprintf(stderr,
+                "error at %s(%d): pasting %s and %s does not give a valid "
+                "preprocessing token\n",
+                lhs->filename, lhs->line, lhs->text, rhs->text);
         exit(1);
     }
-}
 
-bool pp_directive(Preprocessor *pp, bool accept_else, bool accept_endif) {
-    Token *t;
+    t->line = lhs->line;
 
-    /* # */
-    pp_expect_token_kind(pp, '#');
+    return t;
+}
 
-    /* identifier */
-    t = pp_skip_separator(pp);
+void pp_append_tokens(Vec *out, Vec *tokens) {
+    int i;
 
-    if (strcmp(t->text, "define") == 0) {
-        pp_define(pp);
-        return true;
-    } else if (strcmp(t->text, "include") == 0) {
-        pp_include(pp);
-        return true;
-    } else if (strcmp(t->text, "ifdef") == 0) {
-        pp_ifdef(pp, true);
-        return true;
-    } else if (strcmp(t->text, "ifndef") == 0) {
-        pp_ifdef(pp, false);
-        return true;
-    } else if (strcmp(t->text, "else") == 0) {
-        pp_else(pp, accept_else, true);
-        return false;
-    } else if (strcmp(t->text, "endif") == 0) {
-        pp_endif(pp, accept_endif);
-        return false;
-    } else {
-        fprintf(stderr, "error at %s(%d): unknown preprocessor directive #%s\n",
-                t->filename, t->line, t->text);
-        exit(1);
+    assert(out != NULL);
+    assert(tokens != NULL);
+
+    for (i = 0; i < tokens->size; i++) {
+        if (!pp_is_separator(tokens->data[i])) {
+            vec_push(out, tokens->data[i]);
+        }
     }
 }
 
-bool preprocess_line(Preprocessor *pp, bool accept_else, bool accept_endif) {
-    switch (pp_skip_separator(pp)->kind) {
-    case '\0':
-        return false;
+void pp_paste_tokens(Vec *out, bool lhs_is_empty, Vec *rhs) {
+    Token *lhs;
+    int i;
 
-    case '\n':
-        pp_consume_token(pp);
-        return true;
+    assert(out != NULL);
+    assert(rhs != NULL);
 
-    case '#':
-        return pp_directive(pp, accept_else, accept_endif);
+    if (lhs_is_empty) {
+        /* the left operand was an empty argument */
+        pp_append_tokens(out, rhs);
+        return;
+    }
 
-    default:
-        while (pp_skip_separator(pp)->kind != '\0' &&
-               pp_skip_separator(pp)->kind != '\n') {
-            pp_push_token(pp, pp_consume_token(pp));
+    for (i = 0; i < rhs->size; i++) {
+        if (!pp_is_separator(rhs->data[i])) {
+            break;
         }
-        return true;
     }
-}
 
-void preprocess_lines(Preprocessor *pp, bool accept_else, bool accept_endif) {
-    while (preprocess_line(pp, accept_else, accept_endif)) {
+    if (i == rhs->size) {
+        /* the right operand is an empty argument */
+        return;
     }
-}
 
-Vec *preprocess(const char *filename, const char *src,
-                Vec *include_directories) {
-    Preprocessor pp;
+    lhs = vec_pop(out);
+    vec_push(out, pp_paste(lhs, rhs->data[i]));
+
+    for (i = i + 1; i < rhs->size; i++) {
+        if (!pp_is_separator(rhs->data[i])) {
+            vec_push(out, rhs->data[i]);
+        }
+    }
+}
+
+Vec *pp_expand_arg(Preprocessor *pp, MacroArg *arg) {
+    assert(pp != NULL);
+    assert(arg != NULL);
+
+    /* an argument is fully expanded at most once per invocation */
+    if (arg->expanded == NULL) {
+        arg->expanded = pp_expand_tokens(pp, arg->tokens);
+    }
+
+    return arg->expanded;
+}
+
+Vec *pp_substitute(Preprocessor *pp, Macro *macro, MacroArg **args,
+                   Vec *hideset) {
+    Vec *out;
+    Vec *body;
+    Vec *rhs;
+    Token *t;
+    Token *next;
+    Vec *last_hideset;
+    Vec *union_hideset;
+    bool lhs_is_empty;
+    int param;
+    int next_param;
+    int i;
+
+    assert(pp != NULL);
+    assert(macro != NULL);
+
+    out = vec_new();
+    body = macro->body;
+    lhs_is_empty = false;
+    last_hideset = NULL;
+    union_hideset = NULL;
+    i = 0;
+
+    while (i < body->size) {
+        t = body->data[i];
+        next = NULL;
+        next_param = -1;
+
+        if (i + 1 < body->size) {
+            next = body->data[i + 1];
+            next_param = macro_param_index(macro, next);
+        }
+
+        param = macro_param_index(macro, t);
+
+        /* # parameter */
+        if (macro->is_function_like && t->kind == '#') {
+            if (next_param < 0) {
+                fprintf(stderr,
+                        "error at %s(%d): '#' is not followed by a macro "
+                        "parameter\n",
+                        t->filename, t->line);
+                exit(1);
+            }
+
+            vec_push(out, pp_stringize(t, args[next_param]->tokens));
+            i = i + 2;
+            continue;
+        }
+
+        /* , ## __VA_ARGS__ */
+        if (t->kind == ',' && next != NULL && next->kind == token_hash_hash &&
+            macro->is_variadic && i + 2 < body->size &&
+            macro_param_index(macro, body->data[i + 2]) ==
+                macro->params->size - 1) {
+            param = macro->params->size - 1;
+
+            /* the comma is removed if the variable arguments are empty */
+            if (!pp_is_empty_tokens(args[param]->tokens)) {
+                vec_push(out, t);
+                pp_append_tokens(out, args[param]->tokens);
+            }
+
+            i = i + 3;
+            continue;
+        }
+
+        /* ## operand */
+        if (t->kind == token_hash_hash) {
+            rhs = vec_new();
+
+            if (next_param >= 0) {
+                rhs = args[next_param]->tokens;
+            } else {
+                vec_push(rhs, next);
+            }
+
+            pp_paste_tokens(out, lhs_is_empty, rhs);
+            lhs_is_empty = false;
+            i = i + 2;
+            continue;
+        }
+
+        /* parameter as the left operand of ## */
+        if (param >= 0 && next != NULL && next->kind == token_hash_hash) {
+            lhs_is_empty = pp_is_empty_tokens(args[param]->tokens);
+            pp_append_tokens(out, args[param]->tokens);
+            i = i + 1;
+            continue;
+        }
+
+        /* parameter */
+        if (param >= 0) {
+            pp_append_tokens(out, pp_expand_arg(pp, args[param]));
+            i = i + 1;
+            continue;
+        }
+
+        vec_push(out, t);
+        i = i + 1;
+    }
+
+    /* apply the hide set, runs of tokens usually share the same hide set */
+    for (i = 0; i < out->size; i++) {
+        t = out->data[i];
+
+        if (i == 0 || t->hideset != last_hideset) {
+            last_hideset = t->hideset;
+            union_hideset = hideset_union(t->hideset, hideset);
+        }
+
+        out->data[i] = pp_copy_token(t, union_hideset);
+    }
+
+    return out;
+}
+
+Token *pp_next_arg_token(Preprocessor *pp, const Token *name) {
+    assert(pp != NULL);
+    assert(name != NULL);
+
+    if (pp->pending->size > 0) {
+        return vec_pop(pp->pending);
+    }
+
+    if (pp->is_isolated || pp_current_token(pp)->kind == '\0') {
+        fprintf(stderr,
+                "error at %s(%d): unterminated argument list invoking macro "
+                "%s\n",
+                name->filename, name->line, name->text);
+        exit(1);
+    }
+
+    return pp_consume_token(pp);
+}
+
+bool pp_consume_lparen(Preprocessor *pp) {
+    int index;
+
+    assert(pp != NULL);
+
+    if (pp->pending->size > 0) {
+        if (((Token *)vec_back(pp->pending))->kind != '(') {
+            return false;
+        }
+
+        vec_pop(pp->pending);
+        return true;
+    }
+
+    if (pp->is_isolated) {
+        return false;
+    }
+
+    /* the invocation may continue on the following lines */
+    index = pp->index;
+
+    while (pp_is_separator(pp_peek_token(pp, index))) {
+        index++;
+    }
+
+    if (pp_peek_token(pp, index)->kind != '(') {
+        return false;
+    }
+
+    pp->index = index + 1;
+    return true;
+}
+
+MacroArg **pp_read_macro_args(Preprocessor *pp, const Token *name,
+                              Macro *macro, Token **rparen) {
+    Vec *args;
+    MacroArg *arg;
+    Token *t;
+    int num_params;
+    int depth;
+
+    assert(pp != NULL);
+    assert(name != NULL);
+    assert(macro != NULL);
+    assert(rparen != NULL);
+
+    args = vec_new();
+    arg = macro_arg_new();
+    num_params = macro->params->size;
+    depth = 0;
+
+    while (1) {
+        t = pp_next_arg_token(pp, name);
+
+        if (t->kind == '(') {
+            depth++;
+        } else if (t->kind == ')') {
+            if (depth == 0) {
+                *rparen = t;
+                break;
+            }
+            depth--;
+        } else if (t->kind == ',' && depth == 0 &&
+                   !(macro->is_variadic && args->size == num_params - 1)) {
+            vec_push(args, arg);
+            arg = macro_arg_new();
+            continue;
+        }
+
+        vec_push(arg->tokens, t);
+    }
+
+    vec_push(args, arg);
+
+    /* F() passes no arguments to a macro without parameters */
+    if (num_params == 0 && pp_is_empty_tokens(arg->tokens)) {
+        vec_pop(args);
+    }
+
+    /* the variable arguments may be omitted */
+    if (macro->is_variadic && args->size == num_params - 1) {
+        vec_push(args, macro_arg_new());
+    }
+
+    if (args->size != num_params) {
+        fprintf(stderr,
+                "error at %s(%d): macro %s requires %d arguments, but %ld "
+                "given\n",
+                name->filename, name->line, name->text, num_params,
+                args->size);
+        exit(1);
+    }
+
+    return (MacroArg **)args->data;
+}
+
+void pp_expand_macro(Preprocessor *pp, Token *t, Macro *macro) {
+    MacroArg **args;
+    Token *rparen;
+    Vec *hideset;
+    Vec *expansion;
+    int i;
+
+    assert(pp != NULL);
+    assert(t != NULL);
+    assert(macro != NULL);
+
+    if (macro->is_function_like) {
+        args = pp_read_macro_args(pp, t, macro, &rparen);
+        hideset = hideset_intersection(t->hideset, rparen->hideset);
+    } else {
+        args = NULL;
+        hideset = t->hideset;
+    }
+
+    hideset = hideset_add(hideset, macro->name->text);
+    expansion = pp_substitute(pp, macro, args, hideset);
+
+    /* rescan the expansion along with the rest of the source */
+    for (i = expansion->size - 1; i >= 0; i--) {
+        vec_push(pp->pending, expansion->data[i]);
+    }
+}
+
+void pp_emit_token(Preprocessor *pp, Token *t) {
+    assert(pp != NULL);
+    assert(t != NULL);
+
+    if (t->kind == '\0' || t->kind == '\n' || t->kind == ' ') {
+        return;
+    }
+
+    /* an expanded argument is substituted into a macro body later */
+    if (pp->is_isolated) {
+        vec_push(pp->result, t);
+        return;
+    }
+
+    if (pp->result->size > 0 && t->kind == token_string &&
+        pp_last_token(pp)->kind == token_string) {
+        pp_concat_string(pp, t);
+        return;
+    }
+
+    /* keywords have been looked up by the lexer */
+    if (t->kind == token_identifier && t->keyword != 0) {
+        t->kind = t->keyword;
+    }
+
+    vec_push(pp->result, t);
+}
+
+void pp_push_token(Preprocessor *pp, Token *t) {
+    Macro *macro;
+
+    assert(pp != NULL);
+    assert(t != NULL);
+
+    if (t->kind == token_identifier) {
+        /* check if the identifier is a macro */
+        macro = map_get(pp->macros, t->text);
+
+        if (macro != NULL && !hideset_contains(t->hideset, t->text) &&
+            (!macro->is_function_like || pp_consume_lparen(pp))) {
+            pp_expand_macro(pp, t, macro);
+            return;
+        }
+    }
+
+    pp_emit_token(pp, t);
+}
+
+void pp_flush_pending(Preprocessor *pp) {
+    assert(pp != NULL);
+
+    while (pp->pending->size > 0) {
+        pp_push_token(pp, vec_pop(pp->pending));
+    }
+}
+
+Vec *pp_expand_tokens(Preprocessor *pp, Vec *tokens) {
+    Vec *saved_result;
+    Vec *saved_pending;
+    bool saved_is_isolated;
+    Vec *result;
+    int i;
+
+    assert(pp != NULL);
+    assert(tokens != NULL);
+
+    saved_result = pp->result;
+    saved_pending = pp->pending;
+    saved_is_isolated = pp->is_isolated;
+
+    /* expand the tokens without reading the rest of the source */
+    pp->result = vec_new();
+    pp->pending = vec_new();
+    pp->is_isolated = true;
+
+    for (i = tokens->size - 1; i >= 0; i--) {
+        if (!pp_is_separator(tokens->data[i])) {
+            vec_push(pp->pending, tokens->data[i]);
+        }
+    }
+
+    pp_flush_pending(pp);
+    result = pp->result;
+
+    pp->result = saved_result;
+    pp->pending = saved_pending;
+    pp->is_isolated = saved_is_isolated;
+
+    return result;
+}
+
+void pp_define_params(Preprocessor *pp, Macro *macro) {
+    Token *param;
+
+    assert(pp != NULL);
+    assert(macro != NULL);
+
+    macro->is_function_like = true;
+
+    /* ( */
+    pp_expect_token_kind(pp, '(');
+
+    if (pp_skip_separator(pp)->kind == ')') {
+        pp_consume_token(pp);
+        return;
+    }
+
+    while (1) {
+        /* ... */
+        if (pp_skip_separator(pp)->kind == token_var_args) {
+            pp_consume_token(pp);
+            macro->is_variadic = true;
+            vec_push(macro->params, "__VA_ARGS__");
+
+            pp_skip_separator(pp);
+            pp_expect_token_kind(pp, ')');
+            return;
+        }
+
+        /* identifier */
+        param = pp_expect_token_kind(pp, token_identifier);
+        vec_push(macro->params, param->text);
+
+        /* ) */
+        if (pp_skip_separator(pp)->kind == ')') {
+            pp_consume_token(pp);
+            return;
+        }
+
+        /* , */
+        pp_expect_token_kind(pp, ',');
+    }
+}
+
+void pp_define(Preprocessor *pp) {
+    Token *identifier;
+    Token *t;
+    Macro *macro;
+
+    /* define */
+    pp_expect_token(pp, "define");
+
+    /* identifier */
+    pp_skip_separator(pp);
+    identifier = pp_expect_token_kind(pp, token_identifier);
+    macro = macro_new(identifier);
+
+    /* parameters, '(' must follow the name immediately */
+    if (pp_current_token(pp)->kind == '(') {
+        pp_define_params(pp, macro);
+    }
+
+    /* macro contents */
+    while (pp_current_token(pp)->kind != '\0' &&
+           pp_current_token(pp)->kind != '\n') {
+        t = pp_consume_token(pp);
+
+        if (t->kind != ' ') {
+            vec_push(macro->body, t);
+        }
+    }
+
+    if (macro->body->size > 0 &&
+        (((Token *)macro->body->data[0])->kind == token_hash_hash ||
+         ((Token *)vec_back(macro->body))->kind == token_hash_hash)) {
+        fprintf(stderr,
+                "error at %s(%d): '##' cannot appear at either end of a macro "
+                "expansion\n",
+                identifier->filename, identifier->line);
+        exit(1);
+    }
+
+    /* redefinition check */
+    if (map_contains(pp->macros, identifier->text)) {
+        fprintf(stderr, "error at %s(%d): macro %s has already been defined\n",
+                identifier->filename, identifier->line, identifier->text);
+        exit(1);
+    }
+
+    /* register macro */
+    map_add(pp->macros, identifier->text, macro);
+}
+
+void pp_include(Preprocessor *pp) {
+    const Token *t;
+    const Token *filename;
+    char *path;
+    char *src;
+    SourceFile *file;
+
+    /* include */
+    t = pp_expect_token(pp, "include");
+
+    /* string */
+    pp_skip_separator(pp);
+    filename = pp_expect_token_kind(pp, token_string); /* TODO: <path> */
+
+    /* new line */
+    pp_expect_line_ending(pp);
+
+    /* check the depth of include stack */
+    if (pp->include_stack->size >= 256) {
+        fprintf(stderr, "error at %s(%d): #include nested too deeply\n",
+                t->filename, t->line);
+        exit(1);
+    }
+
+    /* open file */
+    if (!pp_read_file(pp, filename->string, &path, &src)) {
+        fprintf(stderr, "error at %s(%d): cannot include file %s\n",
+                t->filename, t->line, filename->string);
+        exit(1);
+    }
+
+    /* suspend the current file */
+    file = malloc(sizeof(*file));
+    file->lexer = pp->lexer;
+    file->tokens = pp->tokens;
+    file->index = pp->index;
+    file->num_conditionals = pp->conditionals->size;
+    vec_push(pp->file_stack, file);
+
+    /* read file, it is processed line by line from here */
+    pp->lexer = lexer_new(path, src);
+    pp->tokens = vec_new();
+    pp->index = 0;
+
+    /* push include stack */
+    vec_push(pp->include_stack, path);
+}
+
+Token *pp_number_token(const Token *where, int value) {
+    Token *t;
+
+    assert(where != NULL);
+    assert(value == 0 || value == 1);
+
+    t = pp_copy_token(where, NULL);
+    t->kind = token_number;
+    t->string = NULL;
+    t->len_string = 0;
+
+    if (value) {
+        t->text = "1";
+    } else {
+        t->text = "0";
+    }
+
+    return t;
+}
+
+Token *pp_eval_expect_token(Preprocessor *pp, int expected_token_kind) {
+    assert(pp != NULL);
+
+    if (pp_current_token(pp)->kind == expected_token_kind) {
+        return pp_consume_token(pp);
+    }
+
+    fprintf(stderr, "error at %s(%d): expected %c in #if, but got %s\n",
+            pp_current_token(pp)->filename, pp_current_token(pp)->line,
+            expected_token_kind, pp_current_token(pp)->text);
+    exit(1);
+}
+
+long pp_eval_primary(Preprocessor *pp, bool evaluated) {
+    Token *t;
+    long value;
+
+    t = pp_consume_token(pp);
+
+    switch (t->kind) {
+    case '(':
+        value = pp_eval_conditional(pp, evaluated);
+        pp_eval_expect_token(pp, ')');
+        return value;
+
+    case token_number:
+        errno = 0;
+
+        if (!lex_integer_value(t->text, &value) || errno == ERANGE) {
+            fprintf(stderr,
+                    "error at %s(%d): invalid integer constant %s in #if\n",
+                    t->filename, t->line, t->text);
+            exit(1);
+        }
+
+        return value;
+
+    case token_character:
+        return t->string[0];
+
+    case token_identifier:
+        /* identifiers remaining after macro expansion are 0 */
+        return 0;
+
+    default:
+        fprintf(stderr,
+                "error at %s(%d): unexpected token %s in #if expression\n",
+                t->filename, t->line, t->text);
+        exit(1);
+    }
+}
+
+long pp_eval_unary(Preprocessor *pp, bool evaluated) {
+    switch (pp_current_token(pp)->kind) {
+    case '+':
+        pp_consume_token(pp);
+        return pp_eval_unary(pp, evaluated);
+
+    case '-':
+        pp_consume_token(pp);
+        return -pp_eval_unary(pp, evaluated);
+
+    case '!':
+        pp_consume_token(pp);
+        return !pp_eval_unary(pp, evaluated);
+
+    case '~':
+        pp_consume_token(pp);
+        return -pp_eval_unary(pp, evaluated) - 1;
+
+    default:
+        return pp_eval_primary(pp, evaluated);
+    }
+}
+
+long pp_eval_multiplicative(Preprocessor *pp, bool evaluated) {
+    Token *t;
+    long value;
+    long rhs;
+
+    value = pp_eval_unary(pp, evaluated);
+
+    while (pp_current_token(pp)->kind == '*' ||
+           pp_current_token(pp)->kind == '/' ||
+           pp_current_token(pp)->kind == '%') {
+        t = pp_consume_token(pp);
+        rhs = pp_eval_unary(pp, evaluated);
+
+        if (t->kind == '*') {
+            value = value * rhs;
+            continue;
+        }
+
+        /* operands skipped by &&, || and ?: are parsed, not evaluated */
+        if (!evaluated) {
+            continue;
+        }
+
+        if (rhs == 0) {
+            fprintf(stderr, "error at %s(%d): division by zero in #if\n",
+                    t->filename, t->line);
+            exit(1);
+        }
+
+        if (t->kind == '/') {
+            value = value / rhs;
+        } else {
+            value = value % rhs;
+        }
+    }
+
+    return value;
+}
+
+long pp_eval_additive(Preprocessor *pp, bool evaluated) {
+    long value;
+
+    value = pp_eval_multiplicative(pp, evaluated);
+
+    while (1) {
+        if (pp_current_token(pp)->kind == '+') {
+            pp_consume_token(pp);
+            value = value + pp_eval_multiplicative(pp, evaluated);
+        } else if (pp_current_token(pp)->kind == '-') {
+            pp_consume_token(pp);
+            value = value - pp_eval_multiplicative(pp, evaluated);
+        } else {
+            return value;
+        }
+    }
+}
+
+long pp_eval_shift(Preprocessor *pp, bool evaluated) {
+    Token *t;
+    long value;
+    long rhs;
+
+    value = pp_eval_additive(pp, evaluated);
+
+    while (pp_current_token(pp)->kind == token_left_shift ||
+           pp_current_token(pp)->kind == token_right_shift) {
+        t = pp_consume_token(pp);
+        rhs = pp_eval_additive(pp, evaluated);
+
+        if (!evaluated) {
+            continue;
+        }
+
+        if (rhs < 0 || rhs > 63) {
+            fprintf(stderr,
+                    "error at %s(%d): shift count out of range in #if\n",
+                    t->filename, t->line);
+            exit(1);
+        }
+
+        /* a bit at a time, rounding a right shift toward negative infinity */
+        while (rhs > 0) {
+            if (t->kind == token_left_shift) {
+                value = value * 2;
+            } else if (value < 0 && value % 2 != 0) {
+                value = value / 2 - 1;
+            } else {
+                value = value / 2;
+            }
+
+            rhs--;
+        }
+    }
+
+    return value;
+}
+
+long pp_eval_relational(Preprocessor *pp, bool evaluated) {
+    long value;
+
+    value = pp_eval_shift(pp, evaluated);
+
+    while (1) {
+        switch (pp_current_token(pp)->kind) {
+        case '<':
+            pp_consume_token(pp);
+            value = value < pp_eval_shift(pp, evaluated);
+            break;
+
+        case '>':
+            pp_consume_token(pp);
+            value = value > pp_eval_shift(pp, evaluated);
+            break;
+
+        case token_lesser_equal:
+            pp_consume_token(pp);
+            value = value <= pp_eval_shift(pp, evaluated);
+            break;
+
+        case token_greater_equal:
+            pp_consume_token(pp);
+            value = value >= pp_eval_shift(pp, evaluated);
+            break;
+
+        default:
+            return value;
+        }
+    }
+}
+
+long pp_eval_equality(Preprocessor *pp, bool evaluated) {
+    long value;
+
+    value = pp_eval_relational(pp, evaluated);
+
+    while (1) {
+        if (pp_current_token(pp)->kind == token_equal) {
+            pp_consume_token(pp);
+            value = value == pp_eval_relational(pp, evaluated);
+        } else if (pp_current_token(pp)->kind == token_not_equal) {
+            pp_consume_token(pp);
+            value = value != pp_eval_relational(pp, evaluated);
+        } else {
+            return value;
+        }
+    }
+}
+
+long pp_eval_bitwise_and(Preprocessor *pp, bool evaluated) {
+    long value;
+
+    value = pp_eval_equality(pp, evaluated);
+
+    while (pp_current_token(pp)->kind == '&') {
+        pp_consume_token(pp);
+        value = value & pp_eval_equality(pp, evaluated);
+    }
+
+    return value;
+}
+
+long pp_eval_bitwise_xor(Preprocessor *pp, bool evaluated) {
+    long value;
+
+    value = pp_eval_bitwise_and(pp, evaluated);
+
+    while (pp_current_token(pp)->kind == '^') {
+        pp_consume_token(pp);
+        value = value ^ pp_eval_bitwise_and(pp, evaluated);
+    }
+
+    return value;
+}
+
+long pp_eval_bitwise_or(Preprocessor *pp, bool evaluated) {
+    long value;
+
+    value = pp_eval_bitwise_xor(pp, evaluated);
+
+    while (pp_current_token(pp)->kind == '|') {
+        pp_consume_token(pp);
+        value = value | pp_eval_bitwise_xor(pp, evaluated);
+    }
+
+    return value;
+}
+
+long pp_eval_logical_and(Preprocessor *pp, bool evaluated) {
+    long value;
+    long rhs;
+
+    value = pp_eval_bitwise_or(pp, evaluated);
+
+    while (pp_current_token(pp)->kind == token_and) {
+        pp_consume_token(pp);
+        rhs = pp_eval_bitwise_or(pp, evaluated && value != 0);
+        value = value && rhs;
+    }
+
+    return value;
+}
+
+long pp_eval_logical_or(Preprocessor *pp, bool evaluated) {
+    long value;
+    long rhs;
+
+    value = pp_eval_logical_and(pp, evaluated);
+
+    while (pp_current_token(pp)->kind == token_or) {
+        pp_consume_token(pp);
+        rhs = pp_eval_logical_and(pp, evaluated && value == 0);
+        value = value || rhs;
+    }
+
+    return value;
+}
+
+long pp_eval_conditional(Preprocessor *pp, bool evaluated) {
+    long condition;
+    long then_value;
+    long else_value;
+
+    condition = pp_eval_logical_or(pp, evaluated);
+
+    if (pp_current_token(pp)->kind != '?') {
+        return condition;
+    }
+
+    pp_consume_token(pp);
+    then_value = pp_eval_conditional(pp, evaluated && condition != 0);
+    pp_eval_expect_token(pp, ':');
+    else_value = pp_eval_conditional(pp, evaluated && condition == 0);
+
+    if (condition) {
+        return then_value;
+    }
+    return else_value;
+}
+
+bool pp_eval_condition(Preprocessor *pp, const Token *directive) {
+    Vec *tokens;
+    Token *t;
+    Token *name;
+    LexerContext *saved_lexer;
+    Vec *saved_tokens;
+    int saved_index;
+    long value;
+
+    assert(pp != NULL);
+    assert(directive != NULL);
+
+    /* replace defined X and defined(X) before expanding macros */
+    tokens = vec_new();
+
+    while (pp_skip_separator(pp)->kind != '\0' &&
+           pp_skip_separator(pp)->kind != '\n') {
+        t = pp_consume_token(pp);
+
+        if (t->kind != token_identifier || strcmp(t->text, "defined") != 0) {
+            vec_push(tokens, t);
+            continue;
+        }
+
+        if (pp_skip_separator(pp)->kind == '(') {
+            pp_consume_token(pp);
+            pp_skip_separator(pp);
+            name = pp_expect_token_kind(pp, token_identifier);
+            pp_skip_separator(pp);
+            pp_expect_token_kind(pp, ')');
+        } else {
+            name = pp_expect_token_kind(pp, token_identifier);
+        }
+
+        vec_push(tokens,
+                 pp_number_token(name, map_contains(pp->macros, name->text)));
+    }
+
+    if (tokens->size == 0) {
+        fprintf(stderr, "error at %s(%d): #%s with no expression\n",
+                directive->filename, directive->line, directive->text);
+        exit(1);
+    }
+
+    /* new line */
+    t = pp_expect_line_ending(pp);
+
+    /* evaluate the expanded line */
+    tokens = pp_expand_tokens(pp, tokens);
+    vec_push(tokens, pp_copy_token(t, NULL));
+    ((Token *)vec_back(tokens))->kind = '\0';
+
+    saved_lexer = pp->lexer;
+    saved_tokens = pp->tokens;
+    saved_index = pp->index;
+
+    pp->lexer = NULL;
+    pp->tokens = tokens;
+    pp->index = 0;
+
+    value = pp_eval_conditional(pp, true);
+
+    if (pp_current_token(pp)->kind != '\0') {
+        fprintf(stderr,
+                "error at %s(%d): missing binary operator before token %s\n",
+                pp_current_token(pp)->filename, pp_current_token(pp)->line,
+                pp_current_token(pp)->text);
+        exit(1);
+    }
+
+    pp->lexer = saved_lexer;
+    pp->tokens = saved_tokens;
+    pp->index = saved_index;
+
+    return value != 0;
+}
+
+void pp_skip_line(Preprocessor *pp) {
+    assert(pp != NULL);
+
+    while (pp_skip_separator(pp)->kind != '\0' &&
+           pp_skip_separator(pp)->kind != '\n') {
+        pp_consume_token(pp);
+    }
+}
+
+int pp_base_conditionals(Preprocessor *pp) {
+    assert(pp != NULL);
+
+    /* conditionals opened by the files including the current one */
+    if (pp->file_stack->size == 0) {
+        return 0;
+    }
+
+    return ((SourceFile *)vec_back(pp->file_stack))->num_conditionals;
+}
+
+bool pp_in_else_group(Preprocessor *pp) {
+    assert(pp != NULL);
+    assert(pp->conditionals->size > 0);
+
+    return (intptr_t)vec_back(pp->conditionals) != 0;
+}
+
+Token *pp_expect_conditional(Preprocessor *pp, const char *directive,
+                             bool accept_else_group) {
+    Token *t;
+
+    assert(pp != NULL);
+    assert(directive != NULL);
+
+    t = pp_expect_token(pp, directive);
+
+    if (pp->conditionals->size <= pp_base_conditionals(pp) ||
+        (!accept_else_group && pp_in_else_group(pp))) {
+        fprintf(stderr, "error at %s(%d): #%s without #if\n", t->filename,
+                t->line, t->text);
+        exit(1);
+    }
+
+    return t;
+}
+
+void pp_endif(Preprocessor *pp) {
+    /* endif */
+    pp_expect_conditional(pp, "endif", true);
+
+    /* new line */
+    pp_expect_line_ending(pp);
+
+    vec_pop(pp->conditionals);
+}
+
+void pp_skip_group(Preprocessor *pp, bool accept_else) {
+    Token *t;
+    int depth;
+
+    assert(pp != NULL);
+
+    depth = 0;
+
+    while (1) {
+        /* nothing has been lexed ahead only at the beginning of a line, skip
+           text lines there without making tokens */
+        if (pp->lexer != NULL && pp->index == pp->tokens->size) {
+            lex_skip_text_lines(pp->lexer);
+        }
+
+        switch (pp_skip_separator(pp)->kind) {
+        case '\0':
+            fprintf(stderr,
+                    "error at %s(%d): "
+                    "unexpected end of file, unterminated #if directives\n",
+                    pp_current_token(pp)->filename, pp_current_token(pp)->line);
+            exit(1);
+
+        case '\n':
+            pp_consume_token(pp);
+            break;
+
+        case '#':
+            pp_consume_token(pp); /* eat # */
+
+            /* identifier */
+            t = pp_skip_separator(pp);
+
+            if (strcmp(t->text, "if") == 0 || strcmp(t->text, "ifdef") == 0 ||
+                strcmp(t->text, "ifndef") == 0) {
+                depth++;
+                pp_skip_line(pp);
+            } else if (strcmp(t->text, "endif") == 0 && depth > 0) {
+                depth--;
+                pp_skip_line(pp);
+            } else if (strcmp(t->text, "endif") == 0) {
+                pp_endif(pp);
+                return;
+            } else if (strcmp(t->text, "else") == 0 && depth == 0 &&
+                       accept_else) {
+                pp_expect_conditional(pp, "else", false);
+                pp_expect_line_ending(pp);
+
+                /* process the #else group */
+                vec_pop(pp->conditionals);
+                vec_push(pp->conditionals, (void *)(intptr_t)true);
+                return;
+            } else if (strcmp(t->text, "elif") == 0 && depth == 0 &&
+                       accept_else) {
+                pp_consume_token(pp);
+
+                if (pp_eval_condition(pp, t)) {
+                    return;
+                }
+            } else {
+                pp_skip_line(pp);
+            }
+            break;
+
+        default:
+            pp_skip_line(pp);
+            break;
+        }
+    }
+}
+
+void pp_conditional(Preprocessor *pp, bool condition) {
+    assert(pp != NULL);
+
+    /* open a group, it is processed until #elif, #else or #endif */
+    vec_push(pp->conditionals, (void *)(intptr_t)false);
+
+    if (!condition) {
+        /* skip until #elif, #else or #endif */
+        pp_skip_group(pp, true);
+    }
+}
+
+void pp_ifdef(Preprocessor *pp, bool defined) {
+    Token *macro_name;
+
+    /* ifndef */
+    if (strcmp(pp_current_token(pp)->text, "ifdef") != 0 &&
+        strcmp(pp_current_token(pp)->text, "ifndef") != 0) {
+        fprintf(stderr,
+                "error at %s(%d): expected ifdef or ifndef, but got %s\n",
+                pp_current_token(pp)->filename, pp_current_token(pp)->line,
+                pp_current_token(pp)->text);
+        exit(1);
+    }
+    pp_consume_token(pp);
+
+    /* identifier */
+    pp_skip_separator(pp);
+    macro_name = pp_expect_token_kind(pp, token_identifier);
+
+    /* new line */
+    pp_expect_line_ending(pp);
+
+    /* check if the macro has been defined */
+    pp_conditional(pp, map_contains(pp->macros, macro_name->text) == defined);
+}
+
+void pp_if(Preprocessor *pp) {
+    const Token *t;
+
+    /* if */
+    t = pp_expect_token(pp, "if");
+
+    /* constant expression */
+    pp_conditional(pp, pp_eval_condition(pp, t));
+}
+
+void pp_elif(Preprocessor *pp) {
+    /* elif */
+    pp_expect_conditional(pp, "elif", false);
+
+    /* a preceding group has been processed, skip the rest */
+    pp_skip_line(pp);
+    pp_expect_line_ending(pp);
+    pp_skip_group(pp, false);
+}
+
+void pp_else(Preprocessor *pp) {
+    /* else */
+    pp_expect_conditional(pp, "else", false);
+
+    /* new line */
+    pp_expect_line_ending(pp);
+
+    /* a preceding group has been processed, skip the rest */
+    pp_skip_group(pp, false);
+}
+
+void pp_pragma(Preprocessor *pp) {
+    Token *t;
+    Token *end;
+    Vec *tokens;
+    Vec *expanded;
+    int i;
+
+    /* pragma */
+    t = pp_expect_token(pp, "pragma");
+
+    /* tokens to the end of the line */
+    tokens = vec_new();
+
+    while (pp_current_token(pp)->kind != '\0' &&
+           pp_current_token(pp)->kind != '\n') {
+        vec_push(tokens, pp_consume_token(pp));
+    }
+
+    end = pp_copy_token(pp_expect_line_ending(pp), NULL);
+    end->kind = '\n';
+
+    /* macros are expanded, so that the arguments can be configured */
+    expanded = pp_expand_tokens(pp, tokens);
+
+    /* the parser reads the pragma as an annotation ending with '\n' */
+    t = pp_copy_token(t, NULL);
+    t->kind = token_pragma;
+    vec_push(pp->result, t);
+
+    for (i = 0; i < expanded->size; i++) {
+        pp_emit_token(pp, expanded->data[i]);
+    }
+
+    vec_push(pp->result, end);
+}
+
+void pp_directive(Preprocessor *pp) {
+    Token *t;
+
+    /* # */
+    pp_expect_token_kind(pp, '#');
+
+    /* identifier */
+    t = pp_skip_separator(pp);
+
+    if (strcmp(t->text, "define") == 0) {
+        pp_define(pp);
+    } else if (strcmp(t->text, "include") == 0) {
+        pp_include(pp);
+    } else if (strcmp(t->text, "pragma") == 0) {
+        pp_pragma(pp);
+    } else if (strcmp(t->text, "if") == 0) {
+        pp_if(pp);
+    } else if (strcmp(t->text, "ifdef") == 0) {
+        pp_ifdef(pp, true);
+    } else if (strcmp(t->text, "ifndef") == 0) {
+        pp_ifdef(pp, false);
+    } else if (strcmp(t->text, "elif") == 0) {
+        pp_elif(pp);
+    } else if (strcmp(t->text, "else") == 0) {
+        pp_else(pp);
+    } else if (strcmp(t->text, "endif") == 0) {
+        pp_endif(pp);
+    } else {
+        fprintf(stderr, "error at %s(%d): unknown preprocessor directive #%s\n",
+                t->filename, t->line, t->text);
+        exit(1);
+    }
+}
+
+bool pp_end_of_file(Preprocessor *pp) {
+    SourceFile *file;
+
+    assert(pp != NULL);
+
+    if (pp->conditionals->size > pp_base_conditionals(pp)) {
+        fprintf(stderr,
+                "error at %s(%d): "
+                "unexpected end of file, unterminated #if directives\n",
+                pp_current_token(pp)->filename, pp_current_token(pp)->line);
+        exit(1);
+    }
+
+    if (pp->file_stack->size == 0) {
+        return false;
+    }
+
+    /* resume the including file */
+    file = vec_pop(pp->file_stack);
+    vec_pop(pp->include_stack);
+
+    pp->lexer = file->lexer;
+    pp->tokens = file->tokens;
+    pp->index = file->index;
+
+    return true;
+}
+
+bool preprocess_line(Preprocessor *pp) {
+    switch (pp_skip_separator(pp)->kind) {
+    case '\0':
+        return pp_end_of_file(pp);
+
+    case '\n':
+        pp_consume_token(pp);
+        return true;
+
+    case '#':
+        pp_directive(pp);
+        return true;
+
+    default:
+        while (pp->pending->size > 0 || (pp_skip_separator(pp)->kind != '\0' &&
+                                         pp_skip_separator(pp)->kind != '\n')) {
+            if (pp->pending->size > 0) {
+                pp_push_token(pp, vec_pop(pp->pending));
+            } else {
+                pp_push_token(pp, pp_consume_token(pp));
+            }
+        }
+        return true;
+    }
+}
+
+bool pp_has_next_token(Preprocessor *pp) {
+    int num_tokens;
+
+    assert(pp != NULL);
+
+    if (pp->is_end_of_file) {
+        return true;
+    }
+
+    /* a string may still be concatenated with the following one */
+    num_tokens = pp->result->size - pp->result_index;
+
+    return num_tokens >= 2 ||
+           (num_tokens == 1 && pp_last_token(pp)->kind != token_string);
+}
+
+Token *preprocessor_next_token(Preprocessor *pp) {
+    Token *t;
+
+    assert(pp != NULL);
+
+    /* process lines until a token is ready */
+    while (!pp_has_next_token(pp)) {
+        if (!preprocess_line(pp)) {
+            /* push end of file */
+            vec_push(pp->result, pp_current_token(pp));
+            pp->is_end_of_file = true;
+        }
+    }
+
+    t = pp->result->data[pp->result_index];
+
+    if (t->kind == '\0') {
+        return t;
+    }
+
+    if (t == pp->concat_token) {
+        pp_finish_concat(pp);
+    }
+
+    pp->result_index++;
+
+    /* reuse the buffer once every token has been read */
+    if (pp->result_index == pp->result->size) {
+        pp->result->size = 0;
+        pp->result_index = 0;
+    }
+
+    return t;
+}
+
+Preprocessor *preprocessor_new(const char *filename, const char *src,
+                               Vec *include_directories) {
+    Preprocessor *pp;
 
     assert(filename != NULL);
     assert(src != NULL);
     assert(include_directories != NULL);
 
     /* make preprocessor context */
-    pp.result = vec_new();
-    pp.tokens = (Token **)lex(filename, src)->data;
-    pp.index = 0;
-    pp.include_directories = include_directories;
-    pp.include_stack = vec_new();
-    pp.macros = map_new();
-    pp.keywords = map_new();
-
-    /* keywords */
-    map_add(pp.keywords, "if", (void *)(intptr_t)token_if);
-    map_add(pp.keywords, "else", (void *)(intptr_t)token_else);
-    map_add(pp.keywords, "switch", (void *)(intptr_t)token_switch);
-    map_add(pp.keywords, "case", (void *)(intptr_t)token_case);
-    map_add(pp.keywords, "default", (void *)(intptr_t)token_default);
-    map_add(pp.keywords, "while", (void *)(intptr_t)token_while);
-    map_add(pp.keywords, "do", (void *)(intptr_t)token_do);
-    map_add(pp.keywords, "for", (void *)(intptr_t)token_for);
-    map_add(pp.keywords, "return", (void *)(intptr_t)token_return);
-    map_add(pp.keywords, "break", (void *)(intptr_t)token_break);
-    map_add(pp.keywords, "continue", (void *)(intptr_t)token_continue);
-    map_add(pp.keywords, "void", (void *)(intptr_t)token_void);
-    map_add(pp.keywords, "char", (void *)(intptr_t)token_char);
-    map_add(pp.keywords, "int", (void *)(intptr_t)token_int);
-    map_add(pp.keywords, "long", (void *)(intptr_t)token_long);
-    map_add(pp.keywords, "unsigned", (void *)(intptr_t)token_unsigned);
-    map_add(pp.keywords, "const", (void *)(intptr_t)token_const);
-    map_add(pp.keywords, "struct", (void *)(intptr_t)token_struct);
-    map_add(pp.keywords, "typedef", (void *)(intptr_t)token_typedef);
-    map_add(pp.keywords, "extern", (void *)(intptr_t)token_extern);
-    map_add(pp.keywords, "sizeof", (void *)(intptr_t)token_sizeof);
+    pp = malloc(sizeof(*pp));
+    pp->result = vec_new();
+    pp->result_index = 0;
+    pp->concat_token = NULL;
+    pp->concat_text = str_builder_new();
+    pp->concat_string = str_builder_new();
+    pp->is_end_of_file = false;
+    pp->lexer = lexer_new(filename, src);
+    pp->tokens = vec_new();
+    pp->index = 0;
+    pp->pending = vec_new();
+    pp->is_isolated = false;
+    pp->include_directories = include_directories;
+    pp->include_stack = vec_new();
+    pp->file_stack = vec_new();
+    pp->conditionals = vec_new();
+    pp->macros = map_new();
 
     /* predefined macro */
 #ifdef __APPLE__
-    map_add(pp.macros, "__APPLE__", vec_new());
+    map_add(pp->macros, "__APPLE__", macro_new_predefined("__APPLE__"));
 #endif
 
 #ifdef __MINGW64__
-    map_add(pp.macros, "__MINGW64__", vec_new());
+    map_add(pp->macros, "__MINGW64__", macro_new_predefined("__MINGW64__"));
 #endif
 
-    vec_push(pp.include_stack, (char *)filename);
+    vec_push(pp->include_stack, (char *)filename);
+
+    return pp;
+}
+
+Vec *preprocess(const char *filename, const char *src,
+                Vec *include_directories) {
+    Preprocessor *pp;
+    Vec *tokens;
+    Token *t;
 
-    preprocess_lines(&pp, false, false);
+    pp = preprocessor_new(filename, src, include_directories);
+    tokens = vec_new();
 
-    /* push end of file */
-    vec_push(pp.result, pp_current_token(&pp));
+    do {
+        t = preprocessor_next_token(pp);
+        vec_push(tokens, t);
+    } while (t->kind != '\0');
 
-    return pp.result;
+    return tokens;
 }
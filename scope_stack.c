@@ -1,12 +1,28 @@
 #include "nocc.h"
 
+#define scope_stack_initial_names 256
+
+/* names are indexed by the id the lexer gave their spelling, each holding a
+   chain of its bindings from the innermost scope outward. the undo log
+   records the names in order of registration, so that leaving a scope
+   unlinks exactly the bindings it added. whether the innermost binding is a
+   typedef is kept on the name itself, so the parser can classify an
+   identifier without following the binding */
+
 ScopeStack *scope_stack_new(void) {
     ScopeStack *s;
+    int i;
 
     s = malloc(sizeof(*s));
-    s->scopes = vec_new();
+    s->names = malloc(sizeof(ScopeName *) * scope_stack_initial_names);
+    s->num_names = scope_stack_initial_names;
+    s->depth = 1;
+    s->undo_log = vec_new();
+    s->free_bindings = NULL;
 
-    scope_stack_push(s);
+    for (i = 0; i < s->num_names; i++) {
+        s->names[i] = NULL;
+    }
 
     return s;
 }
@@ -14,48 +30,147 @@ ScopeStack *scope_stack_new(void) {
 int scope_stack_depth(ScopeStack *s) {
     assert(s != NULL);
 
-    return s->scopes->size;
+    return s->depth;
 }
 
 void scope_stack_push(ScopeStack *s) {
     assert(s != NULL);
 
-    vec_push(s->scopes, map_new());
+    s->depth++;
 }
 
 void scope_stack_pop(ScopeStack *s) {
+    ScopeName *n;
+    ScopeBinding *b;
+
     assert(s != NULL);
-    assert(s->scopes->size > 1);
+    assert(s->depth > 1);
+
+    while (s->undo_log->size > 0) {
+        n = vec_back(s->undo_log);
+        b = n->binding;
 
-    vec_pop(s->scopes);
+        if (b->depth != s->depth) {
+            break;
+        }
+
+        vec_pop(s->undo_log);
+        n->binding = b->shadowed;
+        n->is_typedef = n->binding != NULL && n->binding->is_typedef;
+
+        b->shadowed = s->free_bindings;
+        s->free_bindings = b;
+    }
+
+    s->depth--;
+}
+
+void *scope_stack_find_id(ScopeStack *s, int name_id, bool recursive) {
+    ScopeName *n;
+
+    assert(s != NULL);
+    assert(name_id > 0);
+
+    if (name_id >= s->num_names) {
+        return NULL;
+    }
+
+    n = s->names[name_id];
+
+    if (n == NULL || n->binding == NULL) {
+        return NULL;
+    }
+
+    if (!recursive && n->binding->depth != s->depth) {
+        return NULL;
+    }
+
+    return n->binding->value;
 }
 
 void *scope_stack_find(ScopeStack *s, const char *name, bool recursive) {
-    void *value;
+    assert(s != NULL);
+    assert(name != NULL);
+
+    return scope_stack_find_id(s, lex_name_id(name), recursive);
+}
+
+bool scope_stack_is_typedef(ScopeStack *s, int name_id) {
+    assert(s != NULL);
+    assert(name_id > 0);
+
+    return name_id < s->num_names && s->names[name_id] != NULL &&
+           s->names[name_id]->is_typedef;
+}
+
+ScopeName *scope_stack_get_name(ScopeStack *s, int name_id) {
+    ScopeName *n;
+    int num_names;
     int i;
 
     assert(s != NULL);
-    assert(s->scopes->size > 0);
-    assert(name != NULL);
+    assert(name_id > 0);
+
+    if (name_id >= s->num_names) {
+        num_names = s->num_names;
 
-    i = s->scopes->size - 1;
+        while (name_id >= num_names) {
+            num_names = num_names * 2;
+        }
 
-    do {
-        value = map_get(s->scopes->data[i], name);
+        s->names = realloc(s->names, sizeof(ScopeName *) * num_names);
 
-        if (value != NULL) {
-            return value;
+        for (i = s->num_names; i < num_names; i++) {
+            s->names[i] = NULL;
         }
-    } while (--i >= 0 && recursive);
 
-    return NULL;
+        s->num_names = num_names;
+    }
+
+    /* names stay in the table once seen, even with no visible binding */
+    if (s->names[name_id] == NULL) {
+        n = malloc(sizeof(*n));
+        n->binding = NULL;
+        n->is_typedef = false;
+        s->names[name_id] = n;
+    }
+
+    return s->names[name_id];
 }
 
-void scope_stack_register(ScopeStack *s, const char *name, void *value) {
+void scope_stack_bind(ScopeStack *s, const char *name, void *value,
+                      bool is_typedef) {
+    ScopeName *n;
+    ScopeBinding *b;
+
     assert(s != NULL);
-    assert(s->scopes->size > 0);
     assert(name != NULL);
     assert(value != NULL);
 
-    map_add(vec_back(s->scopes), name, value);
+    n = scope_stack_get_name(s, lex_name_id(name));
+
+    if (s->free_bindings != NULL) {
+        b = s->free_bindings;
+        s->free_bindings = b->shadowed;
+    } else {
+        b = malloc(sizeof(*b));
+    }
+
+    b->value = value;
+    b->depth = s->depth;
+    b->is_typedef = is_typedef;
+    b->shadowed = n->binding;
+    n->binding = b;
+    n->is_typedef = is_typedef;
+
+    vec_push(s->undo_log, n);
+}
+
+void scope_stack_register(ScopeStack *s, const char *name, void *value) {
+    scope_stack_bind(s, name, value, false);
+}
+
+void scope_stack_register_typedef(ScopeStack *s, const char *name,
+                                  void *value) {
+    scope_stack_bind(s, name, value, true);
 }
@@ -4,6 +4,8 @@
 #define control_flow_state_break_bit 1
 #define control_flow_state_continue_bit 2
 
+#define struct_member_index_min_members 8
+
 void sema_push_scope(ParserContext *ctx) {
     assert(ctx != NULL);
 
@@ -18,34 +20,34 @@ void sema_pop_scope(ParserContext *ctx) {
     scope_stack_pop(ctx->env);
 }
 
-Vec *control_flow_state_new(void) {
-    Vec *state;
-
-    state = vec_new();
-    vec_push(state, (void *)(intptr_t)control_flow_state_none);
+void control_flow_init_state(ParserContext *ctx) {
+    assert(ctx != NULL);
 
-    return state;
+    small_vec_init(&ctx->flow_state);
+    small_vec_push(&ctx->flow_state,
+                   (void *)(intptr_t)control_flow_state_none);
 }
 
 int control_flow_current_state(ParserContext *ctx) {
     assert(ctx != NULL);
-    assert(ctx->flow_state->size > 0);
+    assert(ctx->flow_state.size > 0);
 
-    return (intptr_t)vec_back(ctx->flow_state);
+    return (intptr_t)small_vec_back(&ctx->flow_state);
 }
 
 void control_flow_push_state(ParserContext *ctx, int flow_state) {
     assert(ctx != NULL);
 
-    vec_push(ctx->flow_state,
-             (void *)((intptr_t)flow_state | control_flow_current_state(ctx)));
+    small_vec_push(&ctx->flow_state,
+                   (void *)((intptr_t)flow_state |
+                            control_flow_current_state(ctx)));
 }
 
 void control_flow_pop_state(ParserContext *ctx) {
     assert(ctx != NULL);
-    assert(ctx->flow_state->size > 1);
+    assert(ctx->flow_state.size > 1);
 
-    vec_pop(ctx->flow_state);
+    small_vec_pop(&ctx->flow_state);
 }
 
 bool is_break_accepted(ParserContext *ctx) {
@@ -66,8 +68,7 @@ ExprNode *implicit_cast_node_new(ExprNode *expr, Type *dest_type) {
 
     p = malloc(sizeof(*p));
     p->kind = node_cast;
-    p->filename = str_dup(expr->filename);
-    p->line = expr->line;
+    p->location = expr->location;
     p->type = dest_type;
     p->is_lvalue = false;
     p->operand = expr;
@@ -75,6 +76,263 @@ ExprNode *implicit_cast_node_new(ExprNode *expr, Type *dest_type) {
     return (ExprNode *)p;
 }
 
+ExprNode *constant_node_new(ExprNode *expr, long value) {
+    IntegerNode *p;
+
+    assert(expr != NULL);
+
+    p = malloc(sizeof(*p));
+    p->kind = node_integer;
+    p->location = expr->location;
+    p->type = expr->type;
+    p->is_lvalue = false;
+    p->value = value;
+
+    return (ExprNode *)p;
+}
+
+long integer_type_max(Type *t) {
+    long half;
+
+    assert(t != NULL);
+
+    if (is_int8_type(t)) {
+        return 127;
+    }
+
+    if (is_int32_type(t)) {
+        return INT_MAX;
+    }
+
+    /* 2^63 - 1, without a literal that does not fit in an int */
+    half = ((long)INT_MAX + 1) * ((long)INT_MAX + 1);
+    return half - 1 + half;
+}
+
+void constant_expr_overflow(ExprNode *p, const char *message) {
+    assert(p != NULL);
+    assert(message != NULL);
+
+    fprintf(stderr, "error at %s(%d): %s in constant expression\n",
+            source_location_filename(p->location),
+            source_location_line(p->location), message);
+    exit(1);
+}
+
+/* folds p in long. an operand skipped by &&, || is not evaluated, so its
+   overflow is not an error */
+bool fold_constant_expr(ExprNode *p, bool evaluated, long *value) {
+    long left;
+    long right;
+    long max;
+    long min;
+    long modulus;
+    long size;
+
+    assert(p != NULL);
+    assert(value != NULL);
+
+    switch (p->kind) {
+    case node_integer:
+        *value = ((IntegerNode *)p)->value;
+        return true;
+
+    case node_sizeof:
+        size = type_size(((SizeofNode *)p)->operand);
+
+        if (size < 0 || size > INT_MAX) {
+            return false;
+        }
+
+        *value = size;
+        return true;
+
+    case node_cast:
+        if (!is_integer_type(p->type) ||
+            !fold_constant_expr(((CastNode *)p)->operand, evaluated, value)) {
+            return false;
+        }
+
+        /* truncate into the range of the type */
+        max = integer_type_max(p->type);
+
+        if (*value > max || *value < -max - 1) {
+            modulus = (max + 1) * 2;
+            *value = *value % modulus;
+
+            if (*value > max) {
+                *value = *value - modulus;
+            } else if (*value < -max - 1) {
+                *value = *value + modulus;
+            }
+        }
+        return true;
+
+    case node_unary:
+        if (!fold_constant_expr(((UnaryNode *)p)->operand, evaluated,
+                                &right)) {
+            return false;
+        }
+
+        switch (((UnaryNode *)p)->operator_) {
+        case '+':
+            *value = right;
+            return true;
+
+        case '-':
+            if (right < -integer_type_max(p->type)) {
+                if (evaluated) {
+                    constant_expr_overflow(p, "overflow");
+                }
+                right = 0;
+            }
+            *value = -right;
+            return true;
+
+        case '!':
+            *value = !right;
+            return true;
+
+        default:
+            return false;
+        }
+
+    case node_binary:
+        if (!fold_constant_expr(((BinaryNode *)p)->left, evaluated, &left)) {
+            return false;
+        }
+
+        /* the right operand of && and || may be skipped */
+        if (((BinaryNode *)p)->operator_ == token_and) {
+            evaluated = evaluated && left != 0;
+        } else if (((BinaryNode *)p)->operator_ == token_or) {
+            evaluated = evaluated && left == 0;
+        }
+
+        if (!fold_constant_expr(((BinaryNode *)p)->right, evaluated,
+                                &right)) {
+            return false;
+        }
+
+        /* operands are in the range of the type of the result */
+        max = integer_type_max(p->type);
+        min = -max - 1;
+
+        switch (((BinaryNode *)p)->operator_) {
+        case '+':
+            if ((right > 0 && left > max - right) ||
+                (right < 0 && left < min - right)) {
+                break;
+            }
+            *value = left + right;
+            return true;
+
+        case '-':
+            if ((right < 0 && left > max + right) ||
+                (right > 0 && left < min + right)) {
+                break;
+            }
+            *value = left - right;
+            return true;
+
+        case '*':
+            if ((left > 0 && right > 0 && left > max / right) ||
+                (left > 0 && right < 0 && right < min / left) ||
+                (left < 0 && right > 0 && left < min / right) ||
+                (left < 0 && right < 0 && left < max / right)) {
+                break;
+            }
+            *value = left * right;
+            return true;
+
+        case '/':
+        case '%':
+            if (right == 0) {
+                if (evaluated) {
+                    constant_expr_overflow(p, "division by zero");
+                }
+                *value = 0;
+                return true;
+            }
+
+            if (left == min && right == -1) {
+                break;
+            }
+
+            if (((BinaryNode *)p)->operator_ == '/') {
+                *value = left / right;
+            } else {
+                *value = left % right;
+            }
+            return true;
+
+        case '<':
+            *value = left < right;
+            return true;
+
+        case '>':
+            *value = left > right;
+            return true;
+
+        case token_lesser_equal:
+            *value = left <= right;
+            return true;
+
+        case token_greater_equal:
+            *value = left >= right;
+            return true;
+
+        case token_equal:
+            *value = left == right;
+            return true;
+
+        case token_not_equal:
+            *value = left != right;
+            return true;
+
+        case '&':
+            *value = left & right;
+            return true;
+
+        case '^':
+            *value = left ^ right;
+            return true;
+
+        case '|':
+            *value = left | right;
+            return true;
+
+        case token_and:
+            *value = left && right;
+            return true;
+
+        case token_or:
+            *value = left || right;
+            return true;
+
+        default:
+            return false;
+        }
+
+        /* the result does not fit in the type */
+        if (evaluated) {
+            constant_expr_overflow(p, "overflow");
+        }
+        *value = 0;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool evaluate_constant_expr(ExprNode *p, long *value) {
+    assert(p != NULL);
+    assert(value != NULL);
+
+    return fold_constant_expr(p, true, value);
+}
+
 bool can_cast_into(Type *src_type, Type *dest_type) {
     assert(src_type != NULL);
     assert(dest_type != NULL);
@@ -86,10 +344,12 @@ bool can_cast_into(Type *src_type, Type *dest_type) {
 
     case type_int8:
     case type_int32:
+    case type_int64:
     case type_pointer:
         switch (src_type->kind) {
         case type_int8:
         case type_int32:
+        case type_int64:
         case type_pointer:
             return true;
 
@@ -102,10 +362,26 @@ bool can_cast_into(Type *src_type, Type *dest_type) {
     }
 }
 
+void mark_address_taken(ExprNode *expr) {
+    assert(expr != NULL);
+
+    /* &x.a.b takes the address of x */
+    while (expr->kind == node_dot) {
+        expr = ((DotNode *)expr)->parent;
+    }
+
+    if (expr->kind == node_identifier) {
+        ((IdentifierNode *)expr)->symbol->is_address_taken = true;
+    }
+}
+
 ExprNode *decay_type_conversion(ExprNode *expr) {
     assert(expr != NULL);
 
     if (is_array_type(expr->type)) {
+        /* T[] -> T* refers to the array object */
+        mark_address_taken(expr);
+
         return implicit_cast_node_new(
             expr, pointer_type_new(array_element_type(expr->type)));
     }
@@ -137,6 +413,18 @@ void usual_arithmetic_conversion(ExprNode **left, ExprNode **right) {
 
     *left = integer_promotion(*left);
     *right = integer_promotion(*right);
+
+    if (!is_integer_type((*left)->type) || !is_integer_type((*right)->type)) {
+        return;
+    }
+
+    /* int32 op int64 -> int64 op int64 */
+    if (is_int64_type((*left)->type) && !is_int64_type((*right)->type)) {
+        *right = implicit_cast_node_new(*right, (*left)->type);
+    } else if (!is_int64_type((*left)->type) &&
+               is_int64_type((*right)->type)) {
+        *left = implicit_cast_node_new(*left, (*right)->type);
+    }
 }
 
 bool relational_operation_type_conversion(ExprNode **left, ExprNode **right) {
@@ -145,8 +433,7 @@ bool relational_operation_type_conversion(ExprNode **left, ExprNode **right) {
     assert(right != NULL);
     assert(*right != NULL);
 
-    *left = integer_promotion(*left);
-    *right = integer_promotion(*right);
+    usual_arithmetic_conversion(left, right);
 
     if (!is_scalar_type((*left)->type) || !is_scalar_type((*right)->type)) {
         return false;
@@ -199,6 +486,7 @@ bool default_argument_promotion(ExprNode **expr) {
     switch ((*expr)->type->kind) {
     case type_int8:
     case type_int32:
+    case type_int64:
     case type_pointer:
     case type_struct:
         return true;
@@ -215,7 +503,7 @@ Type *sema_identifier_type(ParserContext *ctx, const Token *t) {
     assert(t != NULL);
 
     /* find symbol */
-    p = scope_stack_find(ctx->env, t->text, true);
+    p = scope_stack_find_id(ctx->env, t->name_id, true);
 
     if (p == NULL) {
         fprintf(stderr, "error at %s(%d): type %s not found in this scope\n",
@@ -243,23 +531,25 @@ MemberNode *sema_struct_member(ParserContext *ctx, Type *type, const Token *t) {
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_member;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->symbol =
-        (Symbol *)variable_symbol_new(t->filename, t->line, t->text, type);
+        (Symbol *)variable_symbol_new(t->location, t->text, type);
 
     /* type check */
     if (is_incomplete_type(p->symbol->type)) {
         fprintf(stderr,
                 "error at %s(%d): member of struct must be a complete type\n",
-                p->filename, p->line);
+                source_location_filename(p->location),
+                source_location_line(p->location));
         exit(1);
     }
 
     /* redefinition check */
     if (scope_stack_find(ctx->env, p->symbol->identifier, false)) {
         fprintf(stderr, "error at %s(%d): member %s is already defined\n",
-                p->symbol->filename, p->symbol->line, p->symbol->identifier);
+                source_location_filename(p->symbol->location),
+                source_location_line(p->symbol->location),
+                p->symbol->identifier);
         exit(1);
     }
 
@@ -290,13 +580,14 @@ StructType *sema_struct_type_register_or_new(ParserContext *ctx, const Token *t,
     p->symbol = NULL;
     p->members = NULL;
     p->num_members = 0;
+    p->member_index = NULL;
     p->is_incomplete = true;
     p->generated_type = NULL;
 
     if (identifier != NULL) {
         /* make symbol */
-        p->symbol = type_symbol_new(identifier->filename, identifier->line,
-                                    identifier->text, (Type *)p);
+        p->symbol =
+            type_symbol_new(identifier->location, identifier->text, (Type *)p);
 
         /* register struct type symbol */
         scope_stack_register(ctx->struct_env, p->symbol->identifier, p);
@@ -360,12 +651,18 @@ Type *sema_struct_type_leave(ParserContext *ctx, StructType *type,
     }
 
     /* fix struct type */
-    type->members = malloc(sizeof(MemberNode *) * num_members);
+    type->members = members;
     type->num_members = num_members;
     type->is_incomplete = false;
 
-    for (i = 0; i < num_members; i++) {
-        type->members[i] = members[i];
+    /* index wide structs by member name */
+    if (num_members >= struct_member_index_min_members) {
+        type->member_index = map_new();
+
+        for (i = 0; i < num_members; i++) {
+            map_add(type->member_index, members[i]->symbol->identifier,
+                    (void *)(intptr_t)(i + 1));
+        }
     }
 
     return (Type *)type;
@@ -389,8 +686,7 @@ ExprNode *sema_integer_expr(ParserContext *ctx, const Token *t, int value) {
 
     p = malloc(sizeof(*p));
     p->kind = node_integer;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->type = type_get_int32();
     p->is_lvalue = false;
     p->value = value;
@@ -409,8 +705,7 @@ ExprNode *sema_string_expr(ParserContext *ctx, const Token *t,
 
     p = malloc(sizeof(*p));
     p->kind = node_string;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->type = array_type_new(type_get_int8(), length + 1);
     p->is_lvalue = false;
     p->string = malloc(sizeof(char) * (length + 1));
@@ -424,19 +719,22 @@ ExprNode *sema_string_expr(ParserContext *ctx, const Token *t,
 
 ExprNode *sema_identifier_expr(ParserContext *ctx, const Token *t) {
     IdentifierNode *p;
+    DeclNode *decl;
     Symbol *symbol;
 
     assert(ctx != NULL);
     assert(t != NULL);
 
-    symbol = ((DeclNode *)scope_stack_find(ctx->env, t->text, true))->symbol;
+    decl = scope_stack_find_id(ctx->env, t->name_id, true);
 
-    if (symbol == NULL) {
+    if (decl == NULL) {
         fprintf(stderr, "error at %s(%d): undeclared symbol %s\n", t->filename,
                 t->line, t->text);
         exit(1);
     }
 
+    symbol = decl->symbol;
+
     if (symbol->kind != symbol_variable) {
         fprintf(stderr, "error at %s(%d): symbol %s is not a variable\n",
                 t->filename, t->line, t->text);
@@ -445,8 +743,7 @@ ExprNode *sema_identifier_expr(ParserContext *ctx, const Token *t) {
 
     p = malloc(sizeof(*p));
     p->kind = node_identifier;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->type = symbol->type;
     p->is_lvalue = true;
     p->symbol = (VariableSymbol *)symbol;
@@ -465,8 +762,7 @@ ExprNode *sema_postfix_expr(ParserContext *ctx, ExprNode *operand,
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_postfix;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->type = NULL;
     p->is_lvalue = false;
     p->operand = operand;
@@ -479,7 +775,8 @@ ExprNode *sema_postfix_expr(ParserContext *ctx, ExprNode *operand,
             fprintf(stderr,
                     "error at %s(%d): "
                     "operand of postfix operator %s must be a lvalue\n",
-                    p->operand->filename, p->operand->line, t->text);
+                    source_location_filename(p->operand->location),
+                    source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
@@ -488,7 +785,8 @@ ExprNode *sema_postfix_expr(ParserContext *ctx, ExprNode *operand,
                     "error at %s(%d): "
                     "operand of postfix operator %s cannot be a pointer "
                     "of incomplete type\n",
-                    p->operand->filename, p->operand->line, t->text);
+                    source_location_filename(p->operand->location),
+                    source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
@@ -496,7 +794,8 @@ ExprNode *sema_postfix_expr(ParserContext *ctx, ExprNode *operand,
             fprintf(stderr,
                     "error at %s(%d): "
                     "invalid operand type of postfix operator %s\n",
-                    p->operand->filename, p->operand->line, t->text);
+                    source_location_filename(p->operand->location),
+                    source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
@@ -513,6 +812,23 @@ ExprNode *sema_postfix_expr(ParserContext *ctx, ExprNode *operand,
     return (ExprNode *)p;
 }
 
+void sema_builtin_constant_arg(CallNode *p, int index) {
+    long value;
+
+    assert(p != NULL);
+    assert(index >= 0 && index < p->num_args);
+
+    if (!evaluate_constant_expr(p->args[index], &value)) {
+        fprintf(stderr,
+                "error at %s(%d): argument of builtin must be a constant\n",
+                source_location_filename(p->args[index]->location),
+                source_location_line(p->args[index]->location));
+        exit(1);
+    }
+
+    p->args[index] = constant_node_new(p->args[index], value);
+}
+
 ExprNode *sema_call_expr(ParserContext *ctx, ExprNode *callee,
                          const Token *open, ExprNode **args, int num_args,
                          const Token *close) {
@@ -531,22 +847,23 @@ ExprNode *sema_call_expr(ParserContext *ctx, ExprNode *callee,
 
     p = malloc(sizeof(*p));
     p->kind = node_call;
-    p->filename = str_dup(open->filename);
-    p->line = open->line;
+    p->location = open->location;
     p->type = NULL;
     p->is_lvalue = false;
     p->callee = decay_type_conversion(callee);
-    p->args = malloc(sizeof(ExprNode *) * num_args);
+    p->args = args;
     p->num_args = num_args;
+    p->builtin = 0;
 
-    for (i = 0; i < num_args; i++) {
-        p->args[i] = args[i];
+    if (callee->kind == node_identifier) {
+        p->builtin = ((IdentifierNode *)callee)->symbol->builtin;
     }
 
     /* callee type */
     if (!is_function_pointer_type(p->callee->type)) {
         fprintf(stderr, "error at %s(%d): invalid callee type\n",
-                p->callee->filename, p->callee->line);
+                source_location_filename(p->callee->location),
+                source_location_line(p->callee->location));
         exit(1);
     }
 
@@ -557,7 +874,8 @@ ExprNode *sema_call_expr(ParserContext *ctx, ExprNode *callee,
     /* check argument types */
     if (num_args != num_params && !(is_var_args && num_args >= num_params)) {
         fprintf(stderr, "error at %s(%d): invalid number of arguments\n",
-                p->filename, p->line);
+                source_location_filename(p->location),
+                source_location_line(p->location));
         exit(1);
     }
 
@@ -565,7 +883,8 @@ ExprNode *sema_call_expr(ParserContext *ctx, ExprNode *callee,
         if (!assign_type_conversion(&p->args[i],
                                     function_param_type(func_type, i))) {
             fprintf(stderr, "error at %s(%d): invalid type of argument\n",
-                    p->args[i]->filename, p->args[i]->line);
+                    source_location_filename(p->args[i]->location),
+                    source_location_line(p->args[i]->location));
             exit(1);
         }
     }
@@ -575,11 +894,30 @@ ExprNode *sema_call_expr(ParserContext *ctx, ExprNode *callee,
         if (!default_argument_promotion(&p->args[i])) {
             fprintf(stderr,
                     "error at %s(%d): invalid type of varidic argument\n",
-                    p->args[i]->filename, p->args[i]->line);
+                    source_location_filename(p->args[i]->location),
+                    source_location_line(p->args[i]->location));
             exit(1);
         }
     }
 
+    /* arguments of builtins that must be constant */
+    if (p->builtin == builtin_expect) {
+        sema_builtin_constant_arg(p, 1);
+    }
+
+    if (p->builtin == builtin_prefetch) {
+        if (num_args > 3) {
+            fprintf(stderr, "error at %s(%d): invalid number of arguments\n",
+                    source_location_filename(p->location),
+                    source_location_line(p->location));
+            exit(1);
+        }
+
+        for (i = 1; i < num_args; i++) {
+            sema_builtin_constant_arg(p, i);
+        }
+    }
+
     /* result type */
     p->type = function_return_type(func_type);
 
@@ -599,8 +937,7 @@ ExprNode *sema_dot_expr(ParserContext *ctx, ExprNode *parent, const Token *t,
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_dot;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->type = NULL;
     p->is_lvalue = false;
     p->parent = parent;
@@ -612,7 +949,8 @@ ExprNode *sema_dot_expr(ParserContext *ctx, ExprNode *parent, const Token *t,
         fprintf(stderr,
                 "error at %s(%d): "
                 "member reference base type must be a struct type\n",
-                p->parent->filename, p->parent->line);
+                source_location_filename(p->parent->location),
+                source_location_line(p->parent->location));
         exit(1);
     }
 
@@ -648,7 +986,8 @@ ExprNode *sema_arrow_expr(ParserContext *ctx, ExprNode *parent, const Token *t,
     if (!is_pointer_type(parent->type)) {
         fprintf(stderr,
                 "error at %s(%d): invalid operand type of opeartor ->\n",
-                parent->filename, parent->line);
+                source_location_filename(parent->location),
+                source_location_line(parent->location));
         exit(1);
     }
 
@@ -656,15 +995,15 @@ ExprNode *sema_arrow_expr(ParserContext *ctx, ExprNode *parent, const Token *t,
         fprintf(stderr,
                 "error at %s(%d): "
                 "cannot access member of incomplete pointer type\n",
-                parent->filename, parent->line);
+                source_location_filename(parent->location),
+                source_location_line(parent->location));
         exit(1);
     }
 
     /* make *parent node */
     p = malloc(sizeof(*p));
     p->kind = node_unary;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->type = pointer_element_type(parent->type);
     p->is_lvalue = true;
     p->operator_ = '*';
@@ -684,8 +1023,7 @@ ExprNode *sema_unary_expr(ParserContext *ctx, const Token *t,
 
     p = malloc(sizeof(*p));
     p->kind = node_unary;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->type = NULL;
     p->is_lvalue = false;
     p->operator_ = t->kind;
@@ -696,11 +1034,12 @@ ExprNode *sema_unary_expr(ParserContext *ctx, const Token *t,
     case '-':
         p->operand = integer_promotion(p->operand);
 
-        if (!is_int32_type(p->operand->type)) {
+        if (!is_integer_type(p->operand->type)) {
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of unary operator %s\n",
-                p->operand->filename, p->operand->line, t->text);
+                source_location_filename(p->operand->location),
+                source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
@@ -714,7 +1053,8 @@ ExprNode *sema_unary_expr(ParserContext *ctx, const Token *t,
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of unary operator %s\n",
-                p->operand->filename, p->operand->line, t->text);
+                source_location_filename(p->operand->location),
+                source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
@@ -722,7 +1062,8 @@ ExprNode *sema_unary_expr(ParserContext *ctx, const Token *t,
             fprintf(stderr,
                     "error at %s(%d): "
                     "cannot dereference pointer of incomplete type\n",
-                    p->operand->filename, p->operand->line);
+                    source_location_filename(p->operand->location),
+                    source_location_line(p->operand->location));
             exit(1);
         }
 
@@ -735,10 +1076,13 @@ ExprNode *sema_unary_expr(ParserContext *ctx, const Token *t,
             fprintf(stderr,
                     "error at %s(%d): "
                     "operand of unary operator %s must be a lvalue\n",
-                    p->operand->filename, p->operand->line, t->text);
+                    source_location_filename(p->operand->location),
+                    source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
+        mark_address_taken(p->operand);
+
         p->type = pointer_type_new(p->operand->type);
         break;
 
@@ -749,7 +1093,8 @@ ExprNode *sema_unary_expr(ParserContext *ctx, const Token *t,
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of unary operator %s\n",
-                p->operand->filename, p->operand->line, t->text);
+                source_location_filename(p->operand->location),
+                source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
@@ -762,7 +1107,8 @@ ExprNode *sema_unary_expr(ParserContext *ctx, const Token *t,
             fprintf(stderr,
                     "error at %s(%d): "
                     "operand of prefix operator %s must be a lvalue\n",
-                    p->operand->filename, p->operand->line, t->text);
+                    source_location_filename(p->operand->location),
+                    source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
@@ -771,7 +1117,8 @@ ExprNode *sema_unary_expr(ParserContext *ctx, const Token *t,
                     "error at %s(%d): "
                     "operand of prefix operator %s cannot be "
                     "a pointer of incomplete type\n",
-                    p->operand->filename, p->operand->line, t->text);
+                    source_location_filename(p->operand->location),
+                    source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
@@ -779,7 +1126,8 @@ ExprNode *sema_unary_expr(ParserContext *ctx, const Token *t,
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of prefix operator %s\n",
-                p->operand->filename, p->operand->line, t->text);
+                source_location_filename(p->operand->location),
+                source_location_line(p->operand->location), t->text);
             exit(1);
         }
 
@@ -805,9 +1153,8 @@ ExprNode *sema_sizeof_expr(ParserContext *ctx, const Token *t, Type *operand) {
 
     p = malloc(sizeof(*p));
     p->kind = node_sizeof;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
-    p->type = type_get_int32(); /* TODO: size_t */
+    p->location = t->location;
+    p->type = type_get_int64(); /* size_t */
     p->is_lvalue = false;
     p->operand = operand;
 
@@ -833,8 +1180,7 @@ ExprNode *sema_cast_expr(ParserContext *ctx, const Token *open, Type *type,
 
     p = malloc(sizeof(*p));
     p->kind = node_cast;
-    p->filename = str_dup(open->filename);
-    p->line = open->line;
+    p->location = open->location;
     p->type = type;
     p->is_lvalue = false;
     p->operand = operand;
@@ -846,8 +1192,9 @@ ExprNode *sema_cast_expr(ParserContext *ctx, const Token *open, Type *type,
 
     /* type check */
     if (!can_cast_into(p->operand->type, p->type)) {
-        fprintf(stderr, "error at %s(%d): invalid type cast\n", p->filename,
-                p->line);
+        fprintf(stderr, "error at %s(%d): invalid type cast\n",
+                source_location_filename(p->location),
+                source_location_line(p->location));
         exit(1);
     }
 
@@ -865,8 +1212,7 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
 
     p = malloc(sizeof(*p));
     p->kind = node_binary;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->type = NULL;
     p->is_lvalue = false;
     p->operator_ = t->kind;
@@ -884,7 +1230,8 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
             fprintf(stderr,
                     "error at %s(%d): "
                     "arithmetic on a pointer to an incomplete type\n",
-                    p->filename, p->line);
+                    source_location_filename(p->location),
+                    source_location_line(p->location));
             exit(1);
         } else if (is_integer_type(p->left->type) &&
                    is_integer_type(p->right->type)) {
@@ -902,7 +1249,8 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of binary operator %s\n",
-                p->filename, p->line, t->text);
+                source_location_filename(p->location),
+                source_location_line(p->location), t->text);
             exit(1);
         }
         break;
@@ -921,12 +1269,13 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
         } else if (is_pointer_type(p->left->type) &&
                    is_pointer_type(p->right->type)) {
             /* T* - T* -> ptrdiff_t */
-            p->type = type_get_int32();
+            p->type = type_get_int64();
         } else {
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of binary operator %s\n",
-                p->filename, p->line, t->text);
+                source_location_filename(p->location),
+                source_location_line(p->location), t->text);
             exit(1);
         }
         break;
@@ -945,7 +1294,8 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of binary operator %s\n",
-                p->filename, p->line, t->text);
+                source_location_filename(p->location),
+                source_location_line(p->location), t->text);
             exit(1);
         }
         break;
@@ -961,7 +1311,8 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of binary operator %s\n",
-                p->filename, p->line, t->text);
+                source_location_filename(p->location),
+                source_location_line(p->location), t->text);
             exit(1);
         }
 
@@ -974,11 +1325,13 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
         /* bitwise operator */
         usual_arithmetic_conversion(&p->left, &p->right);
 
-        if (!is_int32_type(p->left->type) || !is_int32_type(p->right->type)) {
+        if (!is_integer_type(p->left->type) ||
+            !is_integer_type(p->right->type)) {
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of binary operator %s\n",
-                p->filename, p->line, t->text);
+                source_location_filename(p->location),
+                source_location_line(p->location), t->text);
             exit(1);
         }
 
@@ -994,7 +1347,8 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of binary operator %s\n",
-                p->filename, p->line, t->text);
+                source_location_filename(p->location),
+                source_location_line(p->location), t->text);
             exit(1);
         }
 
@@ -1005,7 +1359,8 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
         /* assignment operator */
         if (!p->left->is_lvalue) {
             fprintf(stderr, "error at %s(%d): cannot assign to rvalue\n",
-                    p->left->filename, p->left->line);
+                    source_location_filename(p->left->location),
+                    source_location_line(p->left->location));
             exit(1);
         }
 
@@ -1014,7 +1369,8 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
             fprintf(
                 stderr,
                 "error at %s(%d): invalid operand type of binary operator %s\n",
-                p->filename, p->line, t->text);
+                source_location_filename(p->location),
+                source_location_line(p->location), t->text);
             exit(1);
         }
 
@@ -1031,7 +1387,8 @@ ExprNode *sema_binary_expr(ParserContext *ctx, ExprNode *left, const Token *t,
         } else {
             fprintf(stderr,
                     "error at %s(%d): invalid operand type of operator []\n",
-                    p->filename, p->line);
+                    source_location_filename(p->location),
+                    source_location_line(p->location));
             exit(1);
         }
         break;
@@ -1056,7 +1413,6 @@ StmtNode *sema_compound_stmt_leave(ParserContext *ctx, const Token *open,
                                    StmtNode **stmts, int num_stmts,
                                    const Token *close) {
     CompoundNode *p;
-    int i;
 
     assert(ctx != NULL);
     assert(open != NULL);
@@ -1069,15 +1425,10 @@ StmtNode *sema_compound_stmt_leave(ParserContext *ctx, const Token *open,
 
     p = malloc(sizeof(*p));
     p->kind = node_compound;
-    p->filename = str_dup(open->filename);
-    p->line = open->line;
-    p->stmts = malloc(sizeof(StmtNode *) * num_stmts);
+    p->location = open->location;
+    p->stmts = stmts;
     p->num_stmts = num_stmts;
 
-    for (i = 0; i < num_stmts; i++) {
-        p->stmts[i] = stmts[i];
-    }
-
     return (StmtNode *)p;
 }
 
@@ -1092,8 +1443,7 @@ StmtNode *sema_return_stmt(ParserContext *ctx, const Token *t,
 
     p = malloc(sizeof(*p));
     p->kind = node_return;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->return_value = return_value;
 
     /* type check */
@@ -1102,21 +1452,26 @@ StmtNode *sema_return_stmt(ParserContext *ctx, const Token *t,
     if (is_void_type(return_type) && p->return_value != NULL) {
         fprintf(stderr,
                 "error at %s(%d): void function %s should not return a value\n",
-                p->filename, p->line, ctx->current_function->identifier);
+                source_location_filename(p->location),
+                source_location_line(p->location),
+                ctx->current_function->identifier);
         exit(1);
     }
 
     if (!is_void_type(return_type) && p->return_value == NULL) {
         fprintf(stderr,
                 "error at %s(%d): non-void function %s should return a value\n",
-                p->filename, p->line, ctx->current_function->identifier);
+                source_location_filename(p->location),
+                source_location_line(p->location),
+                ctx->current_function->identifier);
         exit(1);
     }
 
     if (p->return_value != NULL &&
         !assign_type_conversion(&p->return_value, return_type)) {
         fprintf(stderr, "error at %s(%d): invalid return type\n",
-                p->return_value->filename, p->return_value->line);
+                source_location_filename(p->return_value->location),
+                source_location_line(p->return_value->location));
         exit(1);
     }
 
@@ -1148,8 +1503,7 @@ StmtNode *sema_if_stmt(ParserContext *ctx, const Token *t, ExprNode *condition,
 
     p = malloc(sizeof(*p));
     p->kind = node_if;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->condition = condition;
     p->then = then;
     p->else_ = else_;
@@ -1159,7 +1513,8 @@ StmtNode *sema_if_stmt(ParserContext *ctx, const Token *t, ExprNode *condition,
 
     if (!is_scalar_type(p->condition->type)) {
         fprintf(stderr, "error at %s(%d): invalid condition type\n",
-                p->condition->filename, p->condition->line);
+                source_location_filename(p->condition->location),
+                source_location_line(p->condition->location));
         exit(1);
     }
 
@@ -1170,7 +1525,6 @@ StmtNode *sema_switch_stmt_case(ParserContext *ctx, const Token *t,
                                 ExprNode *case_value, StmtNode **stmts,
                                 int num_stmts) {
     CompoundNode *p;
-    int i;
 
     assert(ctx != NULL);
     assert(t != NULL);
@@ -1181,22 +1535,16 @@ StmtNode *sema_switch_stmt_case(ParserContext *ctx, const Token *t,
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_compound;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
-    p->stmts = malloc(sizeof(StmtNode *) * num_stmts);
+    p->location = t->location;
+    p->stmts = stmts;
     p->num_stmts = num_stmts;
 
-    for (i = 0; i < num_stmts; i++) {
-        p->stmts[i] = stmts[i];
-    }
-
     return (StmtNode *)p;
 }
 
 StmtNode *sema_switch_stmt_default(ParserContext *ctx, const Token *t,
                                    StmtNode **stmts, int num_stmts) {
     CompoundNode *p;
-    int i;
 
     assert(ctx != NULL);
     assert(t != NULL);
@@ -1206,15 +1554,10 @@ StmtNode *sema_switch_stmt_default(ParserContext *ctx, const Token *t,
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_compound;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
-    p->stmts = malloc(sizeof(StmtNode *) * num_stmts);
+    p->location = t->location;
+    p->stmts = stmts;
     p->num_stmts = num_stmts;
 
-    for (i = 0; i < num_stmts; i++) {
-        p->stmts[i] = stmts[i];
-    }
-
     return (StmtNode *)p;
 }
 
@@ -1226,11 +1569,54 @@ void sema_switch_stmt_enter(ParserContext *ctx) {
     control_flow_push_state(ctx, control_flow_state_break_bit);
 }
 
+void sort_case_order(long *values, int *order, int *buffer, int begin,
+                     int end) {
+    int middle;
+    int i;
+    int j;
+    int k;
+
+    assert(values != NULL);
+    assert(order != NULL);
+    assert(buffer != NULL);
+
+    if (end - begin < 2) {
+        return;
+    }
+
+    /* merge sort: stable and O(n log n) even for huge switches */
+    middle = begin + (end - begin) / 2;
+
+    sort_case_order(values, order, buffer, begin, middle);
+    sort_case_order(values, order, buffer, middle, end);
+
+    i = begin;
+    j = middle;
+
+    for (k = begin; k < end; k++) {
+        if (j >= end || (i < middle && values[order[i]] <= values[order[j]])) {
+            buffer[k] = order[i];
+            i++;
+        } else {
+            buffer[k] = order[j];
+            j++;
+        }
+    }
+
+    for (k = begin; k < end; k++) {
+        order[k] = buffer[k];
+    }
+}
+
 StmtNode *sema_switch_stmt_leave(ParserContext *ctx, const Token *t,
                                  ExprNode *condition, ExprNode **case_values,
                                  StmtNode **cases, int num_cases,
                                  StmtNode *default_) {
     SwitchNode *p;
+    ExprNode *case_value;
+    long *values;
+    int *buffer;
+    long value;
     int i;
 
     assert(ctx != NULL);
@@ -1249,32 +1635,66 @@ StmtNode *sema_switch_stmt_leave(ParserContext *ctx, const Token *t,
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_switch;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->condition = condition;
-    p->case_values = malloc(sizeof(ExprNode *) * num_cases);
-    p->cases = malloc(sizeof(StmtNode *) * num_cases);
+    p->case_values = case_values;
+    p->cases = cases;
+    p->case_order = malloc(sizeof(int) * num_cases);
     p->num_cases = num_cases;
     p->default_ = default_;
 
     for (i = 0; i < num_cases; i++) {
-        p->case_values[i] = case_values[i];
-        p->cases[i] = cases[i];
+        p->case_order[i] = i;
     }
 
     /* type check */
     p->condition = integer_promotion(p->condition);
 
-    if (!is_scalar_type(p->condition->type)) {
+    if (!is_integer_type(p->condition->type)) {
         fprintf(stderr, "error at %s(%d): invalid type of switch condition\n",
-                p->condition->filename, p->condition->line);
+                source_location_filename(p->condition->location),
+                source_location_line(p->condition->location));
         exit(1);
     }
 
+    /* fold case values into integer constants */
+    values = malloc(sizeof(long) * num_cases);
+
     for (i = 0; i < num_cases; i++) {
-        if (!assign_type_conversion(&p->case_values[i], p->condition->type)) {
-            fprintf(stderr, "error %s(%d): invalid type of case condition\n",
-                    p->case_values[i]->filename, p->case_values[i]->line);
+        case_value = p->case_values[i];
+
+        if (!assign_type_conversion(&case_value, p->condition->type)) {
+            fprintf(stderr, "error at %s(%d): invalid type of case condition\n",
+                    source_location_filename(case_value->location),
+                    source_location_line(case_value->location));
+            exit(1);
+        }
+
+        if (!evaluate_constant_expr(case_value, &value)) {
+            fprintf(stderr,
+                    "error at %s(%d): "
+                    "case value must be a constant expression\n",
+                    source_location_filename(case_value->location),
+                    source_location_line(case_value->location));
+            exit(1);
+        }
+
+        values[i] = value;
+        p->case_values[i] = constant_node_new(case_value, value);
+    }
+
+    /* sort cases by value and detect duplicates */
+    buffer = malloc(sizeof(int) * num_cases);
+    sort_case_order(values, p->case_order, buffer, 0, num_cases);
+
+    for (i = 1; i < num_cases; i++) {
+        if (values[p->case_order[i - 1]] == values[p->case_order[i]]) {
+            case_value = p->case_values[p->case_order[i]];
+
+            fprintf(stderr, "error at %s(%d): duplicate case value %ld\n",
+                    source_location_filename(case_value->location),
+                    source_location_line(case_value->location),
+                    values[p->case_order[i]]);
             exit(1);
         }
     }
@@ -1282,7 +1702,164 @@ StmtNode *sema_switch_stmt_leave(ParserContext *ctx, const Token *t,
     return (StmtNode *)p;
 }
 
-void sema_while_stmt_enter_body(ParserContext *ctx) {
+LoopHints *sema_loop_hints_take(ParserContext *ctx) {
+    LoopHints *hints;
+
+    assert(ctx != NULL);
+
+    /* the pragmas apply to this loop, not to the ones in its body */
+    hints = ctx->loop_hints;
+    ctx->loop_hints = NULL;
+
+    if (hints == NULL) {
+        hints = malloc(sizeof(*hints));
+        hints->hints = 0;
+        hints->unroll_count = 0;
+        hints->vectorize_width = 0;
+        hints->interleave_count = 0;
+    }
+
+    return hints;
+}
+
+void sema_loop_hints_condition(LoopHints *hints, ExprNode *condition) {
+    long value;
+
+    assert(hints != NULL);
+
+    /* a loop whose condition is not a constant expression may be assumed
+       to terminate, see C11 6.8.5p6 */
+    if (condition != NULL && !evaluate_constant_expr(condition, &value)) {
+        hints->hints = hints->hints | loop_hint_mustprogress;
+    }
+}
+
+int sema_loop_hint_count(const Token *t, const char *option,
+                         const Token *arg) {
+    long value;
+
+    assert(t != NULL);
+    assert(option != NULL);
+
+    value = 0;
+
+    if (arg != NULL && arg->kind == token_number) {
+        errno = 0;
+
+        if (!lex_integer_value(arg->text, &value) || errno == ERANGE) {
+            value = 0;
+        }
+    }
+
+    if (value <= 0 || value > INT_MAX) {
+        fprintf(stderr,
+                "error at %s(%d): %s requires a positive integer argument\n",
+                t->filename, t->line, option);
+        exit(1);
+    }
+
+    return value;
+}
+
+bool sema_loop_hint_is(const Token *arg, const char *text) {
+    assert(text != NULL);
+
+    return arg != NULL && arg->kind == token_identifier &&
+           strcmp(arg->text, text) == 0;
+}
+
+void sema_loop_hint(ParserContext *ctx, const Token *t, const char *option,
+                    const Token *arg) {
+    LoopHints *hints;
+    int flags;
+
+    assert(ctx != NULL);
+    assert(t != NULL);
+    assert(option != NULL);
+
+    if (ctx->loop_hints == NULL) {
+        ctx->loop_hints = sema_loop_hints_take(ctx);
+    }
+
+    hints = ctx->loop_hints;
+    flags = 0;
+
+    if (strcmp(option, "unroll") == 0 &&
+        (arg == NULL || arg->kind == token_number)) {
+        /* #pragma unroll [N] */
+        if (arg == NULL) {
+            flags = loop_hint_unroll_full;
+        } else {
+            hints->unroll_count = sema_loop_hint_count(t, option, arg);
+            flags = loop_hint_unroll;
+        }
+    } else if (strcmp(option, "nounroll") == 0) {
+        flags = loop_hint_nounroll;
+    } else if (strcmp(option, "unroll") == 0 &&
+               sema_loop_hint_is(arg, "enable")) {
+        flags = loop_hint_unroll;
+    } else if (strcmp(option, "unroll") == 0 &&
+               sema_loop_hint_is(arg, "full")) {
+        flags = loop_hint_unroll_full;
+    } else if (strcmp(option, "unroll") == 0 &&
+               sema_loop_hint_is(arg, "disable")) {
+        flags = loop_hint_nounroll;
+    } else if (strcmp(option, "unroll_count") == 0) {
+        hints->unroll_count = sema_loop_hint_count(t, option, arg);
+        flags = loop_hint_unroll;
+    } else if ((strcmp(option, "vectorize") == 0 ||
+                strcmp(option, "interleave") == 0) &&
+               sema_loop_hint_is(arg, "enable")) {
+        flags = loop_hint_vectorize;
+    } else if (strcmp(option, "vectorize") == 0 &&
+               sema_loop_hint_is(arg, "disable")) {
+        flags = loop_hint_novectorize;
+    } else if (strcmp(option, "interleave") == 0 &&
+               sema_loop_hint_is(arg, "disable")) {
+        hints->interleave_count = 1;
+    } else if (strcmp(option, "vectorize_width") == 0) {
+        hints->vectorize_width = sema_loop_hint_count(t, option, arg);
+        flags = loop_hint_vectorize;
+    } else if (strcmp(option, "interleave_count") == 0) {
+        hints->interleave_count = sema_loop_hint_count(t, option, arg);
+    } else {
+        fprintf(stderr, "error at %s(%d): invalid loop hint %s\n", t->filename,
+                t->line, option);
+        exit(1);
+    }
+
+    hints->hints = hints->hints | flags;
+
+    if ((hints->hints & loop_hint_nounroll) != 0 &&
+        (hints->hints & (loop_hint_unroll | loop_hint_unroll_full)) != 0) {
+        fprintf(stderr, "error at %s(%d): incompatible unroll hints\n",
+                t->filename, t->line);
+        exit(1);
+    }
+
+    if ((hints->hints & loop_hint_vectorize) != 0 &&
+        (hints->hints & loop_hint_novectorize) != 0) {
+        fprintf(stderr, "error at %s(%d): incompatible vectorize hints\n",
+                t->filename, t->line);
+        exit(1);
+    }
+}
+
+void sema_pragma_leave(ParserContext *ctx, const Token *next) {
+    assert(ctx != NULL);
+    assert(next != NULL);
+
+    /* loop pragmas must be followed by the loop */
+    if (ctx->loop_hints != NULL && next->kind != token_while &&
+        next->kind != token_do && next->kind != token_for) {
+        fprintf(stderr,
+                "error at %s(%d): expected a loop after the loop pragma\n",
+                next->filename, next->line);
+        exit(1);
+    }
+}
+
+LoopHints *sema_while_stmt_enter_body(ParserContext *ctx) {
     assert(ctx != NULL);
 
     /* enter scope */
@@ -1291,16 +1868,20 @@ void sema_while_stmt_enter_body(ParserContext *ctx) {
     /* push loop state */
     control_flow_push_state(ctx, control_flow_state_break_bit |
                                      control_flow_state_continue_bit);
+
+    return sema_loop_hints_take(ctx);
 }
 
 StmtNode *sema_while_stmt_leave_body(ParserContext *ctx, const Token *t,
-                                     ExprNode *condition, StmtNode *body) {
+                                     ExprNode *condition, StmtNode *body,
+                                     LoopHints *hints) {
     WhileNode *p;
 
     assert(ctx != NULL);
     assert(t != NULL);
     assert(condition != NULL);
     assert(body != NULL);
+    assert(hints != NULL);
 
     /* pop loop state */
     control_flow_pop_state(ctx);
@@ -1311,24 +1892,27 @@ StmtNode *sema_while_stmt_leave_body(ParserContext *ctx, const Token *t,
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_while;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->condition = condition;
     p->body = body;
+    p->hints = hints;
 
     /* type check */
     p->condition = integer_promotion(p->condition);
 
     if (!is_scalar_type(p->condition->type)) {
         fprintf(stderr, "error at %s(%d): invalid condition type\n",
-                p->condition->filename, p->condition->line);
+                source_location_filename(p->condition->location),
+                source_location_line(p->condition->location));
         exit(1);
     }
 
+    sema_loop_hints_condition(p->hints, p->condition);
+
     return (StmtNode *)p;
 }
 
-void sema_do_stmt_enter_body(ParserContext *ctx) {
+LoopHints *sema_do_stmt_enter_body(ParserContext *ctx) {
     assert(ctx != NULL);
 
     /* enter scope */
@@ -1337,6 +1921,8 @@ void sema_do_stmt_enter_body(ParserContext *ctx) {
     /* push loop state */
     control_flow_push_state(ctx, control_flow_state_break_bit |
                                      control_flow_state_continue_bit);
+
+    return sema_loop_hints_take(ctx);
 }
 
 void sema_do_stmt_leave_body(ParserContext *ctx) {
@@ -1350,34 +1936,38 @@ void sema_do_stmt_leave_body(ParserContext *ctx) {
 }
 
 StmtNode *sema_do_stmt(ParserContext *ctx, const Token *t, StmtNode *body,
-                       ExprNode *condition) {
+                       ExprNode *condition, LoopHints *hints) {
     DoNode *p;
 
     assert(ctx != NULL);
     assert(t != NULL);
     assert(body != NULL);
     assert(condition != NULL);
+    assert(hints != NULL);
 
     p = malloc(sizeof(*p));
     p->kind = node_do;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->body = body;
     p->condition = condition;
+    p->hints = hints;
 
     /* type check */
     p->condition = integer_promotion(p->condition);
 
     if (!is_scalar_type(p->condition->type)) {
         fprintf(stderr, "error at %s(%d): invalid condition type\n",
-                p->condition->filename, p->condition->line);
+                source_location_filename(p->condition->location),
+                source_location_line(p->condition->location));
         exit(1);
     }
 
+    sema_loop_hints_condition(p->hints, p->condition);
+
     return (StmtNode *)p;
 }
 
-void sema_for_stmt_enter_body(ParserContext *ctx) {
+LoopHints *sema_for_stmt_enter_body(ParserContext *ctx) {
     assert(ctx != NULL);
 
     /* enter scope */
@@ -1386,17 +1976,20 @@ void sema_for_stmt_enter_body(ParserContext *ctx) {
     /* push loop state */
     control_flow_push_state(ctx, control_flow_state_break_bit |
                                      control_flow_state_continue_bit);
+
+    return sema_loop_hints_take(ctx);
 }
 
 StmtNode *sema_for_stmt_leave_body(ParserContext *ctx, const Token *t,
                                    ExprNode *initialization,
                                    ExprNode *condition, ExprNode *continuation,
-                                   StmtNode *body) {
+                                   StmtNode *body, LoopHints *hints) {
     ForNode *p;
 
     assert(ctx != NULL);
     assert(t != NULL);
     assert(body != NULL);
+    assert(hints != NULL);
 
     /* pop loop state */
     control_flow_pop_state(ctx);
@@ -1407,12 +2000,12 @@ StmtNode *sema_for_stmt_leave_body(ParserContext *ctx, const Token *t,
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_for;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->initialization = initialization;
     p->condition = condition;
     p->continuation = continuation;
     p->body = body;
+    p->hints = hints;
 
     /* type check */
     if (p->condition) {
@@ -1420,11 +2013,14 @@ StmtNode *sema_for_stmt_leave_body(ParserContext *ctx, const Token *t,
 
         if (!is_scalar_type(p->condition->type)) {
             fprintf(stderr, "error at %s(%d): invalid condition type\n",
-                    p->condition->filename, p->condition->line);
+                    source_location_filename(p->condition->location),
+                    source_location_line(p->condition->location));
             exit(1);
         }
     }
 
+    sema_loop_hints_condition(p->hints, p->condition);
+
     return (StmtNode *)p;
 }
 
@@ -1444,8 +2040,7 @@ StmtNode *sema_break_stmt(ParserContext *ctx, const Token *t) {
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_break;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
 
     return (StmtNode *)p;
 }
@@ -1466,8 +2061,7 @@ StmtNode *sema_continue_stmt(ParserContext *ctx, const Token *t) {
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_continue;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
 
     return (StmtNode *)p;
 }
@@ -1480,8 +2074,7 @@ StmtNode *sema_decl_stmt(ParserContext *ctx, DeclNode *decl, const Token *t) {
 
     p = malloc(sizeof(*p));
     p->kind = node_decl;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->decl = decl;
 
     return (StmtNode *)p;
@@ -1496,8 +2089,7 @@ StmtNode *sema_expr_stmt(ParserContext *ctx, ExprNode *expr, const Token *t) {
 
     p = malloc(sizeof(*p));
     p->kind = node_expr;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->expr = expr;
 
     return (StmtNode *)p;
@@ -1517,7 +2109,8 @@ Type *sema_array_declarator(ParserContext *ctx, Type *type, ExprNode *size) {
     /* size check */
     if (array_size <= 0) {
         fprintf(stderr, "error at %s(%d): invalid array size %d\n",
-                size->filename, size->line, array_size);
+                source_location_filename(size->location),
+                source_location_line(size->location), array_size);
         exit(1);
     }
 
@@ -1536,10 +2129,9 @@ DeclNode *sema_typedef(ParserContext *ctx, const Token *t, Type *type,
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_typedef;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
-    p->symbol = (Symbol *)variable_symbol_new(
-        identifier->filename, identifier->line, identifier->text, type);
+    p->location = t->location;
+    p->symbol = (Symbol *)variable_symbol_new(identifier->location,
+                                              identifier->text, type);
 
     /* redefinition check */
     if (scope_stack_find(ctx->env, p->symbol->identifier, false)) {
@@ -1549,7 +2141,7 @@ DeclNode *sema_typedef(ParserContext *ctx, const Token *t, Type *type,
     }
 
     /* register type symbol */
-    scope_stack_register(ctx->env, p->symbol->identifier, p);
+    scope_stack_register_typedef(ctx->env, p->symbol->identifier, p);
 
     return (DeclNode *)p;
 }
@@ -1567,10 +2159,9 @@ DeclNode *sema_extern(ParserContext *ctx, const Token *t, Type *type,
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_extern;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
-    p->symbol = (Symbol *)variable_symbol_new(
-        identifier->filename, identifier->line, identifier->text, type);
+    p->location = t->location;
+    p->symbol = (Symbol *)variable_symbol_new(identifier->location,
+                                              identifier->text, type);
 
     /* redeclaration check */
     decl = scope_stack_find(ctx->env, p->symbol->identifier, false);
@@ -1578,13 +2169,15 @@ DeclNode *sema_extern(ParserContext *ctx, const Token *t, Type *type,
     if (decl != NULL) {
         if (decl->kind != node_extern && decl->kind != node_variable) {
             fprintf(stderr, "error at %s(%d): redeclaration of symbol %s\n",
-                    p->filename, p->line, p->symbol->identifier);
+                    source_location_filename(p->location),
+                    source_location_line(p->location), p->symbol->identifier);
             exit(1);
         }
 
         if (!type_equals(decl->symbol->type, p->symbol->type)) {
             fprintf(stderr, "error at %s(%d): conflicting type for %s\n",
-                    p->filename, p->line, p->symbol->identifier);
+                    source_location_filename(p->location),
+                    source_location_line(p->location), p->symbol->identifier);
             exit(1);
         }
     }
@@ -1595,26 +2188,38 @@ DeclNode *sema_extern(ParserContext *ctx, const Token *t, Type *type,
     return (DeclNode *)p;
 }
 
-DeclNode *sema_var_decl(ParserContext *ctx, Type *type,
+DeclNode *sema_var_decl(ParserContext *ctx, int specifiers, Type *type,
                         const Token *identifier) {
     VariableNode *p;
     DeclNode *decl;
 
     assert(ctx != NULL);
+    assert(ctx->current_function == NULL || specifiers == 0);
     assert(type != NULL);
     assert(identifier != NULL);
 
     p = malloc(sizeof(*p));
     p->kind = node_variable;
-    p->filename = str_dup(identifier->filename);
-    p->line = identifier->line;
-    p->symbol = (Symbol *)variable_symbol_new(
-        identifier->filename, identifier->line, identifier->text, type);
+    p->location = identifier->location;
+    p->symbol = (Symbol *)variable_symbol_new(identifier->location,
+                                              identifier->text, type);
+
+    /* specifier check */
+    if ((specifiers & specifier_inline) != 0) {
+        fprintf(stderr, "error at %s(%d): variable %s cannot be inline\n",
+                source_location_filename(p->symbol->location),
+                source_location_line(p->symbol->location),
+                p->symbol->identifier);
+        exit(1);
+    }
+
+    ((VariableSymbol *)p->symbol)->specifiers = specifiers;
 
     /* type check */
     if (is_incomplete_type(p->symbol->type)) {
         fprintf(stderr, "error at %s(%d): variable must have a complete type\n",
-                p->symbol->filename, p->symbol->line);
+                source_location_filename(p->symbol->location),
+                source_location_line(p->symbol->location));
         exit(1);
     }
 
@@ -1626,7 +2231,18 @@ DeclNode *sema_var_decl(ParserContext *ctx, Type *type,
             fprintf(stderr,
                     "error at %s(%d): "
                     "symbol %s has already been declared in this scope\n",
-                    p->symbol->filename, p->symbol->line,
+                    source_location_filename(p->symbol->location),
+                    source_location_line(p->symbol->location),
+                    p->symbol->identifier);
+            exit(1);
+        }
+
+        if ((specifiers & specifier_static) != 0) {
+            fprintf(stderr,
+                    "error at %s(%d): "
+                    "static declaration of %s follows non-static declaration\n",
+                    source_location_filename(p->symbol->location),
+                    source_location_line(p->symbol->location),
                     p->symbol->identifier);
             exit(1);
         }
@@ -1637,7 +2253,7 @@ DeclNode *sema_var_decl(ParserContext *ctx, Type *type,
 
     if (ctx->current_function) {
         /* local variable */
-        vec_push(ctx->locals, (DeclNode *)p);
+        small_vec_push(&ctx->locals, (DeclNode *)p);
     } else {
         /* global variable */
     }
@@ -1655,16 +2271,16 @@ VariableNode *sema_param(ParserContext *ctx, Type *type,
 
     p = malloc(sizeof(*p));
     p->kind = node_variable;
-    p->filename = str_dup(identifier->filename);
-    p->line = identifier->line;
-    p->symbol = (Symbol *)variable_symbol_new(
-        identifier->text, identifier->line, identifier->text, type);
+    p->location = identifier->location;
+    p->symbol = (Symbol *)variable_symbol_new(identifier->location,
+                                              identifier->text, type);
 
     /* type check */
     if (is_incomplete_type(type)) {
         fprintf(stderr,
                 "error at %s(%d): parameter must have a complete type\n",
-                p->symbol->filename, p->symbol->line);
+                source_location_filename(p->symbol->location),
+                source_location_line(p->symbol->location));
         exit(1);
     }
 
@@ -1673,7 +2289,9 @@ VariableNode *sema_param(ParserContext *ctx, Type *type,
         fprintf(stderr,
                 "error at %s(%d): "
                 "symbol %s has already been declared in this scope\n",
-                p->symbol->filename, p->symbol->line, p->symbol->identifier);
+                source_location_filename(p->symbol->location),
+                source_location_line(p->symbol->location),
+                p->symbol->identifier);
         exit(1);
     }
 
@@ -1683,6 +2301,235 @@ VariableNode *sema_param(ParserContext *ctx, Type *type,
     return p;
 }
 
+void sema_attribute_list_init(AttributeList *list) {
+    assert(list != NULL);
+
+    list->attributes = 0;
+    list->alignment = 0;
+    small_vec_init(&list->nonnull_params);
+}
+
+int sema_attribute_flag(const char *name) {
+    assert(name != NULL);
+
+    if (strcmp(name, "always_inline") == 0) {
+        return attribute_always_inline;
+    } else if (strcmp(name, "noinline") == 0) {
+        return attribute_noinline;
+    } else if (strcmp(name, "hot") == 0) {
+        return attribute_hot;
+    } else if (strcmp(name, "cold") == 0) {
+        return attribute_cold;
+    } else if (strcmp(name, "pure") == 0) {
+        return attribute_pure;
+    } else if (strcmp(name, "const") == 0) {
+        return attribute_const;
+    } else if (strcmp(name, "noreturn") == 0) {
+        return attribute_noreturn;
+    } else if (strcmp(name, "malloc") == 0) {
+        return attribute_malloc;
+    } else if (strcmp(name, "nonnull") == 0) {
+        return attribute_nonnull;
+    }
+
+    return 0;
+}
+
+void sema_attribute(ParserContext *ctx, AttributeList *list, const Token *t,
+                    ExprNode **args, int num_args) {
+    const char *name;
+    int length;
+    int attribute;
+    int value;
+    int i;
+
+    assert(ctx != NULL);
+    assert(list != NULL);
+    assert(t != NULL);
+    assert(args != NULL || num_args == 0);
+    assert(num_args >= 0);
+
+    /* __name__ is the same as name */
+    name = t->text;
+    length = strlen(name);
+
+    if (length > 4 && memcmp(name, "__", 2) == 0 &&
+        memcmp(name + length - 2, "__", 2) == 0) {
+        name = str_dup_n(name + 2, length - 4);
+    }
+
+    /* arguments */
+    for (i = 0; i < num_args; i++) {
+        if (args[i]->kind != node_integer) {
+            fprintf(stderr,
+                    "error at %s(%d): "
+                    "argument of attribute %s must be an integer constant\n",
+                    t->filename, t->line, name);
+            exit(1);
+        }
+    }
+
+    /* aligned(alignment) */
+    if (strcmp(name, "aligned") == 0) {
+        if (num_args != 1) {
+            fprintf(stderr,
+                    "error at %s(%d): attribute %s takes one argument\n",
+                    t->filename, t->line, name);
+            exit(1);
+        }
+
+        value = ((IntegerNode *)args[0])->value;
+
+        if (value <= 0 || (value & (value - 1)) != 0) {
+            fprintf(stderr,
+                    "error at %s(%d): alignment %d is not a power of 2\n",
+                    t->filename, t->line, value);
+            exit(1);
+        }
+
+        if (value > list->alignment) {
+            list->alignment = value;
+        }
+
+        return;
+    }
+
+    attribute = sema_attribute_flag(name);
+
+    if (attribute == 0) {
+        fprintf(stderr, "error at %s(%d): unknown attribute %s\n",
+                t->filename, t->line, name);
+        exit(1);
+    }
+
+    /* nonnull(index {, index}) */
+    if (attribute == attribute_nonnull) {
+        for (i = 0; i < num_args; i++) {
+            small_vec_push(&list->nonnull_params,
+                           (void *)(intptr_t)((IntegerNode *)args[i])->value);
+        }
+    } else if (num_args != 0) {
+        fprintf(stderr, "error at %s(%d): attribute %s takes no arguments\n",
+                t->filename, t->line, name);
+        exit(1);
+    }
+
+    list->attributes = list->attributes | attribute;
+}
+
+void sema_var_attributes(ParserContext *ctx, DeclNode *decl,
+                         AttributeList *list) {
+    assert(ctx != NULL);
+    assert(decl != NULL);
+    assert(decl->kind == node_variable);
+    assert(list != NULL);
+
+    /* only the alignment applies to variables */
+    if (list->attributes != 0) {
+        fprintf(stderr,
+                "error at %s(%d): "
+                "function attribute applied to variable %s\n",
+                source_location_filename(decl->location),
+                source_location_line(decl->location), decl->symbol->identifier);
+        exit(1);
+    }
+
+    ((VariableSymbol *)decl->symbol)->alignment = list->alignment;
+}
+
+void sema_function_nonnull_param(FunctionNode *p, int index) {
+    VariableSymbol *param;
+
+    assert(p != NULL);
+
+    if (index < 1 || index > p->num_params) {
+        fprintf(stderr,
+                "error at %s(%d): nonnull parameter %d of %s is out of range\n",
+                source_location_filename(p->location),
+                source_location_line(p->location), index,
+                p->symbol->identifier);
+        exit(1);
+    }
+
+    param = (VariableSymbol *)p->params[index - 1]->symbol;
+
+    if (!is_pointer_type(param->type)) {
+        fprintf(stderr,
+                "error at %s(%d): "
+                "nonnull parameter %d of %s is not a pointer\n",
+                source_location_filename(p->location),
+                source_location_line(p->location), index,
+                p->symbol->identifier);
+        exit(1);
+    }
+
+    param->attributes = param->attributes | attribute_nonnull;
+}
+
+void sema_function_attributes(ParserContext *ctx, FunctionNode *p,
+                              AttributeList *list) {
+    VariableSymbol *symbol;
+    int attributes;
+    int i;
+
+    assert(ctx != NULL);
+    assert(p != NULL);
+    assert(list != NULL);
+
+    symbol = (VariableSymbol *)p->symbol;
+    attributes = symbol->attributes | list->attributes;
+
+    /* conflicting hints, including those of earlier declarations */
+    if ((attributes & attribute_always_inline) != 0 &&
+        (attributes & attribute_noinline) != 0) {
+        fprintf(stderr,
+                "error at %s(%d): %s is both always_inline and noinline\n",
+                source_location_filename(p->location),
+                source_location_line(p->location), symbol->identifier);
+        exit(1);
+    }
+
+    if ((attributes & attribute_hot) != 0 &&
+        (attributes & attribute_cold) != 0) {
+        fprintf(stderr, "error at %s(%d): %s is both hot and cold\n",
+                source_location_filename(p->location),
+                source_location_line(p->location), symbol->identifier);
+        exit(1);
+    }
+
+    /* malloc returns a pointer to fresh memory */
+    if ((attributes & attribute_malloc) != 0 &&
+        !is_pointer_type(((FunctionType *)symbol->type)->return_type)) {
+        fprintf(stderr,
+                "error at %s(%d): malloc function %s must return a pointer\n",
+                source_location_filename(p->location),
+                source_location_line(p->location), symbol->identifier);
+        exit(1);
+    }
+
+    /* nonnull applies to the listed parameters, or to every pointer */
+    if ((list->attributes & attribute_nonnull) != 0) {
+        if (list->nonnull_params.size == 0) {
+            for (i = 0; i < p->num_params; i++) {
+                if (is_pointer_type(p->params[i]->symbol->type)) {
+                    sema_function_nonnull_param(p, i + 1);
+                }
+            }
+        } else {
+            for (i = 0; i < list->nonnull_params.size; i++) {
+                sema_function_nonnull_param(
+                    p, (intptr_t)list->nonnull_params.data[i]);
+            }
+        }
+    }
+
+    symbol->attributes = symbol->attributes | attributes;
+
+    if (list->alignment > symbol->alignment) {
+        symbol->alignment = list->alignment;
+    }
+}
+
 void sema_function_enter_params(ParserContext *ctx) {
     assert(ctx != NULL);
 
@@ -1690,9 +2537,10 @@ void sema_function_enter_params(ParserContext *ctx) {
     sema_push_scope(ctx);
 }
 
-FunctionNode *sema_function_leave_params(ParserContext *ctx, Type *return_type,
-                                         const Token *t, VariableNode **params,
-                                         int num_params, bool var_args) {
+FunctionNode *sema_function_leave_params(ParserContext *ctx, int specifiers,
+                                         Type *return_type, const Token *t,
+                                         VariableNode **params, int num_params,
+                                         bool var_args) {
     Type **param_types;
     Type *func_type;
     DeclNode *decl;
@@ -1734,30 +2582,57 @@ FunctionNode *sema_function_leave_params(ParserContext *ctx, Type *return_type,
             exit(1);
         }
 
-        if (((FunctionNode *)decl)->body != NULL) {
+        if (((FunctionNode *)decl)->body != NULL ||
+            ((FunctionNode *)decl)->skimmed_body != NULL) {
             fprintf(stderr, "error at %s(%d): redefinition of function %s\n",
                     t->filename, t->line, decl->symbol->identifier);
             exit(1);
         }
+
+        /* linkage of the first declaration */
+        if ((specifiers & specifier_static) != 0 &&
+            (((VariableSymbol *)decl->symbol)->specifiers &
+             specifier_static) == 0) {
+            fprintf(stderr,
+                    "error at %s(%d): "
+                    "static declaration of %s follows non-static declaration\n",
+                    t->filename, t->line, decl->symbol->identifier);
+            exit(1);
+        }
+
+        specifiers = specifiers | ((VariableSymbol *)decl->symbol)->specifiers;
     }
 
     /* make node */
     p = malloc(sizeof(*p));
     p->kind = node_function;
-    p->filename = str_dup(t->filename);
-    p->line = t->line;
+    p->location = t->location;
     p->symbol =
-        (Symbol *)variable_symbol_new(t->filename, t->line, t->text, func_type);
-    p->params = malloc(sizeof(VariableNode *) * num_params);
+        (Symbol *)variable_symbol_new(t->location, t->text, func_type);
+    ((VariableSymbol *)p->symbol)->specifiers = specifiers;
+
+    /* attributes of the earlier declaration */
+    if (decl != NULL) {
+        ((VariableSymbol *)p->symbol)->attributes =
+            ((VariableSymbol *)decl->symbol)->attributes;
+        ((VariableSymbol *)p->symbol)->alignment =
+            ((VariableSymbol *)decl->symbol)->alignment;
+
+        for (i = 0; i < num_params; i++) {
+            ((VariableSymbol *)params[i]->symbol)->attributes =
+                ((VariableSymbol *)params[i]->symbol)->attributes |
+                ((VariableSymbol *)((FunctionNode *)decl)->params[i]->symbol)
+                    ->attributes;
+        }
+    }
+
+    p->params = params;
     p->num_params = num_params;
     p->var_args = var_args;
     p->body = NULL;
     p->locals = NULL;
     p->num_locals = 0;
-
-    for (i = 0; i < num_params; i++) {
-        p->params[i] = params[i];
-    }
+    p->skimmed_body = NULL;
 
     /* register symbol */
     scope_stack_register(ctx->env, p->symbol->identifier, p);
@@ -1773,7 +2648,7 @@ void sema_function_enter_body(ParserContext *ctx, FunctionNode *p) {
     assert(p->symbol->kind == symbol_variable);
 
     ctx->current_function = (VariableSymbol *)p->symbol;
-    ctx->locals = vec_new();
+    small_vec_init(&ctx->locals);
 
     /* enter parameter scope */
     sema_push_scope(ctx);
@@ -1785,47 +2660,194 @@ void sema_function_enter_body(ParserContext *ctx, FunctionNode *p) {
     }
 }
 
+void sema_function_skim_body(ParserContext *ctx, FunctionNode *p,
+                             const Token **tokens) {
+    assert(ctx != NULL);
+    assert(p != NULL);
+    assert(p->body == NULL);
+    assert(tokens != NULL);
+
+    p->skimmed_body = tokens;
+    small_vec_push(&ctx->skimmed_functions, p);
+}
+
+ParserContext *sema_skimmed_body_enter(ParserContext *ctx, FunctionNode *p) {
+    ParserContext *body_ctx;
+
+    assert(ctx != NULL);
+    assert(scope_stack_depth(ctx->env) == 1);
+    assert(p != NULL);
+    assert(p->skimmed_body != NULL);
+
+    /* the body keeps its own parser state over the file scope, which no
+       longer changes */
+    body_ctx = malloc(sizeof(*body_ctx));
+    body_ctx->env = ctx->env;
+    body_ctx->struct_env = ctx->struct_env;
+    body_ctx->preprocessor = NULL;
+    body_ctx->tokens = p->skimmed_body;
+    body_ctx->index = 0;
+    body_ctx->current_function = NULL;
+    small_vec_init(&body_ctx->locals);
+    control_flow_init_state(body_ctx);
+    body_ctx->depth = 0;
+    small_vec_init(&body_ctx->skimmed_functions);
+    body_ctx->loop_hints = NULL;
+
+    p->skimmed_body = NULL;
+
+    /* enter function body */
+    sema_function_enter_body(body_ctx, p);
+
+    return body_ctx;
+}
+
+void analyze_variable_storage(VariableSymbol *symbol) {
+    assert(symbol != NULL);
+
+    /* only scalars whose address never escapes can live in registers */
+    symbol->is_register_promotable =
+        is_scalar_type(symbol->type) && !symbol->is_address_taken;
+}
+
 FunctionNode *sema_function_leave_body(ParserContext *ctx, FunctionNode *p,
                                        StmtNode *body) {
     int i;
 
     assert(ctx != NULL);
-    assert(ctx->locals != NULL);
+    assert(ctx->current_function != NULL);
     assert(p != NULL);
     assert(body != NULL);
 
     p->body = body;
 
-    p->locals = malloc(sizeof(DeclNode *) * ctx->locals->size);
-    p->num_locals = ctx->locals->size;
+    p->locals = (DeclNode **)small_vec_finish(&ctx->locals);
+    p->num_locals = ctx->locals.size;
+
+    /* address-taken analysis */
+    for (i = 0; i < p->num_params; i++) {
+        analyze_variable_storage((VariableSymbol *)p->params[i]->symbol);
+    }
 
     for (i = 0; i < p->num_locals; i++) {
-        p->locals[i] = ctx->locals->data[i];
+        analyze_variable_storage((VariableSymbol *)p->locals[i]->symbol);
     }
 
     /* leave parameter scope */
     sema_pop_scope(ctx);
 
     ctx->current_function = NULL;
-    ctx->locals = NULL;
 
     return p;
 }
 
-ParserContext *sema_translation_unit_enter(const Token **tokens) {
+void sema_register_builtin(ParserContext *ctx, const char *identifier,
+                           int builtin, Type *return_type, Type *param1,
+                           Type *param2, Type *param3, bool var_args) {
+    Type **param_types;
+    int num_params;
+    FunctionNode *p;
+    VariableSymbol *symbol;
+
+    assert(ctx != NULL);
+    assert(identifier != NULL);
+    assert(return_type != NULL);
+
+    param_types = malloc(sizeof(Type *) * 3);
+    param_types[0] = param1;
+    param_types[1] = param2;
+    param_types[2] = param3;
+
+    num_params = 0;
+    while (num_params < 3 && param_types[num_params] != NULL) {
+        num_params++;
+    }
+
+    symbol = variable_symbol_new(
+        0, identifier,
+        function_type_new(return_type, param_types, num_params, var_args));
+    symbol->builtin = builtin;
+
+    /* builtins are never generated, they only carry the signature */
+    p = malloc(sizeof(*p));
+    p->kind = node_function;
+    p->location = 0;
+    p->symbol = (Symbol *)symbol;
+    p->params = NULL;
+    p->num_params = 0;
+    p->var_args = var_args;
+    p->body = NULL;
+    p->locals = NULL;
+    p->num_locals = 0;
+    p->skimmed_body = NULL;
+
+    scope_stack_register(ctx->env, identifier, p);
+}
+
+void sema_register_builtins(ParserContext *ctx) {
+    Type *t_void;
+    Type *t_int;
+    Type *t_long;
+    Type *t_int64;
+    Type *t_ptr;
+
+    assert(ctx != NULL);
+
+    t_void = type_get_void();
+    t_int = type_get_int32();
+    t_long = type_get_long();
+    t_int64 = type_get_int64(); /* size_t and uint64_t */
+    t_ptr = pointer_type_new(t_void);
+
+    sema_register_builtin(ctx, "__builtin_expect", builtin_expect, t_long,
+                          t_long, t_long, NULL, false);
+    sema_register_builtin(ctx, "__builtin_unreachable", builtin_unreachable,
+                          t_void, NULL, NULL, NULL, false);
+    sema_register_builtin(ctx, "__builtin_prefetch", builtin_prefetch, t_void,
+                          t_ptr, NULL, NULL, true);
+    sema_register_builtin(ctx, "__builtin_memcpy", builtin_memcpy, t_ptr,
+                          t_ptr, t_ptr, t_int64, false);
+    sema_register_builtin(ctx, "__builtin_memset", builtin_memset, t_ptr,
+                          t_ptr, t_int, t_int64, false);
+    sema_register_builtin(ctx, "__builtin_popcount", builtin_popcount, t_int,
+                          t_int, NULL, NULL, false);
+    sema_register_builtin(ctx, "__builtin_popcountl", builtin_popcountl,
+                          t_int, t_long, NULL, NULL, false);
+    sema_register_builtin(ctx, "__builtin_clz", builtin_clz, t_int, t_int,
+                          NULL, NULL, false);
+    sema_register_builtin(ctx, "__builtin_clzl", builtin_clzl, t_int, t_long,
+                          NULL, NULL, false);
+    sema_register_builtin(ctx, "__builtin_ctz", builtin_ctz, t_int, t_int,
+                          NULL, NULL, false);
+    sema_register_builtin(ctx, "__builtin_ctzl", builtin_ctzl, t_int, t_long,
+                          NULL, NULL, false);
+    sema_register_builtin(ctx, "__builtin_bswap32", builtin_bswap32, t_int,
+                          t_int, NULL, NULL, false);
+    sema_register_builtin(ctx, "__builtin_bswap64", builtin_bswap64, t_int64,
+                          t_int64, NULL, NULL, false);
+}
+
+ParserContext *sema_translation_unit_enter(Preprocessor *pp) {
     ParserContext *ctx;
 
-    assert(tokens != NULL);
-    assert(*tokens != NULL);
+    assert(pp != NULL);
 
     ctx = malloc(sizeof(*ctx));
     ctx->env = scope_stack_new();
     ctx->struct_env = scope_stack_new();
-    ctx->tokens = tokens;
+    ctx->preprocessor = pp;
+    ctx->tokens = malloc(sizeof(Token *) * 2);
+    ctx->tokens[0] = preprocessor_next_token(pp);
+    ctx->tokens[1] = NULL;
     ctx->index = 0;
     ctx->current_function = NULL;
-    ctx->locals = NULL;
-    ctx->flow_state = control_flow_state_new();
+    small_vec_init(&ctx->locals);
+    control_flow_init_state(ctx);
+    ctx->depth = 0;
+    small_vec_init(&ctx->skimmed_functions);
+    ctx->loop_hints = NULL;
+
+    sema_register_builtins(ctx);
 
     return ctx;
 }
@@ -1835,24 +2857,19 @@ TranslationUnitNode *sema_translation_unit_leave(ParserContext *ctx,
                                                  DeclNode **decls,
                                                  int num_decls) {
     TranslationUnitNode *p;
-    int i;
 
     assert(ctx != NULL);
     assert(scope_stack_depth(ctx->env) == 1);
     assert(scope_stack_depth(ctx->struct_env) == 1);
-    assert(ctx->flow_state->size == 1);
+    assert(ctx->flow_state.size == 1);
     assert(filename != NULL);
     assert(decls != NULL || num_decls == 0);
     assert(num_decls >= 0);
 
     p = malloc(sizeof(*p));
     p->filename = str_dup(filename);
-    p->decls = malloc(sizeof(DeclNode *) * num_decls);
+    p->decls = decls;
     p->num_decls = num_decls;
 
-    for (i = 0; i < num_decls; i++) {
-        p->decls[i] = decls[i];
-    }
-
     return p;
 }
@@ -0,0 +1,171 @@
+#include "nocc.h"
+
+/* every registered source occupies its own range in a single location space,
+   so that a location fits in an int. location 0 is reserved for tokens that
+   do not come from a source */
+
+typedef struct SourceBuffer {
+    char *filename;
+    const char *src;
+    long len_src;
+    int location;     /* location of the first character */
+    int *line_starts; /* offsets of the lines, built on first use */
+    int num_lines;
+} SourceBuffer;
+
+Vec *source_buffers;
+int source_next_location;
+
+int source_register(const char *filename, const char *src, long len_src) {
+    SourceBuffer *b;
+
+    assert(filename != NULL);
+    assert(src != NULL);
+    assert(len_src >= 0);
+
+    if (source_buffers == NULL) {
+        source_buffers = vec_new();
+        source_next_location = 1;
+    }
+
+    /* one more location for the end of the source */
+    if (len_src >= INT_MAX - source_next_location) {
+        fprintf(stderr, "error: out of source locations at %s\n", filename);
+        exit(1);
+    }
+
+    b = malloc(sizeof(*b));
+    b->filename = str_dup(filename);
+    b->src = src;
+    b->len_src = len_src;
+    b->location = source_next_location;
+    b->line_starts = NULL;
+    b->num_lines = 0;
+
+    source_next_location = source_next_location + len_src + 1;
+    vec_push(source_buffers, b);
+
+    return b->location;
+}
+
+SourceBuffer *source_find_buffer(int location) {
+    SourceBuffer *b;
+    int low;
+    int high;
+    int mid;
+
+    if (location <= 0 || source_buffers == NULL) {
+        return NULL;
+    }
+
+    /* the last buffer starting at or before the location */
+    low = 0;
+    high = source_buffers->size;
+
+    while (high - low > 1) {
+        mid = (low + high) / 2;
+        b = source_buffers->data[mid];
+
+        if (b->location <= location) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return source_buffers->data[low];
+}
+
+void source_build_line_table(SourceBuffer *b) {
+    const char *p;
+    const char *end;
+    int i;
+
+    assert(b != NULL);
+
+    end = b->src + b->len_src;
+
+    b->num_lines = 1;
+    for (p = memchr(b->src, '\n', b->len_src); p != NULL;
+         p = memchr(p + 1, '\n', end - p - 1)) {
+        b->num_lines++;
+    }
+
+    b->line_starts = malloc(sizeof(int) * b->num_lines);
+    b->line_starts[0] = 0;
+
+    i = 1;
+    for (p = memchr(b->src, '\n', b->len_src); p != NULL;
+         p = memchr(p + 1, '\n', end - p - 1)) {
+        b->line_starts[i] = p + 1 - b->src;
+        i++;
+    }
+}
+
+int source_line_index(SourceBuffer *b, int location) {
+    int offset;
+    int low;
+    int high;
+    int mid;
+
+    assert(b != NULL);
+
+    if (b->line_starts == NULL) {
+        source_build_line_table(b);
+    }
+
+    offset = location - b->location;
+    low = 0;
+    high = b->num_lines;
+
+    while (high - low > 1) {
+        mid = (low + high) / 2;
+
+        if (b->line_starts[mid] <= offset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+const char *source_location_filename(int location) {
+    SourceBuffer *b;
+
+    b = source_find_buffer(location);
+
+    if (b == NULL) {
+        return "<built-in>";
+    }
+
+    return b->filename;
+}
+
+int source_location_line(int location) {
+    SourceBuffer *b;
+
+    b = source_find_buffer(location);
+
+    if (b == NULL) {
+        return 0;
+    }
+
+    return source_line_index(b, location) + 1;
+}
+
+int source_location_column(int location) {
+    SourceBuffer *b;
+    int line_index;
+
+    b = source_find_buffer(location);
+
+    if (b == NULL) {
+        return 0;
+    }
+
+    line_index = source_line_index(b, location);
+
+    return location - b->location - b->line_starts[line_index] + 1;
+}
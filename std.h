@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -48,8 +49,14 @@ typedef int bool;
 /* <stddef.h> */
 #define NULL ((void *)0)
 
+#ifdef __MINGW64__
+/* LLP64 */
+typedef unsigned long long size_t;
+typedef long long intptr_t;
+#else
 typedef unsigned long size_t;
 typedef long intptr_t;
+#endif
 
 /* <stdio.h> */
 typedef struct FILE FILE;
@@ -74,9 +81,10 @@ int fseek(FILE *fp, long offset, int whence);
 long ftell(FILE *fp);
 size_t fread(void *ptr, size_t size, size_t nitems, FILE *fp);
 int fprintf(FILE *fp, const char *format, ...);
+int sprintf(char *buffer, const char *format, ...);
 
 /* <stdlib.h> */
-void exit(int code);
+void exit(int code) __attribute__((noreturn));
 void *malloc(size_t size);
 void *realloc(void *ptr, size_t size);
 long strtol(const char *str, char **end, int base);
@@ -85,6 +93,11 @@ long strtol(const char *str, char **end, int base);
 size_t strlen(const char *s);
 int strcmp(const char *a, const char *b);
 char *strncpy(char *dest, const char *src, size_t size);
+size_t strspn(const char *s, const char *accept);
+size_t strcspn(const char *s, const char *reject);
+void *memchr(const void *s, int c, size_t size);
+void *memcpy(void *dest, const void *src, size_t size);
+int memcmp(const void *a, const void *b, size_t size);
 
 #endif
 
@@ -1,36 +1,39 @@
 #include "nocc.h"
 
-VariableSymbol *variable_symbol_new(const char *filename, int line,
-                                    const char *identifier, Type *type) {
+VariableSymbol *variable_symbol_new(int location, const char *identifier,
+                                    Type *type) {
     VariableSymbol *p;
 
-    assert(filename != NULL);
     assert(identifier != NULL);
     assert(type != NULL);
 
     p = malloc(sizeof(*p));
     p->kind = symbol_variable;
-    p->filename = str_dup(filename);
-    p->line = line;
+    p->location = location;
     p->identifier = str_dup(identifier);
     p->type = type;
+    p->is_address_taken = false;
+    p->is_register_promotable = false;
     p->generated_location = NULL;
+    p->specifiers = 0;
+    p->attributes = 0;
+    p->alignment = 0;
+    p->builtin = 0;
+    p->generated_alias_scope = NULL;
+    p->generated_noalias = NULL;
 
     return p;
 }
 
-Symbol *type_symbol_new(const char *filename, int line, const char *identifier,
-                        Type *type) {
+Symbol *type_symbol_new(int location, const char *identifier, Type *type) {
     Symbol *p;
 
-    assert(filename != NULL);
     assert(identifier != NULL);
     assert(type != NULL);
 
     p = malloc(sizeof(*p));
     p->kind = symbol_type;
-    p->filename = str_dup(filename);
-    p->line = line;
+    p->location = location;
     p->identifier = str_dup(identifier);
     p->type = type;
 
@@ -4,7 +4,9 @@
 
 void test_path(void);
 void test_vec(void);
+void test_small_vec(void);
 void test_map(void);
+void test_scope_stack(void);
 void test_lexer(void);
 void test_preprocessor(Vec *include_directories);
 void test_parser(void);
@@ -19,7 +21,9 @@ int main(int argc, char **argv) {
 
     test_path();
     test_vec();
+    test_small_vec();
     test_map();
+    test_scope_stack();
     test_lexer();
 
     Vec *include_directories = vec_new();
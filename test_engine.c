@@ -50,6 +50,457 @@ void test_engine_run_function(const char *filename, const char *src,
     fprintf(stderr, "done!!\n");
 }
 
+void test_engine_compile(const char *filename, const char *src) {
+    assert(filename != NULL);
+    assert(src != NULL);
+
+    fprintf(stderr, "test_engine:%s --- ", filename);
+
+    TranslationUnitNode *node = parse(filename, src, vec_new());
+    LLVMModuleRef module = generate(node);
+
+    LLVMDisposeModule(module);
+
+    fprintf(stderr, "done!!\n");
+}
+
+/* src with every placeholder replaced by count copies of repeated */
+char *test_engine_repeat(const char *src, char placeholder,
+                         const char *repeated, int count) {
+    size_t len_src = strlen(src);
+    size_t len_repeated = strlen(repeated);
+    char *result = malloc(len_src + len_repeated * count + 1);
+    char *p = result;
+
+    for (size_t i = 0; i < len_src; i++) {
+        if (src[i] != placeholder) {
+            *p++ = src[i];
+            continue;
+        }
+
+        for (int j = 0; j < count; j++) {
+            memcpy(p, repeated, len_repeated);
+            p += len_repeated;
+        }
+    }
+    *p = '\0';
+
+    return result;
+}
+
+/* machine generated nesting that must neither overflow the stack nor take
+   quadratic time */
+void test_engine_deep_nesting(void) {
+    const int depth = 100000;
+    char *src;
+    char *cascade;
+
+    src = test_engine_repeat("int parens(int n) {\n"
+                             "  return @n%;\n"
+                             "}\n",
+                             '@', "(", depth);
+    src = test_engine_repeat(src, '%', ")", depth);
+    test_engine_run_function("parens", src, "parens", 42, 42);
+
+    src = test_engine_repeat("int left_parens(int n) {\n"
+                             "  return @n%;\n"
+                             "}\n",
+                             '@', "(", depth);
+    src = test_engine_repeat(src, '%', " + 1)", depth);
+    test_engine_run_function("left_parens", src, "left_parens", 1,
+                             depth + 1);
+
+    src = test_engine_repeat("int sum_chain(int n) {\n"
+                             "  return n@;\n"
+                             "}\n",
+                             '@', " + 1", depth);
+    test_engine_run_function("sum_chain", src, "sum_chain", 2, depth + 2);
+
+    /* the backend is slow on 100000 basic blocks, so branching shapes are
+       only parsed and lowered (generate() verifies the module) at full depth
+       and executed at a smaller one */
+    for (int i = 0; i < 2; i++) {
+        int n = i == 0 ? depth : 1000;
+
+        src = test_engine_repeat("int or_chain(int n) {\n"
+                                 "  return n == 0@;\n"
+                                 "}\n",
+                                 '@', " || n == 0", n);
+        cascade = test_engine_repeat("int cascade(int n) {\n"
+                                     "  int i;\n"
+                                     "  i = 0;\n"
+                                     "  if (n == i) return 1;\n"
+                                     "  @\n"
+                                     "  else return 0;\n"
+                                     "}\n",
+                                     '@', "else if (n == ++i) return i + 1;\n",
+                                     n);
+
+        if (i == 0) {
+            test_engine_compile("or_chain", src);
+            test_engine_compile("cascade", cascade);
+        } else {
+            test_engine_run_function("or_chain", src, "or_chain", 0, 1);
+            test_engine_run_function("cascade", cascade, "cascade", n - 1, n);
+        }
+    }
+}
+
+void test_engine_linkage(void) {
+    const char *src = "static int calls;\n"
+                      "static int square(int n);\n"
+                      "int square(int n) {\n"
+                      "  calls++;\n"
+                      "  return n * n;\n"
+                      "}\n"
+                      "inline int twice(int n) {\n"
+                      "  return n + n;\n"
+                      "}\n"
+                      "int linkage(int n) {\n"
+                      "  return square(n) + twice(n) + calls;\n"
+                      "}\n";
+
+    LLVMModuleRef module = generate(parse("linkage", src, vec_new()));
+
+    assert(LLVMGetLinkage(LLVMGetNamedGlobal(module, "calls")) ==
+           LLVMInternalLinkage);
+    assert(LLVMGetLinkage(LLVMGetNamedFunction(module, "square")) ==
+           LLVMInternalLinkage);
+    assert(LLVMGetLinkage(LLVMGetNamedFunction(module, "twice")) ==
+           LLVMLinkOnceODRLinkage);
+    assert(LLVMGetLinkage(LLVMGetNamedFunction(module, "linkage")) ==
+           LLVMExternalLinkage);
+
+    LLVMDisposeModule(module);
+
+    test_engine_run_function("linkage", src, "linkage", 3, 16);
+}
+
+bool test_engine_has_attribute(LLVMValueRef function, int index,
+                               const char *name) {
+    unsigned kind = LLVMGetEnumAttributeKindForName(name, strlen(name));
+
+    return LLVMGetEnumAttributeAtIndex(function, index, kind) != NULL;
+}
+
+void test_engine_attributes(void) {
+    const char *src =
+        "void fail(int code) __attribute__((noreturn, cold));\n"
+        "__attribute__((always_inline)) static int add(int a, int b) {\n"
+        "  return a + b;\n"
+        "}\n"
+        "int square(int n) __attribute__((__const__, noinline, hot));\n"
+        "int square(int n) {\n"
+        "  return n * n;\n"
+        "}\n"
+        "int first(int *p) __attribute__((pure, nonnull));\n"
+        "int first(int *p) {\n"
+        "  return *p;\n"
+        "}\n"
+        "int second(int *p) __attribute__((nonnull));\n"
+        "int second(int *p) __attribute__((cold)) {\n"
+        "  return p[1];\n"
+        "}\n"
+        "char *buffer(int size, char *s, char *t)\n"
+        "  __attribute__((malloc)) __attribute__((nonnull(3)));\n"
+        "int aligned_var __attribute__((aligned(16)));\n"
+        "int __attribute__((aligned(32))) attributes(int n) {\n"
+        "  int m;\n"
+        "  m = n;\n"
+        "  if (n < 0) fail(1);\n"
+        "  return add(square(n), first(&m));\n"
+        "}\n";
+
+    LLVMModuleRef module = generate(parse("attributes", src, vec_new()));
+    LLVMValueRef fail = LLVMGetNamedFunction(module, "fail");
+    LLVMValueRef add = LLVMGetNamedFunction(module, "add");
+    LLVMValueRef square = LLVMGetNamedFunction(module, "square");
+    LLVMValueRef first = LLVMGetNamedFunction(module, "first");
+    LLVMValueRef second = LLVMGetNamedFunction(module, "second");
+    LLVMValueRef buffer = LLVMGetNamedFunction(module, "buffer");
+    LLVMValueRef attributes = LLVMGetNamedFunction(module, "attributes");
+    int function_index = LLVMAttributeFunctionIndex;
+
+    assert(test_engine_has_attribute(fail, function_index, "noreturn"));
+    assert(test_engine_has_attribute(fail, function_index, "cold"));
+    assert(test_engine_has_attribute(add, function_index, "alwaysinline"));
+    assert(test_engine_has_attribute(square, function_index, "readnone"));
+    assert(test_engine_has_attribute(square, function_index, "noinline"));
+    assert(test_engine_has_attribute(square, function_index, "hot"));
+    assert(test_engine_has_attribute(first, function_index, "readonly"));
+    assert(test_engine_has_attribute(first, 1, "nonnull"));
+    assert(test_engine_has_attribute(second, function_index, "cold"));
+    assert(test_engine_has_attribute(second, 1, "nonnull"));
+    assert(test_engine_has_attribute(buffer, LLVMAttributeReturnIndex,
+                                     "noalias"));
+    assert(!test_engine_has_attribute(buffer, 2, "nonnull"));
+    assert(test_engine_has_attribute(buffer, 3, "nonnull"));
+    assert(!test_engine_has_attribute(attributes, function_index, "cold"));
+    assert(LLVMGetAlignment(attributes) == 32);
+    assert(LLVMGetAlignment(LLVMGetNamedGlobal(module, "aligned_var")) == 16);
+
+    LLVMDisposeModule(module);
+
+    test_engine_run_function("attributes", src, "attributes", 3, 12);
+}
+
+void test_engine_builtins(void) {
+    const char *src =
+        "int builtins(int n) {\n"
+        "  char buffer[8];\n"
+        "  char copy[8];\n"
+        "  long x;\n"
+        "  int i;\n"
+        "  int sum;\n"
+        "  __builtin_memset(buffer, n, 8);\n"
+        "  __builtin_memcpy(copy, buffer, sizeof(copy));\n"
+        "  __builtin_prefetch(copy);\n"
+        "  __builtin_prefetch(copy, 0, 1);\n"
+        "  sum = 0;\n"
+        "  for (i = 0; __builtin_expect(i < 8, 1); i++) sum = sum + copy[i];\n"
+        "  if (__builtin_expect(n < 0, 0)) __builtin_unreachable();\n"
+        "  x = __builtin_bswap64(n);\n"
+        "  return sum + __builtin_popcount(n) + __builtin_clz(n) +\n"
+        "         __builtin_ctz(n * 4) + __builtin_popcountl(x) +\n"
+        "         __builtin_clzl(x) + __builtin_ctzl(x) +\n"
+        "         __builtin_bswap32(__builtin_bswap32(n));\n"
+        "}\n";
+
+    LLVMModuleRef module = generate(parse("builtins", src, vec_new()));
+    char *ir = LLVMPrintModuleToString(module);
+
+    assert(strstr(ir, "!prof") != NULL);
+    assert(strstr(ir, "!{!\"branch_weights\", i32 2000, i32 1}") != NULL);
+    assert(strstr(ir, "!{!\"branch_weights\", i32 1, i32 2000}") != NULL);
+    assert(strstr(ir, "unreachable") != NULL);
+    assert(strstr(ir, "@llvm.memcpy") != NULL);
+    assert(strstr(ir, "@llvm.prefetch") != NULL);
+    assert(strstr(ir, "@__builtin") == NULL);
+
+    LLVMDisposeMessage(ir);
+    LLVMDisposeModule(module);
+
+    /* 3 * 8 + 2 + 30 + 2 + 2 + 6 + 56 + 3 */
+    test_engine_run_function("builtins", src, "builtins", 3, 125);
+}
+
+void test_engine_restrict(void) {
+    const char *src = "void add(int *restrict dst, int *__restrict src,\n"
+                      "         int n) {\n"
+                      "  int i;\n"
+                      "  for (i = 0; i < n; i++) dst[i] = dst[i] + src[i];\n"
+                      "}\n"
+                      "int restrict_locals(int n) {\n"
+                      "  int a[4];\n"
+                      "  int b[4];\n"
+                      "  int *restrict p;\n"
+                      "  int *const restrict q;\n"
+                      "  p = a;\n"
+                      "  q = b;\n"
+                      "  *p = n;\n"
+                      "  *q = 2;\n"
+                      "  add(p, q, 1);\n"
+                      "  return *p + q[0];\n"
+                      "}\n";
+
+    LLVMModuleRef module = generate(parse("restrict", src, vec_new()));
+    LLVMValueRef add = LLVMGetNamedFunction(module, "add");
+    char *ir = LLVMPrintModuleToString(module);
+
+    assert(test_engine_has_attribute(add, 1, "noalias"));
+    assert(test_engine_has_attribute(add, 2, "noalias"));
+    assert(!test_engine_has_attribute(add, 3, "noalias"));
+    assert(strstr(ir, "!{!\"add: dst\", !") != NULL);
+    assert(strstr(ir, "!{!\"restrict_locals: q\", !") != NULL);
+    assert(strstr(ir, "!alias.scope") != NULL);
+    assert(strstr(ir, "!noalias") != NULL);
+
+    LLVMDisposeMessage(ir);
+    LLVMDisposeModule(module);
+
+    test_engine_run_function("restrict", src, "restrict_locals", 3, 7);
+}
+
+void test_engine_loop_pragmas(void) {
+    const char *src =
+        "#define WIDTH 4\n"
+        "struct pair {\n"
+        "#pragma pack(1)\n"
+        "  int first;\n"
+        "  int second;\n"
+        "#pragma pack()\n"
+        "};\n"
+        "int loop_pragmas(int n) {\n"
+        "  int a[64];\n"
+        "  int i;\n"
+        "  int sum;\n"
+        "  sum = 0;\n"
+        "#pragma clang loop vectorize(enable) interleave_count(2)\n"
+        "#pragma clang loop vectorize_width(WIDTH)\n"
+        "  for (i = 0; i < 64; i++) a[i] = i * n;\n"
+        "  i = 0;\n"
+        "#pragma unroll 4\n"
+        "  while (i < 64) {\n"
+        "    sum = sum + a[i];\n"
+        "    i++;\n"
+        "    if (i == 100) continue;\n"
+        "  }\n"
+        "#pragma nounroll\n"
+        "  do i--; while (i > 0);\n"
+        "#pragma unroll\n"
+        "  for (;;) break;\n"
+        "#pragma once\n"
+        "  return sum;\n"
+        "}\n";
+
+    LLVMModuleRef module = generate(parse("loop_pragmas", src, vec_new()));
+    char *ir = LLVMPrintModuleToString(module);
+
+    assert(strstr(ir, "!llvm.loop") != NULL);
+    assert(strstr(ir, "distinct !{") != NULL);
+    assert(strstr(ir, "!{!\"llvm.loop.mustprogress\"}") != NULL);
+    assert(strstr(ir, "!{!\"llvm.loop.vectorize.enable\", i1 true}") != NULL);
+    assert(strstr(ir, "!{!\"llvm.loop.vectorize.width\", i32 4}") != NULL);
+    assert(strstr(ir, "!{!\"llvm.loop.interleave.count\", i32 2}") != NULL);
+    assert(strstr(ir, "!{!\"llvm.loop.unroll.count\", i32 4}") != NULL);
+    assert(strstr(ir, "!{!\"llvm.loop.unroll.disable\"}") != NULL);
+    assert(strstr(ir, "!{!\"llvm.loop.unroll.full\"}") != NULL);
+
+    LLVMDisposeMessage(ir);
+    LLVMDisposeModule(module);
+
+    test_engine_run_function("loop_pragmas", src, "loop_pragmas", 2, 4032);
+}
+
+void test_engine_partitions(void) {
+    const char *names[] = {"twice", "length", "is_odd", "is_even",
+                           "partitions"};
+    const char *src = "int counter;\n"
+                      "static int calls;\n"
+                      "int twice(int n) {\n"
+                      "  counter = counter + 1;\n"
+                      "  return n * 2;\n"
+                      "}\n"
+                      "int length(char *s) {\n"
+                      "  int n;\n"
+                      "  n = 0;\n"
+                      "  while (s[n]) n++;\n"
+                      "  return n;\n"
+                      "}\n"
+                      "int is_even(int n);\n"
+                      "int is_odd(int n) {\n"
+                      "  calls++;\n"
+                      "  if (n == 0) return 0;\n"
+                      "  return is_even(n - 1);\n"
+                      "}\n"
+                      "int is_even(int n) {\n"
+                      "  if (n == 0) return 1;\n"
+                      "  return is_odd(n - 1);\n"
+                      "}\n"
+                      "int partitions(int n) {\n"
+                      "  return twice(n) + length(\"abc\") + is_even(n) +\n"
+                      "         counter + calls;\n"
+                      "}\n";
+
+    fprintf(stderr, "test_engine:partitions --- ");
+
+    TranslationUnitNode *node = parse("partitions", src, vec_new());
+    LLVMModuleRef module = generate(node);
+    Vec *partitions = partition_module(module, 3);
+
+    assert(partitions->size == 3);
+
+    /* every definition lives in exactly one partition */
+    int num_strings = 0;
+
+    for (int i = 0; i < partitions->size; i++) {
+        LLVMModuleRef partition = partitions->data[i];
+        char *error = NULL;
+
+        assert(!LLVMVerifyModule(partition, LLVMReturnStatusAction, &error));
+        LLVMDisposeMessage(error);
+
+        LLVMValueRef counter = LLVMGetNamedGlobal(partition, "counter");
+
+        assert(counter != NULL);
+        assert((LLVMGetInitializer(counter) != NULL) == (i == 0));
+
+        for (LLVMValueRef g = LLVMGetFirstGlobal(partition); g != NULL;
+             g = LLVMGetNextGlobal(g)) {
+            if (LLVMGetLinkage(g) == LLVMPrivateLinkage) {
+                num_strings++;
+            }
+        }
+    }
+
+    assert(num_strings == 1);
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        int num_definitions = 0;
+
+        for (int j = 0; j < partitions->size; j++) {
+            LLVMValueRef f = LLVMGetNamedFunction(partitions->data[j],
+                                                  names[i]);
+
+            if (f != NULL && !LLVMIsDeclaration(f)) {
+                num_definitions++;
+            }
+        }
+
+        assert(num_definitions == 1);
+    }
+
+    /* the partitions link together */
+    LLVMExecutionEngineRef engine = NULL;
+    char *error = NULL;
+
+    if (LLVMCreateExecutionEngineForModule(&engine, partitions->data[0],
+                                           &error)) {
+        fprintf(stderr, "partitions: error %s\n", error);
+        exit(1);
+    }
+
+    for (int i = 1; i < partitions->size; i++) {
+        LLVMAddModule(engine, partitions->data[i]);
+    }
+
+    int (*f)(int) = (int (*)(int))LLVMGetFunctionAddress(engine, "partitions");
+
+    assert(f(4) == 15);
+
+    LLVMDisposeMessage(error);
+    LLVMDisposeExecutionEngine(engine);
+    LLVMDisposeModule(module);
+
+    /* two one-block functions, one per partition. the declaration of the
+       other keeps its attributes */
+    src = "int first(int *p) __attribute__((nonnull, pure));\n"
+          "int first(int *p) {\n"
+          "  return *p;\n"
+          "}\n"
+          "int second(int *p) {\n"
+          "  return first(p);\n"
+          "}\n";
+
+    module = generate(parse("partitions", src, vec_new()));
+    partitions = partition_module(module, 2);
+
+    LLVMValueRef first = LLVMGetNamedFunction(partitions->data[1], "first");
+    LLVMValueRef second = LLVMGetNamedFunction(partitions->data[1], "second");
+
+    assert(!LLVMIsDeclaration(
+        LLVMGetNamedFunction(partitions->data[0], "first")));
+    assert(LLVMIsDeclaration(first));
+    assert(!LLVMIsDeclaration(second));
+    assert(test_engine_has_attribute(first, LLVMAttributeFunctionIndex,
+                                     "readonly"));
+    assert(test_engine_has_attribute(first, 1, "nonnull"));
+
+    LLVMDisposeModule(module);
+
+    fprintf(stderr, "done!!\n");
+}
+
 void test_engine(void) {
     LLVMInitializeNativeTarget();
     LLVMInitializeNativeAsmPrinter();
@@ -802,6 +1253,179 @@ void test_engine(void) {
                              "}\n",
                              "switch7", 0, 20);
 
+    test_engine_run_function("switch_fold1",
+                             "int switch_fold1(int n) {\n"
+                             "  switch (n) {\n"
+                             "  case 'a': return 1;\n"
+                             "  case 1 + 2 * 3: return 2;\n"
+                             "  case -1: return 3;\n"
+                             "  case (char)300: return 4;\n"
+                             "  }\n"
+                             "  return 0;\n"
+                             "}\n",
+                             "switch_fold1", 7, 2);
+
+    test_engine_run_function("switch_fold2",
+                             "int switch_fold2(int n) {\n"
+                             "  switch (n) {\n"
+                             "  case 'a': return 1;\n"
+                             "  case 1 + 2 * 3: return 2;\n"
+                             "  case -1: return 3;\n"
+                             "  case (char)300: return 4;\n"
+                             "  }\n"
+                             "  return 0;\n"
+                             "}\n",
+                             "switch_fold2", 44, 4);
+
+    test_engine_run_function("switch_fold_sizeof",
+                             "struct s { char c; long l; int i; };\n"
+                             "int switch_fold_sizeof(int n) {\n"
+                             "  switch (n) {\n"
+                             "  case sizeof(int): return 1;\n"
+                             "  case sizeof(struct s): return 2;\n"
+                             "  }\n"
+                             "  return 0;\n"
+                             "}\n",
+                             "switch_fold_sizeof", 24, 2);
+
+    const char *switch_long =
+        "int switch_long(int n) {\n"
+        "  long x;\n"
+        "  x = (long)n * 65536 * 65536;\n"
+        "  switch (x) {\n"
+        "  case (long)65536 * 65536: return 1;\n"
+        "  case (long)-65536 * 65536 * 2: return 2;\n"
+        "  case 0 && 1 / 0: return 3;\n"
+        "  case (long)2147483647 * 2147483647: return 4;\n"
+        "  }\n"
+        "  return 0;\n"
+        "}\n";
+
+    test_engine_run_function("switch_long", switch_long, "switch_long", 1, 1);
+    test_engine_run_function("switch_long", switch_long, "switch_long", -2, 2);
+    test_engine_run_function("switch_long", switch_long, "switch_long", 0, 3);
+
+    test_engine_run_function("literals",
+                             "int literals(int n) {\n"
+                             "  return n * 0x10 + 010 + 1u + 2L;\n"
+                             "}\n",
+                             "literals", 2, 43);
+
+    test_engine_run_function("switch_dense",
+                             "int g(int n) {\n"
+                             "  switch (n) {\n"
+                             "  case 0: return 3;\n"
+                             "  case 1: return 5;\n"
+                             "  case 2: return 7;\n"
+                             "  case 3: return 11;\n"
+                             "  case 4: return 13;\n"
+                             "  case 5: return 17;\n"
+                             "  case 6: return 19;\n"
+                             "  case 7: return 23;\n"
+                             "  default: return 1;\n"
+                             "  }\n"
+                             "}\n"
+                             "int switch_dense(int n) {\n"
+                             "  int i;\n"
+                             "  int s;\n"
+                             "  s = 0;\n"
+                             "  for (i = n; i < 10; i++)\n"
+                             "    s = s + g(i) * (i + 3);\n"
+                             "  return s;\n"
+                             "}\n",
+                             "switch_dense", -2, 784);
+
+    test_engine_run_function("switch_sparse",
+                             "int g(int n) {\n"
+                             "  switch (n) {\n"
+                             "  case 100000: return 8;\n"
+                             "  case 1: return 2;\n"
+                             "  case 77: return 4;\n"
+                             "  case 10000: return 7;\n"
+                             "  case -50: return 1;\n"
+                             "  case 100: return 5;\n"
+                             "  case 10: return 3;\n"
+                             "  case 1000: return 6;\n"
+                             "  }\n"
+                             "  return 0;\n"
+                             "}\n"
+                             "int switch_sparse(int n) {\n"
+                             "  int i;\n"
+                             "  int s;\n"
+                             "  s = 0;\n"
+                             "  for (i = n; i < 200000; i++)\n"
+                             "    s = s + g(i) * (i % 1000 + 1);\n"
+                             "  return s;\n"
+                             "}\n",
+                             "switch_sparse", -60, 826);
+
+    test_engine_run_function("switch_bits1",
+                             "int g(int c) {\n"
+                             "  switch (c) {\n"
+                             "  case ' ': case 9: case 10:\n"
+                             "  case 11: case 12: case 13:\n"
+                             "    return 1;\n"
+                             "  default:\n"
+                             "    return 0;\n"
+                             "  }\n"
+                             "}\n"
+                             "int switch_bits1(int n) {\n"
+                             "  int i;\n"
+                             "  int s;\n"
+                             "  s = 0;\n"
+                             "  for (i = n; i < 128; i++) s = s + g(i) * i;\n"
+                             "  return s;\n"
+                             "}\n",
+                             "switch_bits1", 0, 87);
+
+    test_engine_run_function("switch_bits2",
+                             "int g(int c) {\n"
+                             "  switch (c) {\n"
+                             "  case 'a': case 'e': case 'i':\n"
+                             "  case 'o': case 'u':\n"
+                             "    return 1;\n"
+                             "  case 'y': case 'w':\n"
+                             "    return 2;\n"
+                             "  }\n"
+                             "  return 0;\n"
+                             "}\n"
+                             "int switch_bits2(int n) {\n"
+                             "  int i;\n"
+                             "  int s;\n"
+                             "  s = 0;\n"
+                             "  for (i = n; i < 128; i++) s = s + g(i) * i;\n"
+                             "  return s;\n"
+                             "}\n",
+                             "switch_bits2", 0, 1011);
+
+    test_engine_run_function("struct_wide",
+                             "struct S {\n"
+                             "  int m0; int m1; int m2; int m3; int m4;\n"
+                             "  int m5; int m6; int m7; int m8; int m9;\n"
+                             "};\n"
+                             "int struct_wide(int n) {\n"
+                             "  struct S s;\n"
+                             "  struct S *p;\n"
+                             "  p = &s;\n"
+                             "  s.m0 = n;\n"
+                             "  s.m5 = 5;\n"
+                             "  p->m9 = 9;\n"
+                             "  return p->m0 * 100 + s.m9 * 10 + p->m5;\n"
+                             "}\n",
+                             "struct_wide", 3, 395);
+
+    test_engine_run_function("macro_function",
+                             "#define SQUARE(x) ((x) * (x))\n"
+                             "#define CAT(a, b) a ## b\n"
+                             "#define CALL(f, ...) f(__VA_ARGS__)\n"
+                             "int add3(int a, int b, int c) {\n"
+                             "  return a + b + c;\n"
+                             "}\n"
+                             "int CAT(macro_, function)(int n) {\n"
+                             "  return CALL(add3, SQUARE(n + 1), n, 1);\n"
+                             "}\n",
+                             "macro_function", 3, 20);
+
     test_engine_run_function("not1",
                              "int not1(int n) {\n"
                              "  return !0 == 1 &&\n"
@@ -827,6 +1451,71 @@ void test_engine(void) {
                              "  return 107 & 55;\n"
                              "}\n",
                              "bit_and", 0, 107 & 55);
+
+    test_engine_run_function("precedence",
+                             "int precedence(int n) {\n"
+                             "  return 100 - n - 10 / 5 * 2 % 3 +\n"
+                             "         (1 < 2 == 1) + (4 | 1 ^ 3 & 2) +\n"
+                             "         (n == 20 || 0 && 0);\n"
+                             "}\n",
+                             "precedence", 20, 88);
+
+    test_engine_run_function("long1",
+                             "int long1(int n) {\n"
+                             "  long a;\n"
+                             "  long int b;\n"
+                             "  a = n * 65536;\n"
+                             "  b = a * 65536;\n"
+                             "  return b / 65536 / 65536 + sizeof(long);\n"
+                             "}\n",
+                             "long1", 3, 11);
+
+    test_engine_run_function("long2",
+                             "int long2(int n) {\n"
+                             "  long a;\n"
+                             "  a = 1;\n"
+                             "  while (n > 0) { a = a * 1000; n = n - 1; }\n"
+                             "  return a / 1000000000 - 1000;\n"
+                             "}\n",
+                             "long2", 4, 0);
+
+    test_engine_run_function("ptrdiff_long",
+                             "int ptrdiff_long(int n) {\n"
+                             "  long a[4];\n"
+                             "  return (&a[3] - &a[0]) * sizeof(a[0]);\n"
+                             "}\n",
+                             "ptrdiff_long", 0, 24);
+
+    test_engine_deep_nesting();
+
+    /* bodies parsed after the file scope see later declarations */
+    parser_skim_bodies = true;
+
+    test_engine_run_function("skim_bodies",
+                             "int skim_bodies(int n) {\n"
+                             "  if (n > 0) {\n"
+                             "    struct point p;\n"
+                             "    p.x = n;\n"
+                             "    return twice(p.x) + counter;\n"
+                             "  }\n"
+                             "  { return 0; }\n"
+                             "}\n"
+                             "struct point { int x; };\n"
+                             "int counter;\n"
+                             "int twice(int n) {\n"
+                             "  counter = 1;\n"
+                             "  return n * 2;\n"
+                             "}\n",
+                             "skim_bodies", 21, 43);
+
+    parser_skim_bodies = false;
+
+    test_engine_linkage();
+    test_engine_attributes();
+    test_engine_builtins();
+    test_engine_restrict();
+    test_engine_loop_pragmas();
+    test_engine_partitions();
 }
 
 int test_extern = 24;
@@ -36,7 +36,6 @@ void test_generating_integer(void) {
 
     IntegerNode *p = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 42,
@@ -59,10 +58,9 @@ void test_generating_identifier(void) {
 
     IdentifierNode *p = &(IdentifierNode){
         .kind = node_identifier,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = true,
-        .symbol = variable_symbol_new("", 1, "a", type_get_int32()),
+        .symbol = variable_symbol_new(0, "a", type_get_int32()),
     };
 
     LLVMValueRef func = LLVMAddFunction(
@@ -90,7 +88,6 @@ void test_generating_negative(void) {
 
     IntegerNode *q = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 42,
@@ -98,7 +95,6 @@ void test_generating_negative(void) {
 
     UnaryNode *p = &(UnaryNode){
         .kind = node_unary,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .operator_ = '-',
@@ -122,7 +118,6 @@ void test_generating_addition(void) {
 
     IntegerNode *l = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 15,
@@ -130,7 +125,6 @@ void test_generating_addition(void) {
 
     IntegerNode *r = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 8,
@@ -138,7 +132,6 @@ void test_generating_addition(void) {
 
     BinaryNode *p = &(BinaryNode){
         .kind = node_binary,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .operator_ = '+',
@@ -163,7 +156,6 @@ void test_generating_subtraction(void) {
 
     IntegerNode *l = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 15,
@@ -171,7 +163,6 @@ void test_generating_subtraction(void) {
 
     IntegerNode *r = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 8,
@@ -179,7 +170,6 @@ void test_generating_subtraction(void) {
 
     BinaryNode *p = &(BinaryNode){
         .kind = node_binary,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .operator_ = '-',
@@ -204,7 +194,6 @@ void test_generating_multiplication(void) {
 
     IntegerNode *l = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 15,
@@ -212,7 +201,6 @@ void test_generating_multiplication(void) {
 
     IntegerNode *r = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 8,
@@ -220,7 +208,6 @@ void test_generating_multiplication(void) {
 
     BinaryNode *p = &(BinaryNode){
         .kind = node_binary,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .operator_ = '*',
@@ -245,7 +232,6 @@ void test_generating_division(void) {
 
     IntegerNode *l = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 15,
@@ -253,7 +239,6 @@ void test_generating_division(void) {
 
     IntegerNode *r = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 8,
@@ -261,7 +246,6 @@ void test_generating_division(void) {
 
     BinaryNode *p = &(BinaryNode){
         .kind = node_binary,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .operator_ = '/',
@@ -286,7 +270,6 @@ void test_generating_modulo(void) {
 
     IntegerNode *l = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 15,
@@ -294,7 +277,6 @@ void test_generating_modulo(void) {
 
     IntegerNode *r = &(IntegerNode){
         .kind = node_integer,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .value = 8,
@@ -302,7 +284,6 @@ void test_generating_modulo(void) {
 
     BinaryNode *p = &(BinaryNode){
         .kind = node_binary,
-        .line = 1,
         .type = type_get_int32(),
         .is_lvalue = false,
         .operator_ = '%',
@@ -327,9 +308,8 @@ void test_generating_function_prototype(void) {
 
     FunctionNode *p = &(FunctionNode){
         .kind = node_function,
-        .line = 1,
         .symbol = (Symbol *)variable_symbol_new(
-            "", 1, "f", function_type_new(type_get_int32(), NULL, 0, false)),
+            0, "f", function_type_new(type_get_int32(), NULL, 0, false)),
         .params = NULL,
         .num_params = 0,
         .var_args = false,
@@ -357,16 +337,14 @@ void test_generating_function(void) {
 
     FunctionNode *p = &(FunctionNode){
         .kind = node_function,
-        .line = 1,
         .symbol = (Symbol *)variable_symbol_new(
-            "", 1, "f", function_type_new(type_get_void(), NULL, 0, false)),
+            0, "f", function_type_new(type_get_void(), NULL, 0, false)),
         .params = NULL,
         .num_params = 0,
         .var_args = false,
         .body =
             (StmtNode *)&(CompoundNode){
                 .kind = node_compound,
-                .line = 1,
                 .stmts = NULL,
                 .num_stmts = 0,
             },
@@ -396,17 +374,15 @@ void test_generating_function_with_param(void) {
 
     FunctionNode *p = &(FunctionNode){
         .kind = node_function,
-        .line = 1,
         .symbol = (Symbol *)variable_symbol_new(
-            "", 1, "g",
+            0, "g",
             function_type_new(type_get_void(), (Type *[]){type_get_int32()}, 1,
                               false)),
         .params =
             (VariableNode *[]){
                 &(VariableNode){
                     .kind = node_variable,
-                    .line = 1,
-                    .symbol = (Symbol *)variable_symbol_new("", 1, "a",
+                    .symbol = (Symbol *)variable_symbol_new(0, "a",
                                                             type_get_int32()),
                 },
             },
@@ -415,7 +391,6 @@ void test_generating_function_with_param(void) {
         .body =
             (StmtNode *)&(CompoundNode){
                 .kind = node_compound,
-                .line = 1,
                 .stmts = NULL,
                 .num_stmts = 0,
             },
@@ -447,9 +422,8 @@ void test_generating_function_with_params(void) {
 
     FunctionNode *p = &(FunctionNode){
         .kind = node_function,
-        .line = 1,
         .symbol = (Symbol *)variable_symbol_new(
-            "", 1, "g",
+            0, "g",
             function_type_new(type_get_void(),
                               (Type *[]){type_get_int32(), type_get_int32()}, 2,
                               false)),
@@ -457,14 +431,12 @@ void test_generating_function_with_params(void) {
             (VariableNode *[]){
                 &(VariableNode){
                     .kind = node_variable,
-                    .line = 1,
-                    .symbol = (Symbol *)variable_symbol_new("", 1, "a",
+                    .symbol = (Symbol *)variable_symbol_new(0, "a",
                                                             type_get_int32()),
                 },
                 &(VariableNode){
                     .kind = node_variable,
-                    .line = 1,
-                    .symbol = (Symbol *)variable_symbol_new("", 1, "b",
+                    .symbol = (Symbol *)variable_symbol_new(0, "b",
                                                             type_get_int32()),
                 },
             },
@@ -473,7 +445,6 @@ void test_generating_function_with_params(void) {
         .body =
             (StmtNode *)&(CompoundNode){
                 .kind = node_compound,
-                .line = 1,
                 .stmts = NULL,
                 .num_stmts = 0,
             },
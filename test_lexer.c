@@ -53,7 +53,84 @@ static void test_tokens(const char *src, const TokenTestSuite *suites) {
     } while (toks[i++]->kind != '\0');
 }
 
+static void test_skip_text_lines(const char *src, const char *rest, int line) {
+    LexerContext *ctx = lexer_new("test_lexer", src);
+
+    lex_skip_text_lines(ctx);
+
+    if (strcmp(ctx->src + ctx->index, rest) != 0) {
+        fprintf(stderr, "%s\n: rest is expected %s, but got %s\n", src, rest,
+                ctx->src + ctx->index);
+        exit(1);
+    }
+
+    if (ctx->line != line) {
+        fprintf(stderr, "%s\n: line is expected %d, but got %d\n", src, line,
+                ctx->line);
+        exit(1);
+    }
+}
+
+static void test_keywords(void) {
+    const char *src = "if ifx sizeof _if unsigned do d0 typedef static inlined "
+                      "inline __attribute__ restrict __restrict";
+    const int expected[] = {token_if,       0,
+                            token_sizeof,   0,
+                            token_unsigned, token_do,
+                            0,              token_typedef,
+                            token_static,   0,
+                            token_inline,   token_attribute,
+                            token_restrict, token_restrict};
+    const Token **toks = (const Token **)lex("test_keywords", src)->data;
+
+    for (int i = 0; i < 14; i++) {
+        const Token *t = toks[i * 2];
+
+        if (t->kind != token_identifier || t->keyword != expected[i]) {
+            fprintf(stderr, "%s: keyword of %s is expected %d, but got %d\n",
+                    src, t->text, expected[i], t->keyword);
+            exit(1);
+        }
+    }
+}
+
+static void test_source_locations(void) {
+    const Token **a = (const Token **)lex("test_a", "int\n  x;\n")->data;
+    const Token **b = (const Token **)lex("test_b", "/* */ y\\\nz")->data;
+    const struct {
+        const Token *token;
+        const char *filename;
+        int line;
+        int column;
+    } suites[] = {
+        {a[0], "test_a", 1, 1}, {a[3], "test_a", 2, 3}, {a[4], "test_a", 2, 4},
+        {b[2], "test_b", 1, 7}, {b[4], "test_b", 2, 1}, {b[5], "test_b", 2, 2},
+    };
+
+    for (int i = 0; i < 6; i++) {
+        int location = suites[i].token->location;
+        const char *filename = source_location_filename(location);
+        int line = source_location_line(location);
+        int column = source_location_column(location);
+
+        if (strcmp(filename, suites[i].filename) != 0 ||
+            line != suites[i].line || column != suites[i].column) {
+            fprintf(stderr,
+                    "%s: location is expected %s(%d:%d), but got %s(%d:%d)\n",
+                    suites[i].token->text, suites[i].filename, suites[i].line,
+                    suites[i].column, filename, line, column);
+            exit(1);
+        }
+    }
+
+    assert(strcmp(source_location_filename(0), "<built-in>") == 0);
+    assert(source_location_line(0) == 0);
+}
+
 void test_lexer(void) {
+    test_keywords();
+    test_source_locations();
+
     test_tokens("42  + 5 - \n a*abc", (TokenTestSuite[]){
                                           {token_number, "42", 1, NULL},
                                           {' ', "  ", 1, NULL},
@@ -88,6 +165,15 @@ void test_lexer(void) {
                                             {'\0', "", 2, NULL},
                                         });
 
+    test_tokens("0x1fUL<<010>>2", (TokenTestSuite[]){
+                                      {token_number, "0x1fUL", 1, NULL},
+                                      {token_left_shift, "<<", 1, NULL},
+                                      {token_number, "010", 1, NULL},
+                                      {token_right_shift, ">>", 1, NULL},
+                                      {token_number, "2", 1, NULL},
+                                      {'\0', "", 1, NULL},
+                                  });
+
     test_tokens("\"\" \"hello\"\n\"wor\\nld\" \"he\\\"lp\"",
                 (TokenTestSuite[]){
                     {token_string, "\"\"", 1, ""},
@@ -122,4 +208,33 @@ void test_lexer(void) {
                     {token_character, "'\\n'", 1, "\n"},
                     {'\0', "", 1, NULL},
                 });
+
+    test_tokens("#a##b\\\nc", (TokenTestSuite[]){
+                                   {'#', "#", 1, NULL},
+                                   {token_identifier, "a", 1, NULL},
+                                   {token_hash_hash, "##", 1, NULL},
+                                   {token_identifier, "b", 1, NULL},
+                                   {' ', " ", 1, NULL},
+                                   {token_identifier, "c", 2, NULL},
+                                   {'\0', "", 2, NULL},
+                               });
+
+    test_tokens("a \t  \"x\\ny\" /* \n\n */b",
+                (TokenTestSuite[]){
+                    {token_identifier, "a", 1, NULL},
+                    {' ', " \t  ", 1, NULL},
+                    {token_string, "\"x\\ny\"", 1, "x\ny"},
+                    {' ', " ", 1, NULL},
+                    {' ', " ", 1, NULL}, /* comment */
+                    {token_identifier, "b", 3, NULL},
+                    {'\0', "", 3, NULL},
+                });
+
+    test_skip_text_lines("a b\n  c\n \t#endif\nx", "#endif\nx", 3);
+    test_skip_text_lines("a /* # \n # */ b\n#x", "#x", 3);
+    test_skip_text_lines("/* c */ # define\n", "# define\n", 1);
+    test_skip_text_lines("x = 1 / 2;\n", "", 2);
+    test_skip_text_lines("no directive\nat all", "", 2);
+    test_skip_text_lines("s = \"/*\";\n#endif\n", "#endif\n", 2);
+    test_skip_text_lines("c = '\\'' \"\\\"/*\" // /*\n#endif", "#endif", 2);
 }
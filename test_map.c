@@ -1,3 +1,7 @@
+#ifndef USE_STANDARD_HEADERS
+#define USE_STANDARD_HEADERS
+#endif
+
 #include "map.h"
 
 void test_map(void) {
@@ -27,4 +31,31 @@ void test_map(void) {
     assert((intptr_t)map_get(m, "a") == 1);
     assert((intptr_t)map_get(m, "b") == 2);
     assert(map_get(m, "aa") == NULL);
+
+    /* large maps are hashed */
+    char key[16];
+
+    for (int i = 0; i < 100; i++) {
+        sprintf(key, "k%d", i);
+        map_add(m, key, (void *)(intptr_t)(i + 10));
+    }
+
+    assert(map_size(m) == 102);
+
+    for (int i = 0; i < 100; i++) {
+        sprintf(key, "k%d", i);
+        assert(map_contains(m, key) == true);
+        assert((intptr_t)map_get(m, key) == i + 10);
+    }
+
+    assert((intptr_t)map_get(m, "a") == 1);
+    assert(map_contains(m, "k100") == false);
+    assert(map_get(m, "k100") == NULL);
+
+    /* the newest value wins */
+    map_add(m, "k42", (void *)(intptr_t)-42);
+    map_add(m, "a", (void *)(intptr_t)-1);
+
+    assert((intptr_t)map_get(m, "k42") == -42);
+    assert((intptr_t)map_get(m, "a") == -1);
 }
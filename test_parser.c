@@ -10,8 +10,10 @@ Token *test_token_new(int kind, char *text, char *string) {
     t->text = text;
     t->filename = str_dup("test_lexer");
     t->line = 1;
+    t->location = source_register("test_lexer", text, strlen(text));
     t->string = string;
     t->len_string = string == NULL ? 0 : strlen(string);
+    t->name_id = kind == token_identifier ? lex_name_id(text) : 0;
 
     return t;
 }
@@ -83,9 +85,7 @@ void test_parsing_identifier(void) {
 
     VariableNode *decl = &(VariableNode){
         .kind = node_variable,
-        .line = 1,
-        .symbol = (Symbol *)variable_symbol_new("test_parsing_identifier", 1,
-                                                "xyz", type_get_int32()),
+        .symbol = (Symbol *)variable_symbol_new(0, "xyz", type_get_int32()),
     };
 
     scope_stack_register(ctx->env, decl->symbol->identifier, decl);
@@ -109,10 +109,8 @@ void test_parsing_call(void) {
 
     FunctionNode *decl = &(FunctionNode){
         .kind = node_function,
-        .line = 1,
         .symbol = (Symbol *)variable_symbol_new(
-            "test_parsing_call", 1, "f",
-            function_type_new(type_get_int32(), NULL, 0, false)),
+            0, "f", function_type_new(type_get_int32(), NULL, 0, false)),
         .params = NULL,
         .num_params = 0,
         .var_args = false,
@@ -148,9 +146,8 @@ void test_parsing_call_arg(void) {
 
     FunctionNode *decl = &(FunctionNode){
         .kind = node_function,
-        .line = 1,
         .symbol = (Symbol *)variable_symbol_new(
-            "test_parsing_call_arg", 1, "f",
+            0, "f",
             function_type_new(type_get_int32(),
                               (Type *[]){
                                   type_get_int32(),
@@ -191,9 +188,8 @@ void test_parsing_call_args(void) {
 
     FunctionNode *decl = &(FunctionNode){
         .kind = node_function,
-        .line = 1,
         .symbol = (Symbol *)variable_symbol_new(
-            "test_parsing_call_args", 1, "f",
+            0, "f",
             function_type_new(type_get_int32(),
                               (Type *[]){
                                   type_get_int32(),
@@ -366,7 +362,7 @@ void test_parsing_expr_stmt(void) {
     ExprStmtNode *p = (ExprStmtNode *)parse_stmt(ctx);
 
     assert(p->kind == node_expr);
-    assert(p->line == 1);
+    assert(source_location_line(p->location) == 1);
     assert(p->expr->kind == node_integer);
 }
 
@@ -375,8 +371,7 @@ void test_parsing_return_stmt(void) {
         .env = scope_stack_new(),
         .struct_env = scope_stack_new(),
         .current_function = variable_symbol_new(
-            "test_parsing_return_stmt", 1, "f",
-            function_type_new(type_get_int32(), NULL, 0, false)),
+            0, "f", function_type_new(type_get_int32(), NULL, 0, false)),
         .tokens =
             (const Token *[]){
                 test_token_new(token_return, "return", NULL),
@@ -399,8 +394,7 @@ void test_parsing_return_void_stmt(void) {
         .env = scope_stack_new(),
         .struct_env = scope_stack_new(),
         .current_function = variable_symbol_new(
-            "test_parsing_return_void_stmt", 1, "f",
-            function_type_new(type_get_void(), NULL, 0, false)),
+            0, "f", function_type_new(type_get_void(), NULL, 0, false)),
         .tokens =
             (const Token *[]){
                 test_token_new(token_return, "return", NULL),
@@ -413,7 +407,7 @@ void test_parsing_return_void_stmt(void) {
     ReturnNode *p = (ReturnNode *)parse_stmt(ctx);
 
     assert(p->kind == node_return);
-    assert(p->line == 1);
+    assert(source_location_line(p->location) == 1);
     assert(p->return_value == NULL);
 }
 
@@ -430,8 +424,7 @@ void test_parsing_compound_stmt(void) {
         .env = scope_stack_new(),
         .struct_env = scope_stack_new(),
         .current_function = variable_symbol_new(
-            "test_parsing_compound_stmt", 1, "f",
-            function_type_new(type_get_void(), NULL, 0, false)),
+            0, "f", function_type_new(type_get_void(), NULL, 0, false)),
         .tokens =
             (const Token *[]){
                 test_token_new('{', "{", NULL),
@@ -471,7 +464,7 @@ void test_parsing_if_stmt(void) {
     });
 
     assert(p->kind == node_if);
-    assert(p->line == 1);
+    assert(source_location_line(p->location) == 1);
     assert(p->condition->kind == node_integer);
     assert(p->then->kind == node_compound);
     assert(p->else_ == NULL);
@@ -489,7 +482,7 @@ void test_parsing_if_else_stmt(void) {
     });
 
     assert(p->kind == node_if);
-    assert(p->line == 1);
+    assert(source_location_line(p->location) == 1);
     assert(p->condition->kind == node_integer);
     assert(p->then->kind == node_compound);
     assert(p->else_ != NULL);
@@ -507,7 +500,7 @@ void test_parsing_parameter(void) {
     });
 
     assert(p->kind == node_variable);
-    assert(p->line == 1);
+    assert(source_location_line(p->location) == 1);
     assert(strcmp(p->symbol->identifier, "a") == 0);
     assert(is_int32_type(p->symbol->type));
 }
@@ -526,7 +519,7 @@ void test_parsing_function(void) {
     FunctionType *t = (FunctionType *)q->symbol->type;
 
     assert(p->kind == node_function);
-    assert(p->line == 1);
+    assert(source_location_line(p->location) == 1);
     assert(strcmp(p->symbol->identifier, "main") == 0);
     assert(q->num_params == 0);
     assert(q->var_args == false);
@@ -552,7 +545,7 @@ void test_parsing_function_prototype(void) {
     FunctionType *t = (FunctionType *)q->symbol->type;
 
     assert(p->kind == node_function);
-    assert(p->line == 1);
+    assert(source_location_line(p->location) == 1);
     assert(strcmp(p->symbol->identifier, "main") == 0);
     assert(q->num_params == 0);
     assert(q->var_args == false);
@@ -577,7 +570,7 @@ void test_parsing_function_param(void) {
     FunctionType *t = (FunctionType *)q->symbol->type;
 
     assert(p->kind == node_function);
-    assert(p->line == 1);
+    assert(source_location_line(p->location) == 1);
     assert(strcmp(p->symbol->identifier, "main") == 0);
     assert(q->num_params == 1);
     assert(q->var_args == false);
@@ -591,7 +584,7 @@ void test_parsing_function_param(void) {
     VariableNode *a = q->params[0];
 
     assert(a->kind == node_variable);
-    assert(a->line == 1);
+    assert(source_location_line(a->location) == 1);
     assert(strcmp(a->symbol->identifier, "a") == 0);
     assert(is_int32_type(a->symbol->type));
 }
@@ -610,7 +603,7 @@ void test_parsing_function_params(void) {
     FunctionType *t = (FunctionType *)q->symbol->type;
 
     assert(p->kind == node_function);
-    assert(p->line == 1);
+    assert(source_location_line(p->location) == 1);
     assert(strcmp(p->symbol->identifier, "main") == 0);
     assert(q->num_params == 2);
     assert(q->var_args == false);
@@ -626,12 +619,12 @@ void test_parsing_function_params(void) {
     VariableNode *b = q->params[1];
 
     assert(a->kind == node_variable);
-    assert(a->line == 1);
+    assert(source_location_line(a->location) == 1);
     assert(strcmp(a->symbol->identifier, "a") == 0);
     assert(is_int32_type(a->symbol->type));
 
     assert(b->kind == node_variable);
-    assert(b->line == 1);
+    assert(source_location_line(b->location) == 1);
     assert(strcmp(b->symbol->identifier, "b") == 0);
     assert(is_int32_type(b->symbol->type));
 }
@@ -647,7 +640,7 @@ void test_parsing_translation_unit(void) {
     FunctionType *t = (FunctionType *)f->symbol->type;
 
     assert(f->kind == node_function);
-    assert(f->line == 1);
+    assert(source_location_line(f->location) == 1);
     assert(strcmp(f->symbol->identifier, "main") == 0);
     assert(f->num_params == 0);
     assert(f->var_args == false);
@@ -659,6 +652,46 @@ void test_parsing_translation_unit(void) {
     assert(t->num_params == 0);
 }
 
+void test_parsing_address_taken(void) {
+    TranslationUnitNode *p =
+        parse("test_parsing_address_taken",
+              "struct S {int m;};\n"
+              "int f(int a, int b) {\n"
+              "    int x; int y; int arr[4]; struct S s; int *q;\n"
+              "    q = &x; q = &s.m; arr[0] = y; return a + b + *q;\n"
+              "}\n",
+              vec_new());
+
+    FunctionNode *f = (FunctionNode *)p->decls[0];
+
+    assert(f->kind == node_function);
+    assert(f->num_params == 2);
+    assert(f->num_locals == 5);
+
+    /* a, b: never address-taken */
+    assert(((VariableSymbol *)f->params[0]->symbol)->is_register_promotable);
+    assert(((VariableSymbol *)f->params[1]->symbol)->is_register_promotable);
+
+    /* x: &x */
+    assert(((VariableSymbol *)f->locals[0]->symbol)->is_address_taken);
+    assert(!((VariableSymbol *)f->locals[0]->symbol)->is_register_promotable);
+
+    /* y */
+    assert(!((VariableSymbol *)f->locals[1]->symbol)->is_address_taken);
+    assert(((VariableSymbol *)f->locals[1]->symbol)->is_register_promotable);
+
+    /* arr: decays to a pointer */
+    assert(((VariableSymbol *)f->locals[2]->symbol)->is_address_taken);
+    assert(!((VariableSymbol *)f->locals[2]->symbol)->is_register_promotable);
+
+    /* s: &s.m */
+    assert(((VariableSymbol *)f->locals[3]->symbol)->is_address_taken);
+    assert(!((VariableSymbol *)f->locals[3]->symbol)->is_register_promotable);
+
+    /* q */
+    assert(((VariableSymbol *)f->locals[4]->symbol)->is_register_promotable);
+}
+
 void test_parser(void) {
     test_parsing_type_void();
     test_parsing_type_int();
@@ -687,4 +720,5 @@ void test_parser(void) {
     test_parsing_function_params();
 
     test_parsing_translation_unit();
+    test_parsing_address_taken();
 }
@@ -48,7 +48,76 @@ void test_pp(const char *filename, const char *src, Vec *include_directories,
     } while (toks[i++]->kind != '\0');
 }
 
+void test_pp_stream(void) {
+    Preprocessor *pp = preprocessor_new("stream",
+                                        "#define S \"b\"\n"
+                                        "a \"x\"\n"
+                                        "S\n"
+                                        "#if 1\n"
+                                        "c\n"
+                                        "#endif\n",
+                                        vec_new());
+    const char *expected[] = {"a", "\"xb\"", "c", "", ""};
+
+    for (int i = 0; i < 5; i++) {
+        Token *t = preprocessor_next_token(pp);
+
+        if (strcmp(t->text, expected[i]) != 0) {
+            fprintf(stderr, "stream: token %d is expected %s, but got %s\n", i,
+                    expected[i], t->text);
+            exit(1);
+        }
+    }
+}
+
+void test_pp_long_string(void) {
+    const int num_literals = 1000;
+    char *src = malloc(num_literals * 6 + 16);
+
+    /* "a\0b" "a\0b" ... "a\0b" x */
+    for (int i = 0; i < num_literals; i++) {
+        memcpy(src + i * 6, "\"a\\0b\" ", 6);
+    }
+    memcpy(src + num_literals * 6, "x", 2);
+
+    const Token **toks = (const Token **)preprocess("long_string", src,
+                                                    vec_new())
+                             ->data;
+
+    assert(toks[0]->kind == token_string);
+    assert(toks[0]->len_string == num_literals * 3);
+    assert((int)strlen(toks[0]->text) == num_literals * 4 + 2);
+    for (int i = 0; i < num_literals; i++) {
+        assert(toks[0]->string[i * 3] == 'a');
+        assert(toks[0]->string[i * 3 + 1] == '\0');
+        assert(toks[0]->string[i * 3 + 2] == 'b');
+    }
+    assert(strcmp(toks[1]->text, "x") == 0);
+}
+
+/* pasted tokens take the location of their left operand and do not use up
+   source locations */
+void test_pp_paste_locations(void) {
+    const char *src = "#define CAT(a, b) a ## b\n"
+                      "CAT(x, 1) CAT(x, 2) CAT(x, 3)\n";
+
+    int before = source_register("before", "", 0);
+    const Token **toks =
+        (const Token **)preprocess("paste_locations", src, vec_new())->data;
+    int after = source_register("after", "", 0);
+
+    assert(after - before == 1 + (int)strlen(src) + 1);
+    assert(strcmp(toks[0]->text, "x1") == 0);
+    assert(toks[0]->location == before + 1 + 29);
+    assert(source_location_line(toks[2]->location) == 2);
+    assert(source_location_column(toks[2]->location) == 25);
+}
+
 void test_preprocessor(Vec *include_directories) {
+    test_pp_stream();
+    test_pp_long_string();
+    test_pp_paste_locations();
+
     test_pp("separator", "pp removes spaces \n and new line\n", vec_new(),
             (TestSuite[]){
                 {token_identifier, "pp", NULL},
@@ -124,6 +193,135 @@ void test_preprocessor(Vec *include_directories) {
                 {'\0', "", NULL},
             });
 
+    test_pp("define_recursive",
+            "#define A B\n"
+            "#define B A C\n"
+            "A\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "A", NULL},
+                {token_identifier, "C", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("define_function",
+            "#define ADD(a, b) ((a) + (b))\n"
+            "ADD(x, f(y, z)) ADD\n",
+            vec_new(),
+            (TestSuite[]){
+                {'(', "(", NULL},
+                {'(', "(", NULL},
+                {token_identifier, "x", NULL},
+                {')', ")", NULL},
+                {'+', "+", NULL},
+                {'(', "(", NULL},
+                {token_identifier, "f", NULL},
+                {'(', "(", NULL},
+                {token_identifier, "y", NULL},
+                {',', ",", NULL},
+                {token_identifier, "z", NULL},
+                {')', ")", NULL},
+                {')', ")", NULL},
+                {')', ")", NULL},
+                {token_identifier, "ADD", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("define_function2",
+            "#define TWICE(x) x x\n"
+            "#define ID(x) x\n"
+            "TWICE(ID(ID(a)))\n"
+            "ID(\n"
+            "b) ID\n"
+            "(c)\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "a", NULL},
+                {token_identifier, "a", NULL},
+                {token_identifier, "b", NULL},
+                {token_identifier, "c", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("define_function3",
+            "#define f(a) a*g\n"
+            "#define g(a) f(a)\n"
+            "f(2)(9)\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_number, "2", NULL},
+                {'*', "*", NULL},
+                {token_number, "9", NULL},
+                {'*', "*", NULL},
+                {token_identifier, "g", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("stringize",
+            "#define STR(x) #x\n"
+            "STR( a  +\"\\n\" ) STR()\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_string, "\"a +\\\"\\\\n\\\"\"", "a +\"\\n\""},
+                {'\0', "", NULL},
+            });
+
+    test_pp("paste",
+            "#define CAT(a, b) a ## b\n"
+            "#define XY 1\n"
+            "CAT(X, Y) CAT(x, 2) CAT(, y) CAT(z, ) CAT(+, +)\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_number, "1", NULL},
+                {token_identifier, "x2", NULL},
+                {token_identifier, "y", NULL},
+                {token_identifier, "z", NULL},
+                {token_increment, "++", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("var_args",
+            "#define CALL(f, ...) f(__VA_ARGS__)\n"
+            "#define LOG(fmt, ...) log(fmt, ## __VA_ARGS__)\n"
+            "CALL(g, 1, (2, 3)) LOG(s) LOG(s, 4)\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "g", NULL},
+                {'(', "(", NULL},
+                {token_number, "1", NULL},
+                {',', ",", NULL},
+                {'(', "(", NULL},
+                {token_number, "2", NULL},
+                {',', ",", NULL},
+                {token_number, "3", NULL},
+                {')', ")", NULL},
+                {')', ")", NULL},
+                {token_identifier, "log", NULL},
+                {'(', "(", NULL},
+                {token_identifier, "s", NULL},
+                {')', ")", NULL},
+                {token_identifier, "log", NULL},
+                {'(', "(", NULL},
+                {token_identifier, "s", NULL},
+                {',', ",", NULL},
+                {token_number, "4", NULL},
+                {')', ")", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("line_splice",
+            "#define SUM(a, b) \\\n"
+            "    a + \\\n"
+            "    b\n"
+            "SUM(1, 2)\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_number, "1", NULL},
+                {'+', "+", NULL},
+                {token_number, "2", NULL},
+                {'\0', "", NULL},
+            });
+
     test_pp("include", "# include \"test/test_include.h\"\n",
             include_directories,
             (TestSuite[]){
@@ -328,4 +526,169 @@ void test_preprocessor(Vec *include_directories) {
                 {token_identifier, "here", NULL},
                 {'\0', "", NULL},
             });
+
+    test_pp("if",
+            "#if 1 + 2 * 3 == 7 && !(10 / 3 - 3) && -1 < 0\n"
+            "a\n"
+            "#endif\n"
+            "#if 0\n"
+            "b\n"
+            "#endif\n"
+            "#if 3 % 2 ? ~0 == -1 : 0\n"
+            "c\n"
+            "#endif\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "a", NULL},
+                {token_identifier, "c", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("if_long",
+            "#if 4294967296 > 0 && 2147483647 + 1 > 0\n"
+            "a\n"
+            "#else\n"
+            "b\n"
+            "#endif\n"
+            "#if 0 && 1 / 0\n"
+            "#elif 1 || 1 % 0\n"
+            "c\n"
+            "#endif\n"
+            "#if 1 ? 2 : 3 / 0\n"
+            "d\n"
+            "#endif\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "a", NULL},
+                {token_identifier, "c", NULL},
+                {token_identifier, "d", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("if_literals",
+            "#if 010 == 8 && 0x10 == 16 && 0XfF == 255\n"
+            "a\n"
+            "#endif\n"
+            "#if 199901L >= 199901L && 10u == 10 && 1ULL == 1ul\n"
+            "b\n"
+            "#endif\n"
+            "#if (1 << 3) == 8 && 1 + 1 << 2 == 8 && 1 << 40 >> 38 == 4\n"
+            "c\n"
+            "#endif\n"
+            "#if -7 >> 1 == -4 && (0 && 1 << 99) == 0\n"
+            "d\n"
+            "#endif\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "a", NULL},
+                {token_identifier, "b", NULL},
+                {token_identifier, "c", NULL},
+                {token_identifier, "d", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("if_defined",
+            "#define A 2\n"
+            "#define F(x) (x * A)\n"
+            "#if defined A && defined(F) && !defined B\n"
+            "a\n"
+            "#endif\n"
+            "#if F(A) == 4 && B == 0 && 'a' == 97\n"
+            "b\n"
+            "#endif\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "a", NULL},
+                {token_identifier, "b", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("elif",
+            "#define N 2\n"
+            "#if N == 1\n"
+            "one\n"
+            "#elif N == 2\n"
+            "two\n"
+            "#elif N == 2\n"
+            "again\n"
+            "#else\n"
+            "other\n"
+            "#endif\n"
+            "#if 0\n"
+            "#elif 0\n"
+            "#else\n"
+            "else\n"
+            "#endif\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "two", NULL},
+                {token_else, "else", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("nested_elif",
+            "#if 0\n"
+            "#if 1\n"
+            "a\n"
+            "#elif 1\n"
+            "b\n"
+            "#endif\n"
+            "#elif 1\n"
+            "#ifdef X\n"
+            "c\n"
+            "#elif 1 / 1\n"
+            "d\n"
+            "#endif\n"
+            "#endif\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "d", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("skip_literals",
+            "#if 0\n"
+            "char *s = \"/*\";\n"
+            "#endif\n"
+            "x\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "x", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("skip_text_lines",
+            "#ifdef A\n"
+            "  \"#endif\" /* a\n"
+            "#endif\n"
+            "  */ x\n"
+            "  # if 1\n"
+            "y\n"
+            "#endif\n"
+            "/* */ #else\n"
+            "z\n"
+            "#endif\n",
+            vec_new(),
+            (TestSuite[]){
+                {token_identifier, "z", NULL},
+                {'\0', "", NULL},
+            });
+
+    test_pp("pragma",
+            "#define N 4\n"
+            "# pragma unroll N\n"
+            "for\n"
+            "#pragma once",
+            vec_new(),
+            (TestSuite[]){
+                {token_pragma, "pragma", NULL},
+                {token_identifier, "unroll", NULL},
+                {token_number, "4", NULL},
+                {'\n', "\n", NULL},
+                {token_for, "for", NULL},
+                {token_pragma, "pragma", NULL},
+                {token_identifier, "once", NULL},
+                {'\n', "", NULL},
+                {'\0', "", NULL},
+            });
 }
@@ -0,0 +1,95 @@
+#ifndef USE_STANDARD_HEADERS
+#define USE_STANDARD_HEADERS
+#endif
+
+#include "nocc.h"
+
+void test_scope_stack(void) {
+    ScopeStack *s;
+
+    s = scope_stack_new();
+
+    assert(scope_stack_depth(s) == 1);
+    assert(scope_stack_find(s, "a", true) == NULL);
+
+    scope_stack_register(s, "a", (void *)(intptr_t)1);
+    scope_stack_register(s, "b", (void *)(intptr_t)2);
+
+    /* inner scopes shadow outer bindings */
+    scope_stack_push(s);
+
+    assert(scope_stack_depth(s) == 2);
+    assert((intptr_t)scope_stack_find(s, "a", true) == 1);
+    assert(scope_stack_find(s, "a", false) == NULL);
+
+    scope_stack_register(s, "a", (void *)(intptr_t)3);
+    scope_stack_register(s, "c", (void *)(intptr_t)4);
+
+    assert((intptr_t)scope_stack_find(s, "a", true) == 3);
+    assert((intptr_t)scope_stack_find(s, "a", false) == 3);
+    assert((intptr_t)scope_stack_find(s, "b", true) == 2);
+    assert((intptr_t)scope_stack_find(s, "c", false) == 4);
+
+    /* an empty scope in between */
+    scope_stack_push(s);
+    scope_stack_push(s);
+
+    scope_stack_register(s, "b", (void *)(intptr_t)5);
+
+    assert((intptr_t)scope_stack_find(s, "a", true) == 3);
+    assert((intptr_t)scope_stack_find(s, "b", true) == 5);
+
+    scope_stack_pop(s);
+
+    assert((intptr_t)scope_stack_find(s, "b", true) == 2);
+
+    scope_stack_pop(s);
+    scope_stack_pop(s);
+
+    /* only the bindings of the popped scopes are removed */
+    assert(scope_stack_depth(s) == 1);
+    assert((intptr_t)scope_stack_find(s, "a", false) == 1);
+    assert((intptr_t)scope_stack_find(s, "b", false) == 2);
+    assert(scope_stack_find(s, "c", true) == NULL);
+
+    /* many names with deep nesting */
+    char name[16];
+
+    for (int i = 0; i < 200; i++) {
+        scope_stack_push(s);
+        sprintf(name, "n%d", i);
+        scope_stack_register(s, name, (void *)(intptr_t)(i + 10));
+    }
+
+    for (int i = 0; i < 200; i++) {
+        sprintf(name, "n%d", i);
+        assert((intptr_t)scope_stack_find(s, name, true) == i + 10);
+    }
+
+    for (int i = 199; i >= 0; i--) {
+        sprintf(name, "n%d", i);
+        assert((intptr_t)scope_stack_find(s, name, false) == i + 10);
+        scope_stack_pop(s);
+        assert(scope_stack_find(s, name, true) == NULL);
+    }
+
+    assert((intptr_t)scope_stack_find(s, "a", true) == 1);
+
+    /* typedef names */
+    scope_stack_register_typedef(s, "t", (void *)(intptr_t)6);
+
+    assert(scope_stack_is_typedef(s, lex_name_id("t")));
+    assert(!scope_stack_is_typedef(s, lex_name_id("a")));
+    assert((intptr_t)scope_stack_find(s, "t", true) == 6);
+
+    /* shadowed by an ordinary binding */
+    scope_stack_push(s);
+    scope_stack_register(s, "t", (void *)(intptr_t)7);
+
+    assert(!scope_stack_is_typedef(s, lex_name_id("t")));
+    assert((intptr_t)scope_stack_find_id(s, lex_name_id("t"), true) == 7);
+
+    scope_stack_pop(s);
+
+    assert(scope_stack_is_typedef(s, lex_name_id("t")));
+}
@@ -34,3 +34,49 @@ void test_vec(void) {
     assert((intptr_t)vec_pop(v) == 1);
     assert(v->size == 0);
 }
+
+void test_small_vec(void) {
+    SmallVec v;
+    void **data;
+    int i;
+
+    small_vec_init(&v);
+
+    assert(v.size == 0);
+    assert(small_vec_finish(&v) == NULL);
+
+    /* inline storage */
+    small_vec_init(&v);
+    small_vec_push(&v, (void *)(intptr_t)1);
+    small_vec_push(&v, (void *)(intptr_t)2);
+
+    assert(v.size == 2);
+    assert(v.data == v.inline_data);
+    assert((intptr_t)small_vec_back(&v) == 2);
+
+    data = small_vec_finish(&v);
+
+    assert(v.size == 2);
+    assert(data != v.inline_data);
+    assert((intptr_t)data[0] == 1);
+    assert((intptr_t)data[1] == 2);
+
+    /* spilled to the heap */
+    small_vec_init(&v);
+
+    for (i = 0; i < 100; i++) {
+        small_vec_push(&v, (void *)(intptr_t)i);
+    }
+
+    assert(v.size == 100);
+    assert(v.data != v.inline_data);
+    assert((intptr_t)small_vec_pop(&v) == 99);
+
+    data = small_vec_finish(&v);
+
+    assert(v.size == 99);
+
+    for (i = 0; i < 99; i++) {
+        assert((intptr_t)data[i] == i);
+    }
+}
@@ -27,6 +27,24 @@ Type *type_get_int32(void) {
     return t;
 }
 
+Type *type_get_int64(void) {
+    Type *t;
+
+    t = malloc(sizeof(*t));
+    t->kind = type_int64;
+
+    return t;
+}
+
+Type *type_get_long(void) {
+#ifdef __MINGW64__
+    /* LLP64: long is as wide as int, long long and pointers are 64 bits */
+    return type_get_int32();
+#else
+    return type_get_int64();
+#endif
+}
+
 Type *pointer_type_new(Type *element_type) {
     PointerType *t;
 
@@ -35,6 +53,16 @@ Type *pointer_type_new(Type *element_type) {
     t = malloc(sizeof(*t));
     t->kind = type_pointer;
     t->element_type = element_type;
+    t->is_restrict = false;
+
+    return (Type *)t;
+}
+
+Type *restrict_pointer_type_new(Type *element_type) {
+    PointerType *t;
+
+    t = (PointerType *)pointer_type_new(element_type);
+    t->is_restrict = true;
 
     return (Type *)t;
 }
@@ -94,6 +122,7 @@ bool type_equals(Type *a, Type *b) {
     case type_void:
     case type_int8:
     case type_int32:
+    case type_int64:
         return true;
 
     case type_pointer:
@@ -145,6 +174,11 @@ bool is_int32_type(Type *t) {
     return t->kind == type_int32;
 }
 
+bool is_int64_type(Type *t) {
+    assert(t != NULL);
+    return t->kind == type_int64;
+}
+
 bool is_pointer_type(Type *t) {
     assert(t != NULL);
     return t->kind == type_pointer;
@@ -194,6 +228,11 @@ bool is_function_pointer_type(Type *t) {
     return is_pointer_type(t) && is_function_type(pointer_element_type(t));
 }
 
+bool is_restrict_pointer_type(Type *t) {
+    assert(t != NULL);
+    return is_pointer_type(t) && ((PointerType *)t)->is_restrict;
+}
+
 bool is_incomplete_pointer_type(Type *t) {
     assert(t != NULL);
     return is_pointer_type(t) && is_incomplete_type(pointer_element_type(t));
@@ -201,7 +240,7 @@ bool is_incomplete_pointer_type(Type *t) {
 
 bool is_integer_type(Type *t) {
     assert(t != NULL);
-    return is_int8_type(t) || is_int32_type(t);
+    return is_int8_type(t) || is_int32_type(t) || is_int64_type(t);
 }
 
 bool is_scalar_type(Type *t) {
@@ -295,6 +334,82 @@ struct MemberNode *struct_type_member(Type *t, int index) {
     return ((StructType *)t)->members[index];
 }
 
+int type_alignment(Type *t) {
+    int alignment;
+    int member_alignment;
+    int i;
+
+    assert(t != NULL);
+
+    switch (t->kind) {
+    case type_array:
+        return type_alignment(array_element_type(t));
+
+    case type_struct:
+        alignment = 1;
+
+        for (i = 0; i < struct_type_count_members(t); i++) {
+            member_alignment =
+                type_alignment(struct_type_member(t, i)->symbol->type);
+
+            if (member_alignment > alignment) {
+                alignment = member_alignment;
+            }
+        }
+        return alignment;
+
+    default:
+        /* scalars are aligned to their size */
+        return type_size(t);
+    }
+}
+
+long type_size(Type *t) {
+    long size;
+    long alignment;
+    int i;
+
+    assert(t != NULL);
+
+    /* sizes of the 64-bit targets, -1 if the type has no size */
+    switch (t->kind) {
+    case type_int8:
+        return 1;
+
+    case type_int32:
+        return 4;
+
+    case type_int64:
+    case type_pointer:
+        return 8;
+
+    case type_array:
+        return array_type_count_elements(t) *
+               type_size(array_element_type(t));
+
+    case type_struct:
+        if (is_incomplete_type(t)) {
+            return -1;
+        }
+
+        /* members are padded to their alignment, and the whole struct to
+           the largest one */
+        size = 0;
+
+        for (i = 0; i < struct_type_count_members(t); i++) {
+            alignment = type_alignment(struct_type_member(t, i)->symbol->type);
+            size = (size + alignment - 1) / alignment * alignment;
+            size = size + type_size(struct_type_member(t, i)->symbol->type);
+        }
+
+        alignment = type_alignment(t);
+        return (size + alignment - 1) / alignment * alignment;
+
+    default:
+        return -1;
+    }
+}
+
 struct MemberNode *struct_type_find_member(Type *t, const char *member_name,
                                            int *index) {
     MemberNode *member;
@@ -307,7 +422,19 @@ struct MemberNode *struct_type_find_member(Type *t, const char *member_name,
         return NULL;
     }
 
-    for (*index = 0; struct_type_count_members(t); (*index)++) {
+    if (((StructType *)t)->member_index != NULL) {
+        /* 1-based index, 0 if not found */
+        *index =
+            (intptr_t)map_get(((StructType *)t)->member_index, member_name) - 1;
+
+        if (*index < 0) {
+            return NULL;
+        }
+
+        return struct_type_member(t, *index);
+    }
+
+    for (*index = 0; *index < struct_type_count_members(t); (*index)++) {
         member = struct_type_member(t, *index);
 
         if (strcmp(member->symbol->identifier, member_name) == 0) {
@@ -46,3 +46,87 @@ char *str_cat_n(const char *s1, int len1, const char *s2, int len2) {
 
     return p;
 }
+
+int str_hash(const char *s) {
+    int h;
+    int i;
+
+    assert(s != NULL);
+
+    /* kept below 2^24 so that it never overflows */
+    h = 0;
+    for (i = 0; s[i] != '\0'; i++) {
+        h = (h * 31 + s[i] + 128) % 16777213;
+    }
+
+    return h;
+}
+
+StrBuilder *str_builder_new(void) {
+    StrBuilder *sb;
+
+    sb = malloc(sizeof(*sb));
+    sb->data = malloc(sizeof(char) * 16);
+    sb->data[0] = '\0';
+    sb->size = 0;
+    sb->capacity = 16;
+
+    return sb;
+}
+
+void str_builder_clear(StrBuilder *sb) {
+    assert(sb != NULL);
+
+    sb->data[0] = '\0';
+    sb->size = 0;
+}
+
+void str_builder_reserve(StrBuilder *sb, int length) {
+    assert(sb != NULL);
+    assert(length >= 0);
+
+    /* keep room for the terminator */
+    if (sb->size + length < sb->capacity) {
+        return;
+    }
+
+    while (sb->size + length >= sb->capacity) {
+        sb->capacity = sb->capacity * 2;
+    }
+
+    sb->data = realloc(sb->data, sizeof(char) * sb->capacity);
+}
+
+void str_builder_push(StrBuilder *sb, char c) {
+    assert(sb != NULL);
+
+    str_builder_reserve(sb, 1);
+
+    sb->data[sb->size] = c;
+    sb->size++;
+    sb->data[sb->size] = '\0';
+}
+
+void str_builder_append_n(StrBuilder *sb, const char *s, int length) {
+    assert(sb != NULL);
+    assert(s != NULL);
+    assert(length >= 0);
+
+    str_builder_reserve(sb, length);
+
+    memcpy(sb->data + sb->size, s, length);
+    sb->size = sb->size + length;
+    sb->data[sb->size] = '\0';
+}
+
+char *str_builder_dup(StrBuilder *sb) {
+    char *p;
+
+    assert(sb != NULL);
+
+    /* the contents may contain '\0' */
+    p = malloc(sizeof(char) * (sb->size + 1));
+    memcpy(p, sb->data, sb->size + 1);
+
+    return p;
+}
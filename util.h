@@ -1,8 +1,21 @@
 #ifndef INCLUDE_util_h
 #define INCLUDE_util_h
 
+typedef struct StrBuilder {
+    char *data; /* always terminated by '\0' */
+    int size;
+    int capacity;
+} StrBuilder;
+
 char *str_dup(const char *s);
 char *str_dup_n(const char *s, int length);
 char *str_cat_n(const char *s1, int len1, const char *s2, int len2);
+int str_hash(const char *s);
+
+StrBuilder *str_builder_new(void);
+void str_builder_clear(StrBuilder *sb);
+void str_builder_push(StrBuilder *sb, char c);
+void str_builder_append_n(StrBuilder *sb, const char *s, int length);
+char *str_builder_dup(StrBuilder *sb);
 
 #endif
@@ -13,7 +13,7 @@ Vec *vec_new(void) {
     return v;
 }
 
-void vec_reserve(Vec *v, int capacity) {
+void vec_reserve(Vec *v, long capacity) {
     assert(v != NULL);
     assert(capacity >= 0);
 
@@ -23,7 +23,7 @@ void vec_reserve(Vec *v, int capacity) {
     }
 }
 
-void vec_resize(Vec *v, int size) {
+void vec_resize(Vec *v, long size) {
     assert(v != NULL);
     assert(size >= 0);
 
@@ -54,3 +54,63 @@ void *vec_pop(Vec *v) {
 
     return v->data[--v->size];
 }
+
+void small_vec_init(SmallVec *v) {
+    assert(v != NULL);
+
+    v->capacity = small_vec_inline_capacity;
+    v->size = 0;
+    v->data = v->inline_data;
+}
+
+void small_vec_push(SmallVec *v, void *value) {
+    void **data;
+
+    assert(v != NULL);
+
+    if (v->capacity == v->size) {
+        if (v->data == v->inline_data) {
+            data = malloc(sizeof(void *) * v->capacity * 2);
+            memcpy(data, v->data, sizeof(void *) * v->size);
+        } else {
+            data = realloc(v->data, sizeof(void *) * v->capacity * 2);
+        }
+
+        v->capacity = v->capacity * 2;
+        v->data = data;
+    }
+
+    v->data[v->size++] = value;
+}
+
+void *small_vec_back(SmallVec *v) {
+    assert(v != NULL);
+    assert(v->size > 0);
+
+    return v->data[v->size - 1];
+}
+
+void *small_vec_pop(SmallVec *v) {
+    assert(v != NULL);
+    assert(v->size > 0);
+
+    return v->data[--v->size];
+}
+
+void **small_vec_finish(SmallVec *v) {
+    void **data;
+
+    assert(v != NULL);
+
+    if (v->size == 0) {
+        /* nothing to hand over */
+        data = NULL;
+    } else if (v->data == v->inline_data) {
+        data = malloc(sizeof(void *) * v->size);
+        memcpy(data, v->data, sizeof(void *) * v->size);
+    } else {
+        data = realloc(v->data, sizeof(void *) * v->size);
+    }
+
+    return data;
+}
@@ -2,16 +2,34 @@
 #define INCLUDE_vec_h
 
 typedef struct Vec {
-    int capacity;
-    int size;
+    long capacity;
+    long size;
     void **data;
 } Vec;
 
 Vec *vec_new(void);
-void vec_reserve(Vec *v, int capacity);
-void vec_resize(Vec *v, int size);
+void vec_reserve(Vec *v, long capacity);
+void vec_resize(Vec *v, long size);
 void *vec_back(Vec *v);
 void vec_push(Vec *v, void *value);
 void *vec_pop(Vec *v);
 
+#define small_vec_inline_capacity 8
+
+/* a vector for short lists built on the stack. the first elements are kept
+   in place and small_vec_finish moves them out into an exact-size array,
+   NULL if empty. after that only size may be read */
+typedef struct SmallVec {
+    long capacity;
+    long size;
+    void **data; /* inline_data until it overflows */
+    void *inline_data[small_vec_inline_capacity];
+} SmallVec;
+
+void small_vec_init(SmallVec *v);
+void small_vec_push(SmallVec *v, void *value);
+void *small_vec_back(SmallVec *v);
+void *small_vec_pop(SmallVec *v);
+void **small_vec_finish(SmallVec *v);
+
 #endif